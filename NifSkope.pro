@@ -132,6 +132,7 @@ build_pass {
 
 HEADERS += \
 	src/basemodel.h \
+	src/batch.h \
 	src/config.h \
 	src/gl/dds/BlockDXT.h \
 	src/gl/dds/Color.h \
@@ -142,6 +143,7 @@ HEADERS += \
 	src/gl/dds/Image.h \
 	src/gl/dds/PixelFormat.h \
 	src/gl/dds/Stream.h \
+	src/gl/glbuffers.h \
 	src/gl/glcontrolable.h \
 	src/gl/glcontroller.h \
 	src/gl/glmarker.h \
@@ -175,7 +177,9 @@ HEADERS += \
 	src/spells/blocks.h \
 	src/spells/mesh.h \
 	src/spells/misc.h \
+	src/spells/optimize.h \
 	src/spells/skeleton.h \
+	src/spells/spatialhash.h \
 	src/spells/stringpalette.h \
 	src/spells/tangentspace.h \
 	src/spells/texture.h \
@@ -199,12 +203,14 @@ HEADERS += \
 
 SOURCES += \
 	src/basemodel.cpp \
+	src/batch.cpp \
 	src/gl/dds/BlockDXT.cpp \
 	src/gl/dds/ColorBlock.cpp \
 	src/gl/dds/dds_api.cpp \
 	src/gl/dds/DirectDrawSurface.cpp \
 	src/gl/dds/Image.cpp \
 	src/gl/dds/Stream.cpp \
+	src/gl/glbuffers.cpp \
 	src/gl/glcontroller.cpp \
 	src/gl/glmarker.cpp \
 	src/gl/glmesh.cpp \
@@ -254,6 +260,7 @@ SOURCES += \
 	src/spells/optimize.cpp \
 	src/spells/sanitize.cpp \
 	src/spells/skeleton.cpp \
+	src/spells/spatialhash.cpp \
 	src/spells/stringpalette.cpp \
 	src/spells/strippify.cpp \
 	src/spells/tangentspace.cpp \
@@ -39,6 +39,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QFile>
 #include <QFileInfo>
 
+#include <utility>
+
 /* Default header data */
 #define MW_BSAHEADER_FILEID  0x00000100 //!< Magic for Morrowind BSA
 #define OB_BSAHEADER_FILEID  0x00415342 //!< Magic for Oblivion BSA, the literal string "BSA\0".
@@ -172,7 +174,7 @@ static bool BSAReadSizedString( QFile & bsa, QString & s )
 
 // see bsa.h
 BSA::BSA( const QString & filename )
-	: FSArchiveFile(), bsa( filename ), bsaInfo( QFileInfo(filename) ), status( "initialized" )
+	: FSArchiveFile(), bsa( filename ), bsaInfo( QFileInfo(filename) ), mapped( nullptr ), mappedSize( 0 ), status( "initialized" )
 {
 	bsaPath = bsaInfo.absolutePath() + QDir::separator() + bsaInfo.fileName();
 	bsaBase = bsaInfo.absolutePath();
@@ -370,6 +372,13 @@ bool BSA::open()
 		return false;
 	}
 	
+	// map the whole archive so that files can be extracted without seeking the shared QFile;
+	// if this fails (e.g. no address space left) fileContents() falls back to reading
+	mappedSize = bsa.size();
+	mapped = bsa.map( 0, mappedSize );
+	if ( ! mapped )
+		mappedSize = 0;
+	
 	status = "loaded successful";
 	
 	return true;
@@ -380,6 +389,11 @@ void BSA::close()
 {
 	QMutexLocker lock( & bsaMutex );
 	
+	if ( mapped )
+		bsa.unmap( mapped );
+	mapped = nullptr;
+	mappedSize = 0;
+	
 	bsa.close();
 	qDeleteAll( root.children );
 	qDeleteAll( root.files );
@@ -405,6 +419,9 @@ bool BSA::fileContents( const QString & fn, QByteArray & content )
 	//qDebug() << "entering fileContents for" << fn;
 	if ( const BSAFile * file = getFile( fn ) )
 	{
+		if ( mapped )
+			return mappedContents( file, content, true );
+		
 		QMutexLocker lock( & bsaMutex );
 		if ( bsa.seek( file->offset ) )
 		{
@@ -436,6 +453,78 @@ bool BSA::fileContents( const QString & fn, QByteArray & content )
 	return false;
 }
 
+// see bsa.h
+bool BSA::fileView( const QString & fn, QByteArray & content )
+{
+	if ( mapped )
+	{
+		if ( const BSAFile * file = getFile( fn ) )
+			return mappedContents( file, content, false );
+		return false;
+	}
+	return fileContents( fn, content );
+}
+
+// see bsa.h
+QStringList BSA::fileList() const
+{
+	QStringList list;
+	
+	for ( const QString & name : root.files.keys() )
+		list << name;
+	
+	for ( auto it = folders.constBegin(); it != folders.constEnd(); ++it )
+	{
+		for ( const QString & name : it.value()->files.keys() )
+			list << it.key() + "/" + name;
+	}
+	
+	return list;
+}
+
+// see bsa.h
+bool BSA::mappedContents( const BSAFile * file, QByteArray & content, bool copy ) const
+{
+	qint64 offset = file->offset;
+	qint64 filesz = file->size();
+	
+	if ( namePrefix )
+	{
+		if ( offset >= mappedSize )
+			return false;
+		
+		quint8 len = mapped[ offset ];
+		filesz -= len;
+		offset += 1 + len;
+	}
+	
+	if ( filesz < 0 || offset + filesz > mappedSize )
+		return false;
+	
+	const char * data = (const char *) mapped + offset;
+	
+	if ( file->compressed() ^ compressToggle )
+	{
+		if ( filesz < 4 )
+			return false;
+		
+		// qUncompress wants the uncompressed size big endian, the archive stores it little endian;
+		// the swap goes into a private copy so that no lock is needed
+		QByteArray packed( data, filesz );
+		char * p = packed.data();
+		std::swap( p[0], p[3] );
+		std::swap( p[1], p[2] );
+		content = qUncompress( packed );
+		return true;
+	}
+	
+	if ( copy )
+		content = QByteArray( data, filesz );
+	else
+		content = QByteArray::fromRawData( data, filesz );
+	return true;
+}
+
 // see bsa.h
 QString BSA::absoluteFilePath( const QString & fn ) const
 {
@@ -40,6 +40,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QFileInfo>
 #include <QHash>
 #include <QMutex>
+#include <QStringList>
 
 //! \file bsa.h BSA file, BSAIterator
 
@@ -80,11 +81,29 @@ public:
 	qint64 fileSize( const QString & ) const override final;
 	//! Returns the contents of the specified file
 	/*!
+	* Safe to call from several threads at once. While the archive is mapped,
+	* files are copied out of the mapping without locking; the contents are
+	* owned by \a content and outlive the archive.
+	*
 	* \param fn The filename to get the contents for
 	* \param content Reference to the byte array that holds the file contents
 	* \return True if successful
 	*/
 	bool fileContents( const QString &, QByteArray & ) override final;
+	//! Returns the contents of the specified file without copying them
+	/*!
+	* Like fileContents(), but an uncompressed file is returned as a view of
+	* the mapping (see QByteArray::fromRawData()). The view is only valid
+	* until the archive is closed or destroyed, so the caller must keep the
+	* archive open for as long as it uses \a content or any copy of it.
+	*
+	* \param fn The filename to get the contents for
+	* \param content Reference to the byte array that views the file contents
+	* \return True if successful
+	*/
+	bool fileView( const QString & fn, QByteArray & content ) override final;
+	//! Returns the paths of all files in the archive, in no particular order; the keys of its name tables
+	QStringList fileList() const override final;
 	
 	//! See QFileInfo::ownerId().
 	uint ownerId( const QString & ) const override final;
@@ -137,14 +156,22 @@ protected:
 	//! Gets the specified file, or null if not found
 	const BSAFile * getFile( QString fn ) const;
 	
+	//! Extracts a file from the mapped archive, without locking; uncompressed files are only viewed unless \a copy
+	bool mappedContents( const BSAFile * file, QByteArray & content, bool copy ) const;
+	
 	//! The %BSA file
 	QFile bsa;
 	//! File info for the %BSA
 	QFileInfo bsaInfo;
 
-	//! Mutual exclusion handler
+	//! Mutual exclusion handler; guards seeking and reading the %BSA file when it is not mapped
 	QMutex bsaMutex;
 	
+	//! The memory mapped %BSA file, or null if it could not be mapped
+	uchar * mapped;
+	//! The size of the mapping
+	qint64 mappedSize;
+	
 	//! The absolute name of the file, e.g. "d:/temp/test.bsa"
 	QString bsaPath;
 	//! The base path of the file, e.g. "d:/temp"
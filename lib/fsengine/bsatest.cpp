@@ -0,0 +1,161 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2012, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+
+/*
+ * Times the extraction of every file in an archive on 1, 4 and 16 threads,
+ * through both BSA::fileContents() and BSA::fileView(), and checks that the
+ * two return the same data.
+ *
+ * Build with bsatest.pro.
+ */
+
+#include "bsa.h"
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <stdio.h> // printf
+
+
+//! Extracts files from a shared list until it runs out
+class ExtractTask final : public QRunnable
+{
+public:
+	ExtractTask( BSA * bsa, const QStringList & files, QAtomicInt & next, bool view )
+		: bsa( bsa ), files( files ), next( next ), view( view )
+	{
+		setAutoDelete( true );
+	}
+
+	void run() override final
+	{
+		QByteArray data;
+
+		for ( int i = next.fetchAndAddRelaxed( 1 ); i < files.count(); i = next.fetchAndAddRelaxed( 1 ) ) {
+			bool ok = view ? bsa->fileView( files[i], data ) : bsa->fileContents( files[i], data );
+
+			if ( ok )
+				bytes += data.size();
+			else
+				failed++;
+		}
+	}
+
+	static QAtomicInt failed;
+	static QAtomicInteger<qint64> bytes;
+
+private:
+	BSA * bsa;
+	const QStringList & files;
+	QAtomicInt & next;
+	bool view;
+};
+
+QAtomicInt ExtractTask::failed;
+QAtomicInteger<qint64> ExtractTask::bytes;
+
+static void benchmark( BSA * bsa, const QStringList & files, int threads, bool view )
+{
+	QThreadPool pool;
+	pool.setMaxThreadCount( threads );
+
+	QAtomicInt next;
+	ExtractTask::failed = 0;
+	ExtractTask::bytes = 0;
+
+	QElapsedTimer timer;
+	timer.start();
+
+	for ( int i = 0; i < threads; i++ )
+		pool.start( new ExtractTask( bsa, files, next, view ) );
+
+	pool.waitForDone();
+
+	double ms = timer.nsecsElapsed() / 1e6;
+	qint64 bytes = ExtractTask::bytes.load();
+
+	printf( "%2d threads, %-12s %8.1f ms, %8.1f MB/s (%d failed)\n",
+		threads, view ? "fileView" : "fileContents", ms,
+		ms > 0 ? bytes / 1048576.0 / ( ms / 1000 ) : 0.0, ExtractTask::failed.load() );
+}
+
+int main( int argc, char * argv[] )
+{
+	QCoreApplication app( argc, argv );
+
+	if ( argc < 2 ) {
+		printf( "usage: bsatest <archive.bsa>\n" );
+		return 2;
+	}
+
+	QString path = QString::fromLocal8Bit( argv[1] );
+
+	if ( !BSA::canOpen( path ) ) {
+		printf( "FAIL %s is not a BSA\n", argv[1] );
+		return 1;
+	}
+
+	BSA bsa( path );
+
+	if ( !bsa.open() ) {
+		printf( "FAIL could not open %s: %s\n", argv[1], qPrintable( bsa.statusText() ) );
+		return 1;
+	}
+
+	QStringList files = bsa.fileList();
+	bool ok = true;
+
+	// fileView() must return the same data as fileContents()
+	for ( const QString & fn : files ) {
+		QByteArray contents, view;
+
+		if ( !bsa.fileContents( fn, contents ) || !bsa.fileView( fn, view ) || contents != view ) {
+			printf( "FAIL %s differs between fileContents() and fileView()\n", qPrintable( fn ) );
+			ok = false;
+		}
+	}
+
+	printf( "%d files in %s\n", files.count(), argv[1] );
+
+	for ( int threads : { 1, 4, 16 } ) {
+		benchmark( &bsa, files, threads, false );
+		benchmark( &bsa, files, threads, true );
+	}
+
+	printf( "%s\n", ok ? "all tests passed" : "some tests failed" );
+
+	return ok ? 0 : 1;
+}
@@ -4,12 +4,12 @@ TARGET   = bsatest
 
 DEFINES += BSA_TEST
 
-CONFIG += qt release thread warn_on console
-LIBS += -lmingw32 -lqtmain
+QT -= gui
+CONFIG += c++11 release thread warn_on console
 
 DESTDIR = ./
 
-HEADERS += *.h
-SOURCES += *.cpp
+HEADERS += bsa.h fsengine.h
+SOURCES += bsa.cpp fsengine.cpp bsatest.cpp
 
-# vim: set filetype=config : 
+# vim: set filetype=config :
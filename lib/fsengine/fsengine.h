@@ -79,7 +79,11 @@ public:
 	virtual bool hasFile( const QString & ) const = 0;
 	virtual qint64 fileSize( const QString & ) const = 0;
 	virtual bool fileContents( const QString &, QByteArray & ) = 0;
+	//! Like fileContents(), but the contents may only be valid while the archive is open
+	virtual bool fileView( const QString & fn, QByteArray & content ) { return fileContents( fn, content ); }
 	virtual QString absoluteFilePath( const QString & ) const = 0;
+	//! Returns the paths of all files in the archive, lower case, in no particular order
+	virtual QStringList fileList() const = 0;
 
 	virtual uint ownerId( const QString & ) const = 0;
 	virtual QString owner( const QString & ) const = 0;
@@ -58,13 +58,30 @@ FSManager* FSManager::get()
 // see fsmanager.h
 QList <FSArchiveFile *> FSManager::archiveList()
 {
+	FSManager * manager = get();
+	QMutexLocker lock( &manager->archivesMutex );
+
 	QList<FSArchiveFile *> archives;
-	for ( FSArchiveHandler* an : get()->archives.values() ) {
+	for ( FSArchiveHandler* an : manager->archives.values() ) {
 		archives.append( an->getArchive() );
 	}
 	return archives;
 }
 
+// see fsmanager.h
+FSArchiveSet FSManager::archiveSet()
+{
+	FSManager * manager = get();
+	QMutexLocker lock( &manager->archivesMutex );
+
+	// each handler holds a reference to its archive, see FSArchiveFile::ref
+	FSArchiveSet archives;
+	for ( FSArchiveHandler* an : manager->archives.values() ) {
+		archives.append( QSharedPointer<FSArchiveHandler>( new FSArchiveHandler( an->getArchive() ) ) );
+	}
+	return archives;
+}
+
 // see fsmanager.h
 FSManager::FSManager( QObject * parent )
 	: QObject( parent ), automatic( false )
@@ -91,6 +108,40 @@ FSManager::~FSManager()
 	qDeleteAll( archives );
 }
 
+// see fsmanager.h
+void FSManager::setArchives( const QStringList & paths )
+{
+	// only the GUI thread changes the map, so it is read here without the lock;
+	// the new archives are opened before taking it, which may take a while
+	QMap<QString, FSArchiveHandler *> opened;
+	for ( const QString & an : paths )
+	{
+		if ( opened.contains( an ) )
+			continue;
+		
+		if ( FSArchiveHandler * a = archives.value( an ) )
+			opened.insert( an, a );
+		else if ( FSArchiveHandler * a = FSArchiveHandler::openArchive( an ) )
+			opened.insert( an, a );
+	}
+	
+	QList<FSArchiveHandler *> removed;
+	for ( auto it = archives.constBegin(); it != archives.constEnd(); ++it )
+	{
+		if ( opened.value( it.key() ) != it.value() )
+			removed.append( it.value() );
+	}
+	
+	emit archivesChanging();
+	{
+		QMutexLocker lock( &archivesMutex );
+		archives.swap( opened );
+	}
+	// an archive held by an archiveSet() is closed once that is released
+	qDeleteAll( removed );
+	emit archivesChanged();
+}
+
 // see fsmanager.h
 QStringList FSManager::regPathBSAList( QString regKey, QString dataDir )
 {
@@ -182,16 +233,7 @@ void FSSelector::sltAuto( bool x )
 {
 	if ( x )
 	{
-		qDeleteAll( manager->archives );
-		manager->archives.clear();
-		
-		for ( const QString an : manager->autodetectArchives() )
-		{
-			if ( FSArchiveHandler * a = FSArchiveHandler::openArchive( an ) )
-			{
-				manager->archives.insert( an, a );
-			}
-		}
+		manager->setArchives( manager->autodetectArchives() );
 		
 		model->setStringList( manager->archives.keys() );
 	}
@@ -207,12 +249,10 @@ void FSSelector::sltAdd()
 {
 	QStringList list = QFileDialog::getOpenFileNames( this, "Select resource files to add", QString(), "BSA (*.bsa)" );
 	
-	for ( const QString an : list )
-	{
-		if ( ! manager->archives.contains( an ) )
-			if ( FSArchiveHandler * a = FSArchiveHandler::openArchive( an ) )
-				manager->archives.insert( an, a );
-	}
+	if ( list.isEmpty() )
+		return;
+	
+	manager->setArchives( manager->archives.keys() + list );
 	
 	model->setStringList( manager->archives.keys() );
 }
@@ -220,18 +260,19 @@ void FSSelector::sltAdd()
 void FSSelector::sltDel()
 {
 	QString an = view->currentIndex().data( Qt::DisplayRole ).toString();
-	if ( FSArchiveHandler * a = manager->archives.take( an ) )
-	{
-		delete a;
-	}
+	if ( ! manager->archives.contains( an ) )
+		return;
+	
+	QStringList list = manager->archives.keys();
+	list.removeAll( an );
+	manager->setArchives( list );
 	
 	model->setStringList( manager->archives.keys() );
 }
 
 void FSSelector::sltDelAll()
 {
-	qDeleteAll( manager->archives );
-	manager->archives.clear();
+	manager->setArchives( QStringList() );
 
 	model->setStringList( QStringList() );
 }
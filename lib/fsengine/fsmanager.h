@@ -38,11 +38,16 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QDialog>
 #include <QObject>
 #include <QMap>
+#include <QMutex>
+#include <QSharedPointer>
 
 
 class FSArchiveHandler;
 class FSArchiveFile;
 
+//! A snapshot of the registered archives; they stay open while it is held, even once removed from the manager
+typedef QList<QSharedPointer<FSArchiveHandler>> FSArchiveSet;
+
 //! The file system manager class.
 class FSManager : public QObject
 {
@@ -51,7 +56,14 @@ public:
 	//! Gets the global file system manager
 	static FSManager * get();
 	//! Gets the list of globally registered BSA files
+	/*!
+	 * The archives are closed when they are removed, after archivesChanging();
+	 * code that may still read them then, e.g. on another thread, holds an
+	 * archiveSet() instead.
+	 */
 	static QList<FSArchiveFile *> archiveList();
+	//! Gets a snapshot of the globally registered BSA files; safe to call from any thread
+	static FSArchiveSet archiveSet();
 
 protected:
 	//! Constructor
@@ -62,9 +74,20 @@ protected:
 public slots:
 	//! Launches a FSSelector dialog
 	void selectArchives();
+
+signals:
+	//! Emitted before archives are removed; those from archiveList() may be closed once it returns
+	void archivesChanging();
+	//! Emitted after archives were added or removed
+	void archivesChanged();
 	
 protected:
+	//! Replaces the registered archives with the ones at the given paths, keeping those already open
+	void setArchives( const QStringList & paths );
+
 	QMap<QString, FSArchiveHandler *> archives;
+	//! Guards archives; it is only changed on the GUI thread, but read from any
+	mutable QMutex archivesMutex;
 	bool automatic;
 	
 	//! Builds a list of global BSAs on Windows platforms
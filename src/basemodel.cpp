@@ -41,12 +41,37 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QFileInfo>
 #include <QTime>
 
+#include <algorithm> // std::sort
+
 //! \file basemodel.cpp BaseModel and BaseModelEval
 
-BaseModel::BaseModel( QObject * parent ) : QAbstractItemModel( parent )
+BaseModel::BaseModel( QObject * parent ) : QAbstractItemModel( parent ), editDepth( 0 ), editAborted( false )
 {
 	msgMode = EmitMessages;
+	headless = false;
 	root = new NifItem( 0 );
+
+	// Items are deleted after these signals; drop any batched edits recorded for them
+	connect( this, &BaseModel::rowsAboutToBeRemoved, this, [this]( const QModelIndex & parent, int first, int last ) {
+		if ( editValues.isEmpty() && editRows.isEmpty() && editBlocks.isEmpty() )
+			return;
+
+		NifItem * item = parent.isValid() ? static_cast<NifItem *>( parent.internalPointer() ) : root;
+
+		// the rows of a packed array have no items to forget
+		if ( item->isPacked() )
+			return;
+
+		for ( int r = first; r <= last; r++ ) {
+			if ( NifItem * child = item->child( r ) )
+				forgetEdits( child );
+		}
+	} );
+	connect( this, &BaseModel::modelAboutToBeReset, this, [this]() {
+		editValues.clear();
+		editRows.clear();
+		editBlocks.clear();
+	} );
 }
 
 BaseModel::~BaseModel()
@@ -62,7 +87,10 @@ void BaseModel::msg( const Message & m ) const
 		return;
 	case CollectMessages:
 	default:
-		messages.append( m );
+		{
+			QMutexLocker lock( &messageLock );
+			messages.append( m );
+		}
 		return;
 	}
 }
@@ -146,6 +174,19 @@ NifValue BaseModel::getValue( const QModelIndex & index ) const
 	return item->value();
 }
 
+NifValue BaseModel::getValue( const QModelIndex & iArray, int row ) const
+{
+	const NifItem * item = static_cast<NifItem *>( iArray.internalPointer() );
+
+	if ( !( iArray.isValid() && item && iArray.model() == this ) || row < 0 || row >= item->childCount() )
+		return NifValue();
+
+	if ( item->isPacked() )
+		return item->packedValue( row );
+
+	return item->child( row )->value();
+}
+
 // where is
 // NifValue BaseModel::getValue( const QModelIndex & parent, const QString & name ) const
 // ?
@@ -247,6 +288,142 @@ bool BaseModel::setValue( const QModelIndex & parent, const QString & name, cons
 }
 
 
+/*
+ *  batched edits
+ */
+
+void BaseModel::beginEdits()
+{
+	if ( editDepth++ == 0 ) {
+		editAborted = false;
+		editsBegun();
+	}
+}
+
+void BaseModel::commitEdits()
+{
+	if ( editDepth == 0 )
+		return;
+
+	if ( --editDepth == 0 )
+		endEdits();
+}
+
+void BaseModel::rollbackEdits()
+{
+	if ( editDepth == 0 )
+		return;
+
+	editAborted = true;
+
+	if ( --editDepth == 0 )
+		endEdits();
+}
+
+void BaseModel::endEdits()
+{
+	if ( editAborted ) {
+		for ( auto it = editValues.cbegin(); it != editValues.cend(); ++it )
+			it.key()->value() = it.value();
+
+		// the array may have been unpacked since; its items were created from the packed rows
+		for ( auto it = editRows.cbegin(); it != editRows.cend(); ++it ) {
+			NifItem * array = it.key();
+			const QByteArray & rows = it.value();
+
+			if ( array->isPacked() ) {
+				array->setPackedData( rows );
+			} else if ( array->childCount() > 0 ) {
+				int size = NifValue::packedSize( array->child( 0 )->value().type() );
+				int count = qMin( array->childCount(), rows.size() / size );
+
+				for ( int r = 0; r < count; r++ )
+					array->child( r )->value().fromPacked( rows.constData() + r * size );
+			}
+		}
+	}
+
+	QVector<NifItem *> blocks;
+	blocks.reserve( editBlocks.count() );
+
+	for ( NifItem * block : editBlocks )
+		blocks.append( block );
+
+	std::sort( blocks.begin(), blocks.end(), []( NifItem * a, NifItem * b ) { return a->row() < b->row(); } );
+
+	editValues.clear();
+	editRows.clear();
+	editBlocks.clear();
+
+	editsEnded( editAborted );
+
+	for ( NifItem * block : blocks )
+		emit dataChanged( createIndex( block->row(), NameCol, block ), createIndex( block->row(), ValueCol, block ) );
+}
+
+void BaseModel::recordEdit( NifItem * item, NifItem * block )
+{
+	if ( !editValues.contains( item ) )
+		editValues.insert( item, item->value() );
+
+	recordBlock( block );
+}
+
+void BaseModel::recordBlock( NifItem * block )
+{
+	while ( block->parent() && block->parent() != root )
+		block = block->parent();
+
+	editBlocks.insert( block );
+}
+
+void BaseModel::childrenEditing( NifItem * parent )
+{
+	if ( !editDepth || !parent->childCount() )
+		return;
+
+	// keep the rows of a packed array packed; child() would create an item per row
+	if ( parent->isPacked() ) {
+		if ( !editRows.contains( parent ) )
+			editRows.insert( parent, parent->packedData() );
+
+		recordBlock( parent );
+		return;
+	}
+
+	recordEdit( parent->child( 0 ), parent );
+
+	for ( int c = 1; c < parent->childCount(); c++ ) {
+		NifItem * child = parent->child( c );
+
+		if ( !editValues.contains( child ) )
+			editValues.insert( child, child->value() );
+	}
+}
+
+void BaseModel::forgetEdits( NifItem * item )
+{
+	editValues.remove( item );
+	editRows.remove( item );
+	editBlocks.remove( item );
+
+	// the rows of a packed array have no items to forget
+	if ( item->isPacked() )
+		return;
+
+	for ( int c = 0; c < item->childCount(); c++ )
+		forgetEdits( item->child( c ) );
+}
+
+void BaseModel::itemsChanged( NifItem * first, NifItem * last )
+{
+	if ( editDepth )
+		return;
+
+	emit dataChanged( createIndex( first->row(), ValueCol, first ), createIndex( last->row(), ValueCol, last ) );
+}
+
+
 /*
  *  QAbstractModel interface
  */
@@ -260,10 +437,11 @@ QModelIndex BaseModel::index( int row, int column, const QModelIndex & parent )
 	else
 		parentItem = static_cast<NifItem *>( parent.internalPointer() );
 
-	NifItem * childItem = ( parentItem ? parentItem->child( row ) : 0 );
+	// the const lookup, so that the rows of a packed array stay packed; see fetchMore()
+	const NifItem * childItem = ( parentItem ? static_cast<const NifItem *>( parentItem )->child( row ) : 0 );
 
 	if ( childItem )
-		return createIndex( row, column, childItem );
+		return createIndex( row, column, const_cast<NifItem *>( childItem ) );
 
 	return QModelIndex();
 }
@@ -298,6 +476,20 @@ int BaseModel::rowCount( const QModelIndex & parent ) const
 	return ( parentItem ? parentItem->childCount() : 0 );
 }
 
+bool BaseModel::canFetchMore( const QModelIndex & parent ) const
+{
+	NifItem * item = static_cast<NifItem *>( parent.internalPointer() );
+
+	return parent.isValid() && parent.model() == this && item && item->isPacked();
+}
+
+void BaseModel::fetchMore( const QModelIndex & parent )
+{
+	// the row count does not change, the rows only get items an index can point to
+	if ( canFetchMore( parent ) )
+		static_cast<NifItem *>( parent.internalPointer() )->unpack();
+}
+
 QVariant BaseModel::data( const QModelIndex & index, int role ) const
 {
 	NifItem * item = static_cast<NifItem *>( index.internalPointer() );
@@ -576,6 +768,66 @@ bool BaseModel::saveToFile( const QString & filename ) const
  *  searching
  */
 
+NifItem * BaseModel::getChild( NifItem * item, const QString & name, const NifFieldKey * key ) const
+{
+	childrenNeeded( item );
+
+	// The rows of a packed array are values, not named fields; don't unpack the
+	// array to search them, since this also runs on the workers of NifModel::save()
+	if ( item->isPacked() )
+		return 0;
+
+	const NifBlock * layout = item->layout();
+
+	// The rows are only trusted while the item still has the children it was built with
+	int id = -1;
+
+	if ( layout && layout->schema && item->childCount() == layout->fieldCount )
+		id = key ? key->id( *layout->schema ) : NifFieldKey::find( *layout->schema, name );
+
+	if ( id >= 0 ) {
+		auto it = layout->fieldRows.constFind( id );
+
+		// A name that is no field of the layout may still name a row, e.g. one that
+		// replaced a field while the count stayed the same; the scan below finds it
+		if ( it != layout->fieldRows.constEnd() ) {
+			bool stale = false;
+
+			for ( int r : it.value() ) {
+				NifItem * child = item->child( r );
+
+				if ( !child || child->name() != name ) {
+					stale = true;
+					break;
+				}
+
+				if ( evalCondition( child ) )
+					return child;
+			}
+
+			if ( !stale )
+				return 0;
+		}
+	}
+
+	for ( int c = 0; c < item->childCount(); c++ ) {
+		NifItem * child = item->child( c );
+
+		if ( child && child->name() == name && evalCondition( child ) )
+			return child;
+	}
+
+	return 0;
+}
+
+NifItem * BaseModel::getItem( NifItem * item, const NifFieldKey & key ) const
+{
+	if ( !item || item == root )
+		return 0;
+
+	return getChild( item, key.name(), &key );
+}
+
 NifItem * BaseModel::getItem( NifItem * item, const QString & name ) const
 {
 	if ( !item || item == root )
@@ -593,14 +845,7 @@ NifItem * BaseModel::getItem( NifItem * item, const QString & name ) const
 		return getItem( getItem( item, left ), right );
 	}
 
-	for ( int c = 0; c < item->childCount(); c++ ) {
-		NifItem * child = item->child( c );
-
-		if ( child->name() == name && evalCondition( child ) )
-			return child;
-	}
-
-	return 0;
+	return getChild( item, name, nullptr );
 }
 
 /*
@@ -652,6 +897,21 @@ QModelIndex BaseModel::getIndex( const QModelIndex & parent, const QString & nam
 	return QModelIndex();
 }
 
+QModelIndex BaseModel::getIndex( const QModelIndex & parent, const NifFieldKey & key ) const
+{
+	NifItem * parentItem = static_cast<NifItem *>( parent.internalPointer() );
+
+	if ( !( parent.isValid() && parentItem && parent.model() == this ) )
+		return QModelIndex();
+
+	NifItem * item = getItem( parentItem, key );
+
+	if ( item )
+		return createIndex( item->row(), 0, item );
+
+	return QModelIndex();
+}
+
 /*
  *  conditions and version
  */
@@ -672,61 +932,64 @@ public:
 	}
 
 	//! Evaluation function
-	QVariant operator()( const QVariant & v ) const
+	quint32 operator()( const QString & name ) const
 	{
-		if ( v.type() == QVariant::String ) {
-			QString left = v.toString();
-			const NifItem * i = item;
+		QString left = name;
+		const NifItem * i = item;
 
-			// resolve "ARG"
-			while ( left == "ARG" ) {
-				if ( !i->parent() )
-					return false;
+		// resolve "ARG"
+		while ( left == "ARG" ) {
+			if ( !i->parent() )
+				return 0;
 
-				i = i->parent();
-				left = i->arg();
-			}
+			i = i->parent();
+			left = i->arg();
+		}
 
-			// resolve reference to sibling
-			const NifItem * sibling = model->getItem( i->parent(), left );
-
-			if ( sibling ) {
-				if ( sibling->value().isCount() ) {
-					return QVariant( sibling->value().toCount() );
-				} else if ( sibling->value().isFileVersion() ) {
-					return QVariant( sibling->value().toFileVersion() );
-				// this is tricky to understand
-				// we check whether the reference is an array
-				// if so, we get the current item's row number (i->row())
-				// and get the sibling's child at that row number
-				// this is used for instance to describe array sizes of strips
-				} else if ( sibling->childCount() > 0 ) {
-					const NifItem * i2 = sibling->child( i->row() );
-
-					if ( i2 && i2->value().isCount() )
-						return QVariant( i2->value().toCount() );
-				} else {
-					qDebug() << ("can't convert " + left + " to a count");
+		// resolve reference to sibling
+		const NifItem * sibling = model->getItem( i->parent(), left );
+
+		if ( sibling ) {
+			if ( sibling->value().isCount() ) {
+				return sibling->value().toCount();
+			} else if ( sibling->value().isFileVersion() ) {
+				return sibling->value().toFileVersion();
+			// this is tricky to understand
+			// we check whether the reference is an array
+			// if so, we get the current item's row number (i->row())
+			// and get the sibling's child at that row number
+			// this is used for instance to describe array sizes of strips
+			} else if ( sibling->isPacked() ) {
+				if ( i->row() < sibling->childCount() ) {
+					NifValue count = sibling->packedValue( i->row() );
+
+					if ( count.isCount() )
+						return count.toCount();
 				}
-			}
+			} else if ( sibling->childCount() > 0 ) {
+				const NifItem * i2 = sibling->child( i->row() );
 
-			// resolve reference to block type
-			// is the condition string a type?
-			if ( model->isAncestorOrNiBlock( left ) ) {
-				// get the type of the current block
-				const NifItem * block = i;
+				if ( i2 && i2->value().isCount() )
+					return i2->value().toCount();
+			} else {
+				qDebug() << ("can't convert " + left + " to a count");
+			}
+		}
 
-				while ( block->parent() && block->parent()->parent() ) {
-					block = block->parent();
-				}
+		// resolve reference to block type
+		// is the condition string a type?
+		if ( model->isAncestorOrNiBlock( left ) ) {
+			// get the type of the current block
+			const NifItem * block = i;
 
-				return QVariant( model->inherits( block->name(), left ) );
+			while ( block->parent() && block->parent()->parent() ) {
+				block = block->parent();
 			}
 
-			return QVariant( 0 );
+			return model->inherits( block->name(), left );
 		}
 
-		return v;
+		return 0;
 	}
 };
 
@@ -751,11 +1014,7 @@ bool BaseModel::evalCondition( NifItem * item, bool chkParents ) const
 		if ( !evalCondition( item->parent(), true ) )
 			return false;
 
-
-
-	QString cond = item->cond();
-
-	if ( cond.isEmpty() )
+	if ( item->condexpr().isEmpty() )
 		return true;
 
 	BaseModelEval functor( this, item );
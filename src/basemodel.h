@@ -39,7 +39,10 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <QAbstractItemModel> // Inherited
 #include <QFileInfo>
+#include <QHash>
 #include <QIODevice>
+#include <QMutex>
+#include <QSet>
 #include <QString>
 #include <QVariant>
 #include <QVector>
@@ -129,13 +132,19 @@ public:
 	template <typename T> T get( const QModelIndex & index ) const;
 	//! Get an item by name.
 	template <typename T> T get( const QModelIndex & parent, const QString & name ) const;
+	//! Get an item by field key.
+	template <typename T> T get( const QModelIndex & parent, const NifFieldKey & key ) const;
 	//! Set an item.
 	template <typename T> bool set( const QModelIndex & index, const T & d );
 	//! Set an item by name.
 	template <typename T> bool set( const QModelIndex & parent, const QString & name, const T & v );
+	//! Set an item by field key.
+	template <typename T> bool set( const QModelIndex & parent, const NifFieldKey & key, const T & v );
 
 	//! Get an item as a NifValue.
 	NifValue getValue( const QModelIndex & index ) const;
+	//! Get a row of an array as a NifValue; the rows of a packed array have no index, but a value.
+	NifValue getValue( const QModelIndex & iArray, int row ) const;
 	/* Not implemented? */
 	// Get an item as a NifValue by name.
 	//NifValue getValue( const QModelIndex & parent, const QString & name ) const;
@@ -145,6 +154,28 @@ public:
 	//! Set an item from a NifValue by name.
 	bool setValue( const QModelIndex & parent, const QString & name, const NifValue & v );
 
+	//! Begin a batch of edits.
+	/*!
+	 * Until the batch ends, changing a value only records it: no dataChanged is
+	 * emitted. Batches nest; only the outermost commitEdits() or rollbackEdits()
+	 * ends the batch.
+	 */
+	void beginEdits();
+	//! End a batch of edits, emitting one dataChanged per changed block.
+	/*!
+	 * The signal spans the block row from NameCol to ValueCol; any item of the
+	 * block may have changed. If a nested batch was rolled back, the whole batch is.
+	 */
+	void commitEdits();
+	//! End a batch of edits, restoring every value it changed.
+	/*!
+	 * Rows inserted or removed during the batch are not restored, and values of
+	 * removed or moved rows are forgotten.
+	 */
+	void rollbackEdits();
+	//! Is a batch of edits in progress?
+	bool isEditing() const { return editDepth > 0; }
+
 	// get item attributes
 	//! Get the item name.
 	QString itemName( const QModelIndex & index ) const;
@@ -169,6 +200,8 @@ public:
 
 	//! Find a branch by name.
 	QModelIndex getIndex( const QModelIndex & parent, const QString & name ) const;
+	//! Find a branch by field key.
+	QModelIndex getIndex( const QModelIndex & parent, const NifFieldKey & key ) const;
 
 	//! Evaluate condition and version.
 	bool evalCondition( const QModelIndex & idx, bool chkParents = false ) const;
@@ -215,6 +248,10 @@ public:
 
 	//! Finds the number of rows
 	int rowCount( const QModelIndex & parent = QModelIndex() ) const override;
+	//! Whether \a parent is a packed array, whose rows have no index until fetchMore()
+	bool canFetchMore( const QModelIndex & parent ) const override;
+	//! Unpacks the packed array \a parent, so that its rows can be shown and edited
+	void fetchMore( const QModelIndex & parent ) override;
 	//! Finds the number of columns
 	int columnCount( const QModelIndex & parent = QModelIndex() ) const override { Q_UNUSED( parent ); return NumColumns; }
 
@@ -247,7 +284,15 @@ public:
 	//! Set the Message mode
 	void setMessageMode( MsgMode m ) { msgMode = m; }
 	//! Get Messages collected
-	QList<Message> getMessages() const { QList<Message> lst = messages; messages.clear(); return lst; }
+	QList<Message> getMessages() const { QMutexLocker lock( &messageLock ); QList<Message> lst = messages; messages.clear(); return lst; }
+
+	//! Set whether the model is processed without windows, as in batch mode
+	void setHeadless( bool h ) { headless = h; }
+	//! Whether spells must report through msg() instead of opening dialogs, see Spell::inform()
+	bool isHeadless() const { return headless; }
+
+	//! Handle a message
+	void msg( const Message & m ) const;
 
 signals:
 	//! Messaging signal
@@ -265,6 +310,12 @@ protected:
 
 	//! Get an item
 	virtual NifItem * getItem( NifItem * parent, const QString & name ) const;
+	//! Get a child item by field key
+	NifItem * getItem( NifItem * parent, const NifFieldKey & key ) const;
+	//! Get the first child named name whose condition holds; key is the interned name, if the caller has one
+	NifItem * getChild( NifItem * parent, const QString & name, const NifFieldKey * key ) const;
+	//! Called before the children of \a parent are searched by name
+	virtual void childrenNeeded( NifItem * parent ) const { Q_UNUSED( parent ); }
 	//! Get an item by name
 	NifItem * getItemX( NifItem * item, const QString & name ) const;   // find upwards
 	//! Find an item by name
@@ -272,6 +323,8 @@ protected:
 
 	//! Get an item by name
 	template <typename T> T get( NifItem * parent, const QString & name ) const;
+	//! Get an item by field key
+	template <typename T> T get( NifItem * parent, const NifFieldKey & key ) const;
 	//! Get an item
 	template <typename T> T get( NifItem * item ) const;
 
@@ -297,6 +350,20 @@ protected:
 	//! Set the header string
 	virtual bool setHeaderString( const QString & ) = 0;
 
+	//! Record the value of an item about to change, if a batch of edits is in progress
+	void itemEditing( NifItem * item ) { if ( editDepth ) recordEdit( item, item ); }
+	//! Record the values of the children of an item about to change
+	void childrenEditing( NifItem * parent );
+	//! Signal that the values of the sibling items \a first to \a last changed
+	void itemsChanged( NifItem * first, NifItem * last );
+	//! Signal that the value of an item changed
+	void itemChanged( NifItem * item ) { itemsChanged( item, item ); }
+
+	//! Called when the outermost batch of edits begins
+	virtual void editsBegun() {}
+	//! Called when the outermost batch of edits ends, before its changes are signalled
+	virtual void editsEnded( bool rolledBack ) { Q_UNUSED( rolledBack ); }
+
 	//! The root item
 	NifItem * root;
 
@@ -313,9 +380,31 @@ protected:
 	MsgMode msgMode;
 	//! A list of messages
 	mutable QList<Message> messages;
-
-	//! Handle a message
-	void msg( const Message & m ) const;
+	//! Guards messages, which worker threads may collect into
+	mutable QMutex messageLock;
+	//! Whether the model is processed without windows
+	bool headless;
+
+private:
+	//! Nesting depth of beginEdits()
+	int editDepth;
+	//! Whether a nested batch of edits was rolled back
+	bool editAborted;
+	//! The values of the items changed by the batch, before their first change
+	QHash<NifItem *, NifValue> editValues;
+	//! The rows of packed arrays changed by the batch, before their first change, see NifItem::packedData()
+	QHash<NifItem *, QByteArray> editRows;
+	//! The top-level items of the blocks changed by the batch
+	QSet<NifItem *> editBlocks;
+
+	//! Record an item and the block containing it
+	void recordEdit( NifItem * item, NifItem * block );
+	//! Record the block containing an item
+	void recordBlock( NifItem * block );
+	//! Forget the recorded items in the subtree of \a item
+	void forgetEdits( NifItem * item );
+	//! End the outermost batch of edits
+	void endEdits();
 
 	friend class NifIStream;
 	friend class NifOStream;
@@ -348,6 +437,31 @@ template <typename T> inline T BaseModel::get( const QModelIndex & parent, const
 	return T();
 }
 
+template <typename T> inline T BaseModel::get( NifItem * parent, const NifFieldKey & key ) const
+{
+	NifItem * item = getItem( parent, key );
+
+	if ( item )
+		return item->value().get<T>();
+
+	return T();
+}
+
+template <typename T> inline T BaseModel::get( const QModelIndex & parent, const NifFieldKey & key ) const
+{
+	NifItem * parentItem = static_cast<NifItem *>( parent.internalPointer() );
+
+	if ( !( parent.isValid() && parentItem && parent.model() == this ) )
+		return T();
+
+	NifItem * item = getItem( parentItem, key );
+
+	if ( item )
+		return item->value().get<T>();
+
+	return T();
+}
+
 template <typename T> inline bool BaseModel::set( NifItem * parent, const QString & name, const T & d )
 {
 	NifItem * item = getItem( parent, name );
@@ -373,6 +487,21 @@ template <typename T> inline bool BaseModel::set( const QModelIndex & parent, co
 	return false;
 }
 
+template <typename T> inline bool BaseModel::set( const QModelIndex & parent, const NifFieldKey & key, const T & d )
+{
+	NifItem * parentItem = static_cast<NifItem *>( parent.internalPointer() );
+
+	if ( !( parent.isValid() && parentItem && parent.model() == this ) )
+		return false;
+
+	NifItem * item = getItem( parentItem, key );
+
+	if ( item )
+		return set( item, d );
+
+	return false;
+}
+
 template <typename T> inline T BaseModel::get( NifItem * item ) const
 {
 	return item->value().get<T>();
@@ -390,8 +519,10 @@ template <typename T> inline T BaseModel::get( const QModelIndex & index ) const
 
 template <typename T> inline bool BaseModel::set( NifItem * item, const T & d )
 {
+	itemEditing( item );
+
 	if ( item->value().set( d ) ) {
-		emit dataChanged( createIndex( item->row(), ValueCol, item ), createIndex( item->row(), ValueCol, item ) );
+		itemChanged( item );
 		return true;
 	}
 
@@ -428,11 +559,15 @@ template <typename T> inline void BaseModel::setArray( const QModelIndex & iArra
 	NifItem * item = static_cast<NifItem *>( iArray.internalPointer() );
 
 	if ( isArray( iArray ) && item && iArray.model() == this ) {
+		childrenEditing( item );
 		item->setArray<T>( array );
 		int x = item->childCount() - 1;
 
-		if ( x >= 0 )
-			emit dataChanged( createIndex( 0, ValueCol, item->child( 0 ) ), createIndex( x, ValueCol, item->child( x ) ) );
+		// rows of a packed array have no indexes yet, the array item stands for them
+		if ( item->isPacked() )
+			itemChanged( item );
+		else if ( x >= 0 )
+			itemsChanged( item->child( 0 ), item->child( x ) );
 	}
 }
 
@@ -0,0 +1,842 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2012, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+#include "batch.h"
+
+#include "nifmodel.h"
+#include "spellbook.h"
+#include "gl/glscene.h"
+#include "gl/gltex.h"
+
+#include <QBuffer>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QPersistentModelIndex>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+
+//! \file batch.cpp BatchProcessor, BatchWorker
+
+//! Runs BatchProcessor::work() on a pool thread.
+class BatchWorker final : public QRunnable
+{
+public:
+	BatchWorker( BatchProcessor * b ) : batch( b ) {}
+
+	void run() override final { batch->work(); }
+
+protected:
+	BatchProcessor * batch;
+};
+
+//! Summarizes the time of each pass in ms
+static QJsonObject timings( const QVector<double> & times )
+{
+	QJsonObject t;
+
+	if ( times.isEmpty() )
+		return t;
+
+	double total = 0;
+
+	for ( double ms : times )
+		total += ms;
+
+	t["min"] = *std::min_element( times.begin(), times.end() );
+	t["mean"] = total / times.count();
+	t["passes"] = times.count();
+
+	return t;
+}
+
+//! Parses every block that loading deferred, see Options::lazyBlockLoading()
+static void parseBlocks( NifModel & nif )
+{
+	for ( int b = 0; b < nif.getBlockCount(); b++ )
+		nif.fetchMore( nif.index( b + 1, 0 ) );
+}
+
+//! Times loading the file again, into the same model
+static QJsonObject benchLoad( NifModel & nif, const QString & file, int passes )
+{
+	QVector<double> loadTimes, parseTimes;
+	QElapsedTimer timer;
+
+	for ( int p = 0; p < passes; p++ ) {
+		timer.start();
+
+		if ( !nif.loadFromFile( file ) )
+			break;
+
+		loadTimes.append( timer.nsecsElapsed() / 1e6 );
+		timer.restart();
+
+		parseBlocks( nif );
+
+		parseTimes.append( timer.nsecsElapsed() / 1e6 );
+	}
+
+	QJsonObject result;
+	result["load"] = timings( loadTimes );
+	result["parse"] = timings( parseTimes );
+
+	return result;
+}
+
+//! Appends the values that are saved below \a parent, in file order
+static void collectValues( NifModel & nif, const QModelIndex & parent, QVector<NifValue> & values )
+{
+	for ( int r = 0; r < nif.rowCount( parent ); r++ ) {
+		QModelIndex child = nif.index( r, 0, parent );
+
+		// the rows of a packed array have no index
+		if ( !child.isValid() ) {
+			values.append( nif.getValue( parent, r ) );
+			continue;
+		}
+
+		NifItem * item = static_cast<NifItem *>( child.internalPointer() );
+
+		if ( item->isAbstract() || !nif.evalCondition( child ) )
+			continue;
+
+		if ( !item->arr1().isEmpty() || !item->arr2().isEmpty() || nif.rowCount( child ) > 0 )
+			collectValues( nif, child, values );
+		else
+			values.append( nif.getValue( child ) );
+	}
+}
+
+//! Times decoding all values of the file with NifIStream, without building any items
+static QJsonObject benchRead( NifModel & nif, const QString & file, int passes )
+{
+	Q_UNUSED( file );
+
+	QVector<NifValue> values;
+	collectValues( nif, QModelIndex(), values );
+
+	QBuffer buffer;
+	buffer.open( QIODevice::ReadWrite );
+
+	{
+		NifOStream out( &nif, &buffer );
+
+		for ( const NifValue & v : values )
+			out.write( v );
+	}
+
+	// the first pass is not timed; it brings the buffer and the values into the caches
+	QVector<double> times;
+	QElapsedTimer timer;
+
+	for ( int p = -1; p < passes; p++ ) {
+		buffer.seek( 0 );
+		timer.start();
+
+		NifIStream in( &nif, &buffer );
+
+		for ( NifValue & v : values ) {
+			if ( !in.read( v ) )
+				return QJsonObject();
+		}
+
+		if ( p >= 0 )
+			times.append( timer.nsecsElapsed() / 1e6 );
+	}
+
+	QJsonObject result;
+	result["read"] = timings( times );
+	result["values"] = values.count();
+	result["bytes"] = buffer.size();
+
+	return result;
+}
+
+//! Loads a file repeatedly into a model of its own; run by benchStress() on each thread
+class StressWorker final : public QRunnable
+{
+public:
+	StressWorker( const QString & f, int p ) : file( f ), passes( p ) {}
+
+	void run() override final
+	{
+		NifModel nif;
+		nif.setMessageMode( BaseModel::CollectMessages );
+		nif.setHeadless( true );
+
+		for ( int p = 0; p < passes; p++ ) {
+			nif.loadFromFile( file );
+			parseBlocks( nif );
+		}
+	}
+
+protected:
+	QString file;
+	int passes;
+};
+
+//! Times loading the file on 1 to 32 threads at once, each with a model of its own
+static QJsonObject benchStress( NifModel & nif, const QString & file, int passes )
+{
+	Q_UNUSED( nif );
+
+	QJsonObject result;
+	QElapsedTimer timer;
+
+	for ( int threads = 1; threads <= 32; threads *= 2 ) {
+		QThreadPool pool;
+		pool.setMaxThreadCount( threads );
+
+		timer.start();
+
+		for ( int t = 0; t < threads; t++ )
+			pool.start( new StressWorker( file, passes ) );
+
+		pool.waitForDone();
+
+		double ms = timer.nsecsElapsed() / 1e6;
+
+		// loads per second; with no contention this grows linearly until the cores run out
+		QJsonObject run;
+		run["time"] = ms;
+		run["loadsPerSecond"] = threads * passes * 1000.0 / ms;
+		result[QString::number( threads )] = run;
+	}
+
+	return result;
+}
+
+//! Times stepping the scene through every animation sequence of the file, frame by frame
+static QJsonObject benchPlayback( NifModel & nif, const QString & file, int passes )
+{
+	Q_UNUSED( file );
+
+	const int frames = 1000;
+
+	TexCache textures;
+	Scene scene( &textures, nullptr, nullptr );
+	scene.make( &nif );
+
+	QStringList groups = scene.animGroups;
+
+	if ( groups.isEmpty() )
+		groups << QString();
+
+	QJsonObject result;
+
+	for ( const QString & group : groups ) {
+		scene.setSequence( group );
+
+		float start = scene.timeMin();
+		float length = scene.timeMax() - start;
+
+		QVector<double> playTimes, scrubTimes;
+		QElapsedTimer timer;
+
+		for ( int p = 0; p < passes; p++ ) {
+			timer.start();
+
+			for ( int f = 0; f < frames; f++ )
+				scene.transform( Transform(), start + length * f / frames );
+
+			playTimes.append( timer.nsecsElapsed() / 1e6 / frames );
+			timer.restart();
+
+			// jumping around, as when dragging the time slider
+			quint32 r = 1;
+
+			for ( int f = 0; f < frames; f++ ) {
+				r = r * 1103515245 + 12345;
+				scene.transform( Transform(), start + length * ( ( r >> 8 ) % frames ) / frames );
+			}
+
+			scrubTimes.append( timer.nsecsElapsed() / 1e6 / frames );
+		}
+
+		QJsonObject sequence;
+		sequence["play"] = timings( playTimes );
+		sequence["scrub"] = timings( scrubTimes );
+		result[group.isEmpty() ? QString( "(none)" ) : group] = sequence;
+	}
+
+	return result;
+}
+
+//! Times the row lookups that block numbers and tree views depend on
+static QJsonObject benchRows( NifModel & nif, const QString & file, int passes )
+{
+	Q_UNUSED( file );
+
+	parseBlocks( nif );
+
+	QVector<QModelIndex> blocks;
+
+	for ( int b = 0; b < nif.getBlockCount(); b++ )
+		blocks.append( nif.getBlock( b ) );
+
+	QVector<double> numberTimes, viewTimes;
+	QElapsedTimer timer;
+	qint64 check = 0;
+
+	for ( int p = 0; p < passes; p++ ) {
+		timer.start();
+
+		for ( const QModelIndex & iBlock : blocks )
+			check += nif.getBlockNumber( iBlock );
+
+		numberTimes.append( timer.nsecsElapsed() / 1e6 );
+		timer.restart();
+
+		// what a tree view asks for every row it shows
+		for ( const QModelIndex & iBlock : blocks ) {
+			for ( int r = 0; r < nif.rowCount( iBlock ); r++ )
+				check += nif.parent( nif.index( r, 0, iBlock ) ).row();
+		}
+
+		viewTimes.append( timer.nsecsElapsed() / 1e6 );
+	}
+
+	QJsonObject result;
+	result["blockNumber"] = timings( numberTimes );
+	result["indexParent"] = timings( viewTimes );
+	result["blocks"] = blocks.count();
+	result["check"] = double( check );
+
+	return result;
+}
+
+//! Times updating the scene after moving the vertex at iVertex, against rebuilding all of it
+static QJsonObject timeEdit( NifModel & nif, const QModelIndex & iVertex, int passes )
+{
+	QJsonObject result;
+
+	if ( !iVertex.isValid() )
+		return result;
+
+	TexCache textures;
+	Scene scene( &textures, nullptr, nullptr );
+	scene.make( &nif );
+
+	Vector3 v = nif.get<Vector3>( iVertex );
+
+	// the first update after building the scene also indexes its dependencies
+	scene.update( &nif, iVertex );
+
+	QVector<double> editTimes, fullTimes;
+	QElapsedTimer timer;
+
+	for ( int p = 0; p < passes; p++ ) {
+		v[0] += ( p & 1 ) ? -1.0f : 1.0f;
+		nif.set<Vector3>( iVertex, v );
+
+		timer.start();
+		scene.update( &nif, iVertex );
+		editTimes.append( timer.nsecsElapsed() / 1e6 );
+
+		timer.restart();
+		scene.update( &nif, QModelIndex() );
+		fullTimes.append( timer.nsecsElapsed() / 1e6 );
+	}
+
+	result["edit"] = timings( editTimes );
+	result["full"] = timings( fullTimes );
+	result["nodes"] = scene.nodes.list().count();
+	result["properties"] = scene.properties.list().count();
+
+	return result;
+}
+
+//! The first vertex of the first shape with vertices, unpacked so that it has an index
+static QModelIndex firstVertex( NifModel & nif )
+{
+	for ( int b = 0; b < nif.getBlockCount(); b++ ) {
+		QModelIndex iVerts = nif.getIndex( nif.getBlock( b ), "Vertices" );
+
+		if ( iVerts.isValid() && nif.rowCount( iVerts ) > 0 ) {
+			// the vertices are packed; a view unpacks them the same way before a row is edited
+			nif.fetchMore( iVerts );
+			return nif.index( 0, 0, iVerts );
+		}
+	}
+
+	return QModelIndex();
+}
+
+//! Replaces the model with a root node over count nodes, each holding a triangle of its own
+static void makeScene( NifModel & nif, int count )
+{
+	nif.clear();
+
+	// blocks are inserted without updating the model each time, see the end
+	QModelIndex iRoot = nif.insertNiBlock( "NiNode", -1, true );
+	nif.set<QString>( iRoot, "Name", "Scene Root" );
+
+	QVector<qint32> nodes;
+	QVector<Vector3> vertices{ Vector3( 0, 0, 0 ), Vector3( 1, 0, 0 ), Vector3( 0, 1, 0 ) };
+
+	for ( int n = 0; n < count; n++ ) {
+		QModelIndex iNode = nif.insertNiBlock( "NiNode", -1, true );
+		QModelIndex iShape = nif.insertNiBlock( "NiTriShape", -1, true );
+		QModelIndex iData = nif.insertNiBlock( "NiTriShapeData", -1, true );
+
+		nif.set<QString>( iNode, "Name", QString( "Node %1" ).arg( n ) );
+		nif.set<Vector3>( iNode, "Translation", Vector3( n % 100, n / 100, 0 ) );
+
+		nif.set<int>( iData, "Num Vertices", vertices.count() );
+		nif.set<int>( iData, "Has Vertices", 1 );
+		nif.updateArray( iData, "Vertices" );
+		nif.setArray<Vector3>( iData, "Vertices", vertices );
+
+		nif.setLink( iShape, "Data", nif.getBlockNumber( iData ) );
+
+		nif.set<int>( iNode, "Num Children", 1 );
+		nif.updateArray( iNode, "Children" );
+		nif.setLinkArray( iNode, "Children", { nif.getBlockNumber( iShape ) } );
+
+		nodes.append( nif.getBlockNumber( iNode ) );
+	}
+
+	nif.set<int>( iRoot, "Num Children", nodes.count() );
+	nif.updateArray( iRoot, "Children" );
+	nif.setLinkArray( iRoot, "Children", nodes );
+
+	nif.updateHeader();
+	nif.updateFooter();
+	nif.reset();
+}
+
+//! Times updating the scene after moving one vertex of the file, against rebuilding all of it
+static QJsonObject benchEdit( NifModel & nif, const QString & file, int passes )
+{
+	Q_UNUSED( file );
+
+	return timeEdit( nif, firstVertex( nif ), passes );
+}
+
+//! As benchEdit(), in a synthetic scene of 5000 nodes that does not depend on the file
+static QJsonObject benchEditScene( NifModel & nif, const QString & file, int passes )
+{
+	Q_UNUSED( file );
+
+	// half of the nodes are shapes; the version is the startup version, see NifModel::clear()
+	makeScene( nif, 2500 );
+
+	return timeEdit( nif, firstVertex( nif ), passes );
+}
+
+//! Times Scene::draw() on the CPU, as the benchmark overlay of GLView does
+static QJsonObject benchDraw( NifModel & nif, const QString & file, int passes )
+{
+	Q_UNUSED( file );
+
+	const int frames = 100;
+	QJsonObject result;
+
+	QOffscreenSurface surface;
+	surface.create();
+
+	QOpenGLContext context;
+
+	if ( !context.create() || !context.makeCurrent( &surface ) ) {
+		result["error"] = QCoreApplication::translate( "BatchProcessor", "no OpenGL context; try a platform other than offscreen, e.g. QT_QPA_PLATFORM=xcb" );
+		return result;
+	}
+
+	QOpenGLFramebufferObject target( 1024, 768, QOpenGLFramebufferObject::Depth );
+	target.bind();
+	glViewport( 0, 0, target.width(), target.height() );
+
+	initializeTextureUnits( &context );
+
+	TexCache textures;
+	textures.setNifFolder( nif.getFolder() );
+
+	QVector<double> times;
+
+	{
+		Scene scene( &textures, &context, context.functions() );
+		scene.buffers->initialize();
+
+		if ( scene.renderer->initialize() )
+			scene.updateShaders();
+
+		scene.make( &nif );
+		scene.transform( Transform(), scene.timeMin() );
+
+		// the first frames upload the buffers and start loading the textures
+		for ( int f = 0; f < 10; f++ ) {
+			scene.draw();
+			QCoreApplication::processEvents();
+		}
+
+		QElapsedTimer timer;
+
+		for ( int p = 0; p < passes; p++ ) {
+			double total = 0;
+
+			for ( int f = 0; f < frames; f++ ) {
+				timer.start();
+				scene.draw();
+				total += timer.nsecsElapsed() / 1e6;
+
+				glFinish();
+			}
+
+			times.append( total / frames );
+		}
+
+		// the scene releases its buffers while the context is current
+	}
+
+	textures.flush();
+	target.release();
+	context.doneCurrent();
+
+	result["draw"] = timings( times );
+
+	return result;
+}
+
+//! The benchmarks that --benchmark can run
+static const struct
+{
+	const char * name;
+	BatchProcessor::Benchmark run;
+} benchmarks[] = {
+	{ "load", benchLoad },
+	{ "read", benchRead },
+	{ "stress", benchStress },
+	{ "playback", benchPlayback },
+	{ "rows", benchRows },
+	{ "edit", benchEdit },
+	{ "editscene", benchEditScene },
+	{ "draw", benchDraw },
+};
+
+bool BatchProcessor::isBatch( int argc, char * argv[] )
+{
+	for ( int i = 1; i < argc; ++i ) {
+		if ( argv[i] && strcmp( argv[i], "--batch" ) == 0 )
+			return true;
+	}
+
+	return false;
+}
+
+int BatchProcessor::exec( const QStringList & arguments )
+{
+	QCommandLineParser parser;
+	parser.setApplicationDescription( tr( "Casts spells on all files in a folder and its subfolders." ) );
+	QCommandLineOption helpOpt = parser.addHelpOption();
+
+	QCommandLineOption batchOpt( "batch", tr( "Process the files in <folder>." ), tr( "folder" ) );
+	QCommandLineOption spellOpt( "spell", tr( "Cast <spell>, may be repeated. \"Sanitize\" casts all sanitizing spells." ), tr( "spell" ) );
+	QCommandLineOption filterOpt( "filter", tr( "Only process files matching <patterns>, separated by commas." ), tr( "patterns" ), "*.nif" );
+	QCommandLineOption threadsOpt( "threads", tr( "Use <count> threads instead of one per core." ), tr( "count" ) );
+	QCommandLineOption outputOpt( "output", tr( "Save into <folder> instead of overwriting the files." ), tr( "folder" ) );
+	QCommandLineOption reportOpt( "report", tr( "Write the JSON summary to <file> instead of standard output." ), tr( "file" ) );
+	QCommandLineOption dryRunOpt( "dry-run", tr( "Cast the spells without saving." ) );
+
+	QStringList benchmarkNames;
+	for ( const auto & b : benchmarks )
+		benchmarkNames << b.name;
+
+	QCommandLineOption benchmarkOpt( "benchmark", tr( "Run <benchmark> on every file instead of casting spells and saving; one of %1." ).arg( benchmarkNames.join( ", " ) ), tr( "benchmark" ) );
+	QCommandLineOption passesOpt( "passes", tr( "Repeat the benchmark <count> times on each file." ), tr( "count" ), "1" );
+
+	parser.addOption( batchOpt );
+	parser.addOption( spellOpt );
+	parser.addOption( filterOpt );
+	parser.addOption( threadsOpt );
+	parser.addOption( outputOpt );
+	parser.addOption( reportOpt );
+	parser.addOption( dryRunOpt );
+	parser.addOption( benchmarkOpt );
+	parser.addOption( passesOpt );
+
+	if ( !parser.parse( arguments ) ) {
+		qCritical() << parser.errorText();
+		return 1;
+	}
+
+	if ( parser.isSet( helpOpt ) )
+		parser.showHelp();
+
+	folder = QDir( parser.value( batchOpt ) ).absolutePath();
+	output = parser.isSet( outputOpt ) ? QDir( parser.value( outputOpt ) ).absolutePath() : QString();
+	reportFile = parser.value( reportOpt );
+	dryRun = parser.isSet( dryRunOpt );
+	passes = qMax( parser.value( passesOpt ).toInt(), 1 );
+
+	if ( parser.isSet( benchmarkOpt ) ) {
+		benchmarkName = parser.value( benchmarkOpt );
+
+		for ( const auto & b : benchmarks ) {
+			if ( benchmarkName == b.name )
+				benchmark = b.run;
+		}
+
+		if ( !benchmark ) {
+			qCritical() << tr( "unknown benchmark %1" ).arg( benchmarkName );
+			return 1;
+		}
+
+		dryRun = true;
+	}
+
+	if ( !QFileInfo( folder ).isDir() ) {
+		qCritical() << tr( "%1 is not a folder" ).arg( folder );
+		return 1;
+	}
+
+	for ( const QString & name : parser.values( spellOpt ) ) {
+		Spell * spell = nullptr;
+
+		if ( name.compare( "Sanitize", Qt::CaseInsensitive ) != 0 && !( spell = SpellBook::lookup( name ) ) ) {
+			qCritical() << tr( "unknown spell %1" ).arg( name );
+			return 1;
+		}
+
+		spells.append( spell );
+		spellNames.append( name );
+	}
+
+	if ( benchmark && !spells.isEmpty() ) {
+		qCritical() << tr( "spells cannot be cast while benchmarking" );
+		return 1;
+	}
+
+	queue.init( folder, parser.value( filterOpt ).split( ",", QString::SkipEmptyParts ), true );
+	results.reserve( queue.count() );
+
+	int threads = QThread::idealThreadCount();
+
+	if ( parser.isSet( threadsOpt ) )
+		threads = parser.value( threadsOpt ).toInt();
+
+	// benchmarks time one file at a time, on this thread, since scenes read the view options
+	if ( benchmark )
+		threads = 1;
+
+	threads = qMax( threads, 1 );
+
+	QElapsedTimer timer;
+	timer.start();
+
+	if ( benchmark ) {
+		work();
+	} else {
+		// each worker takes the next file from the queue when it is done with the previous one,
+		// so long and short files balance out across the threads
+		QThreadPool pool;
+		pool.setMaxThreadCount( threads );
+
+		for ( int t = 0; t < threads; t++ )
+			pool.start( new BatchWorker( this ) );
+
+		pool.waitForDone();
+	}
+
+	double totalTime = timer.nsecsElapsed() / 1e6;
+
+	std::sort( results.begin(), results.end(), []( const Result & a, const Result & b ) {
+		return a.file < b.file;
+	} );
+
+	if ( !report( threads, totalTime ) ) {
+		qCritical() << tr( "failed to write %1" ).arg( reportFile );
+		return 1;
+	}
+
+	for ( const Result & r : results ) {
+		if ( !r.ok )
+			return 2;
+	}
+
+	return 0;
+}
+
+void BatchProcessor::work()
+{
+	// models read the startup version through Options, which returns the saved setting off the GUI thread
+	NifModel nif;
+	nif.setMessageMode( BaseModel::CollectMessages );
+	nif.setHeadless( true );
+
+	for ( QString file = queue.dequeue(); !file.isEmpty(); file = queue.dequeue() ) {
+		Result result = process( nif, file );
+
+		QMutexLocker lock( &mutex );
+		results.append( result );
+	}
+}
+
+BatchProcessor::Result BatchProcessor::process( NifModel & nif, const QString & file ) const
+{
+	Result result;
+	result.file = QDir( folder ).relativeFilePath( file );
+
+	QElapsedTimer timer;
+	timer.start();
+
+	result.loaded = nif.loadFromFile( file );
+	result.loadTime = timer.nsecsElapsed() / 1e6;
+
+	if ( result.loaded ) {
+		result.loadedBlocks = nif.getBlockCount();
+
+		if ( benchmark )
+			result.timings = benchmark( nif, file, passes );
+
+		timer.restart();
+
+		for ( Spell * spell : spells ) {
+			if ( spell )
+				cast( &nif, spell );
+			else
+				SpellBook::sanitize( &nif );
+		}
+
+		result.castTime = timer.nsecsElapsed() / 1e6;
+		result.castBlocks = nif.getBlockCount();
+
+		if ( !dryRun ) {
+			QString target = output.isEmpty() ? file : QDir( output ).filePath( result.file );
+
+			timer.restart();
+			result.saved = QDir().mkpath( QFileInfo( target ).absolutePath() ) && nif.saveToFile( target );
+			result.saveTime = timer.nsecsElapsed() / 1e6;
+
+			if ( !result.saved )
+				result.messages.append( tr( "failed to write %1" ).arg( target ) );
+		}
+	}
+
+	result.ok = result.loaded && ( dryRun || result.saved );
+
+	for ( const Message & msg : nif.getMessages() ) {
+		if ( msg.type() != QtDebugMsg )
+			result.messages.append( msg );
+	}
+
+	return result;
+}
+
+void BatchProcessor::cast( NifModel * nif, Spell * spell )
+{
+	if ( spell->isApplicable( nif, QModelIndex() ) ) {
+		spell->cast( nif, QModelIndex() );
+		return;
+	}
+
+	// spells may insert or remove blocks, so find all targets before casting
+	QList<QPersistentModelIndex> targets;
+
+	for ( int b = 0; b < nif->getBlockCount(); b++ ) {
+		QModelIndex iBlock = nif->getBlock( b );
+
+		if ( spell->isApplicable( nif, iBlock ) )
+			targets.append( iBlock );
+	}
+
+	for ( const QPersistentModelIndex & iBlock : targets ) {
+		if ( iBlock.isValid() && spell->isApplicable( nif, iBlock ) )
+			spell->cast( nif, iBlock );
+	}
+}
+
+bool BatchProcessor::report( int threads, double totalTime ) const
+{
+	QJsonArray files;
+	int failed = 0;
+
+	for ( const Result & r : results ) {
+		QJsonObject file;
+		file["file"] = r.file;
+		file["ok"] = r.ok;
+		file["loaded"] = r.loaded;
+		file["saved"] = r.saved;
+		file["loadTime"] = r.loadTime;
+		file["castTime"] = r.castTime;
+		file["saveTime"] = r.saveTime;
+		file["loadedBlocks"] = r.loadedBlocks;
+		file["castBlocks"] = r.castBlocks;
+		file["messages"] = QJsonArray::fromStringList( r.messages );
+
+		if ( benchmark )
+			file["benchmark"] = r.timings;
+
+		files.append( file );
+
+		if ( !r.ok )
+			failed++;
+	}
+
+	QJsonObject summary;
+	summary["folder"] = folder;
+	summary["spells"] = QJsonArray::fromStringList( spellNames );
+	summary["dryRun"] = dryRun;
+
+	if ( benchmark ) {
+		summary["benchmark"] = benchmarkName;
+		summary["passes"] = passes;
+	}
+
+	summary["threads"] = threads;
+	summary["files"] = results.count();
+	summary["failed"] = failed;
+	summary["totalTime"] = totalTime;
+	summary["results"] = files;
+
+	QByteArray json = QJsonDocument( summary ).toJson();
+
+	QFile f( reportFile );
+	bool opened = reportFile.isEmpty() ? f.open( stdout, QIODevice::WriteOnly ) : f.open( QIODevice::WriteOnly );
+
+	return opened && f.write( json ) == json.size();
+}
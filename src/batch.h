@@ -0,0 +1,166 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2012, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "widgets/xmlcheck.h" // FileQueue
+
+#include <QCoreApplication>
+#include <QJsonObject>
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+
+
+//! \file batch.h BatchProcessor
+
+class NifModel;
+class Spell;
+class BatchWorker;
+
+//! Casts spells on a tree of files from the command line, without any windows.
+/**
+ * Started with
+ * <tt>nifskope --batch &lt;folder&gt; --spell &lt;name&gt; [--spell &lt;name&gt; ...]</tt>.
+ * Spells are looked up with SpellBook::lookup(), so names may carry their
+ * page ("Batch/Update All Tangent Spaces"); the name "Sanitize" casts all
+ * sanitizing spells. Files are processed on a thread pool and a JSON
+ * summary with per file timings and block counts is written at the end.
+ *
+ * Models are headless, so spells report their outcome in the messages of
+ * the summary, see Spell::inform(). Spells that open dialogs of their own,
+ * such as those asking for parameters, cannot be cast in batch mode.
+ *
+ * With <tt>--dry-run</tt> this doubles as a benchmark of a spell on real
+ * files; e.g. <tt>--spell "Optimize/Combine Properties"</tt> times
+ * BlockDeduplicator, and the block counts show how many blocks it merged.
+ *
+ * With <tt>--benchmark &lt;name&gt;</tt> no spells are cast and nothing is
+ * saved; instead the named measurement is repeated <tt>--passes</tt> times on
+ * every file and its timings are added to the file's entry in the summary.
+ * Benchmarks run on the main thread, one file at a time, and ignore
+ * <tt>--threads</tt>; scenes read the view options, which only that thread
+ * may do.
+ * Running the same command with two builds compares them on real files.
+ * - <tt>load</tt> times NifModel::loadFromFile() and the parsing of any
+ *   blocks it deferred.
+ * - <tt>read</tt> times NifIStream alone, decoding every value of the file
+ *   from memory.
+ * - <tt>stress</tt> loads the file on 1, 2, 4, ... 32 threads at once, each
+ *   with its own model, and reports the loads per second for each count.
+ * - <tt>playback</tt> builds the scene and steps it through each animation
+ *   sequence, 1000 frames in order and 1000 at random times, and reports
+ *   the time per frame.
+ * - <tt>rows</tt> times getBlockNumber() on every block, and index() plus
+ *   parent() on every row of every block, as a tree view does.
+ * - <tt>edit</tt> moves the first vertex of the file and times the scene
+ *   update for that one change, next to a full update of the scene.
+ * - <tt>draw</tt> renders the scene into an offscreen framebuffer and times
+ *   Scene::draw() on the CPU, like the "Draw" figure of the benchmark
+ *   overlay. It needs OpenGL, which the offscreen platform may lack; set
+ *   QT_QPA_PLATFORM to a platform that has it.
+ */
+class BatchProcessor final
+{
+	Q_DECLARE_TR_FUNCTIONS( BatchProcessor )
+
+public:
+	BatchProcessor() : dryRun( false ), benchmark( nullptr ), passes( 1 ) {}
+
+	//! Whether the command line asks for batch mode; usable before the application exists.
+	static bool isBatch( int argc, char * argv[] );
+
+	//! Parses the command line and processes all files; returns the exit code.
+	int exec( const QStringList & arguments );
+
+	//! The outcome of processing one file
+	struct Result
+	{
+		Result() : ok( false ), loaded( false ), saved( false ), loadTime( 0 ), castTime( 0 ), saveTime( 0 ), loadedBlocks( 0 ), castBlocks( 0 ) {}
+
+		QString file;
+		//! Whether the file was loaded and, unless this is a dry run, saved
+		bool ok;
+		bool loaded;
+		bool saved;
+		//! Time spent loading, casting and saving in milliseconds
+		double loadTime, castTime, saveTime;
+		//! Number of blocks after loading and after casting
+		int loadedBlocks, castBlocks;
+		QStringList messages;
+		//! The timings of the benchmark, if one was run
+		QJsonObject timings;
+	};
+
+	//! Runs a benchmark on a loaded file and returns its timings
+	typedef QJsonObject (*Benchmark)( NifModel & nif, const QString & file, int passes );
+
+protected:
+	//! Processes files from the queue until it is empty; run by each worker.
+	void work();
+	//! Loads, casts the spells on and saves a single file.
+	Result process( NifModel & nif, const QString & file ) const;
+	//! Casts a spell on the file globally, or else on every block it applies to.
+	static void cast( NifModel * nif, Spell * spell );
+	//! Writes the JSON summary.
+	bool report( int threads, double totalTime ) const;
+
+	//! The folder being processed
+	QString folder;
+	//! The folder that results are written to, or empty to overwrite the inputs
+	QString output;
+	//! The summary file, or empty for standard output
+	QString reportFile;
+	//! Whether to skip saving
+	bool dryRun;
+	//! The benchmark to run instead of the spells, if any
+	Benchmark benchmark;
+	QString benchmarkName;
+	//! How often the benchmark is repeated on each file
+	int passes;
+
+	//! The spells to cast, in order; a null entry stands for SpellBook::sanitize()
+	QList<Spell *> spells;
+	//! The spell names, as given on the command line
+	QStringList spellNames;
+
+	FileQueue queue;
+
+	//! Results of all processed files, guarded by mutex
+	QVector<Result> results;
+	QMutex mutex;
+
+	friend class BatchWorker;
+};
+
+#endif
@@ -854,6 +854,89 @@ void DirectDrawSurface::readBlock( ColorBlock * rgba )
 }
 
 
+/// Decode a DXT1, DXT3 or DXT5 mipmap straight into width * height RGBA8 pixels.
+/// Returns false for the formats that must go through mipmap() instead.
+bool DirectDrawSurface::mipmapRGBA( uint8 * rgba, uint face, uint mipmap )
+{
+	const uint fourcc = header.pf.fourcc;
+	const bool dxt1 = ( fourcc == FOURCC_DXT1 );
+	const bool dxt3 = ( fourcc == FOURCC_DXT2 || fourcc == FOURCC_DXT3 );
+	const bool dxt5 = ( fourcc == FOURCC_DXT4 || fourcc == FOURCC_DXT5 );
+
+	if ( !( header.pf.flags & DDPF_FOURCC ) || !( dxt1 || dxt3 || dxt5 ) )
+		return false;
+
+	// DXT5 normal maps are rebuilt by readBlock()
+	if ( fourcc == FOURCC_DXT5 && ( header.pf.flags & DDPF_NORMAL ) )
+		return false;
+
+	uint w = width();
+	uint h = height();
+
+	for ( uint m = 0; m < mipmap; m++ ) {
+		w = std::max( 1U, w / 2 );
+		h = std::max( 1U, h / 2 );
+	}
+
+	// read through a stream of our own, so that mipmaps may be decoded concurrently
+	Stream in( stream.mem, stream.size );
+	in.seek( offset( face, mipmap ) );
+
+	const uint bw = (w + 3) / 4;
+	const uint bh = (h + 3) / 4;
+
+	for ( uint by = 0; by < bh; by++ ) {
+		for ( uint bx = 0; bx < bw; bx++ ) {
+			uint8 alpha[16];
+
+			if ( dxt3 ) {
+				AlphaBlockDXT3 block;
+				mem_read( in, block );
+
+				for ( uint i = 0; i < 16; i++ ) {
+					uint a = ( block.row[i / 4] >> ( 4 * (i % 4) ) ) & 0xF;
+					alpha[i] = (a << 4) | a;
+				}
+			} else if ( dxt5 ) {
+				AlphaBlockDXT5 block;
+				mem_read( in, block );
+
+				uint8 alpha_array[8];
+				block.evaluatePalette( alpha_array );
+
+				uint8 index_array[16];
+				block.indices( index_array );
+
+				for ( uint i = 0; i < 16; i++ )
+					alpha[i] = alpha_array[index_array[i]];
+			}
+
+			BlockDXT1 block;
+			mem_read( in, block );
+
+			Color32 color_array[4];
+			block.evaluatePalette( color_array );
+
+			// Write the block, clipped to the image.
+			for ( uint y = 0; y < std::min( 4U, h - 4 * by ); y++ ) {
+				uint8 * dst = rgba + 4 * ( (4 * by + y) * w + 4 * bx );
+
+				for ( uint x = 0; x < std::min( 4U, w - 4 * bx ); x++ ) {
+					const Color32 & c = color_array[( block.row[y] >> (2 * x) ) & 3];
+
+					*dst++ = c.r;
+					*dst++ = c.g;
+					*dst++ = c.b;
+					*dst++ = dxt1 ? c.a : alpha[4 * y + x];
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+
 uint DirectDrawSurface::blockSize() const
 {
 	switch ( header.pf.fourcc ) {
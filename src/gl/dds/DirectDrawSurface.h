@@ -160,6 +160,7 @@ public:
 
 	void mipmap( Image * img, uint f, uint m );
 	//	void mipmap(FloatImage * img, uint f, uint m);
+	bool mipmapRGBA( uint8 * rgba, uint f, uint m );
 
 	void printInfo() const;
 
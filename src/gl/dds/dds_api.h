@@ -92,4 +92,14 @@ Image * load_dds( unsigned char * mem, int size, int face = 0, int mipmap = 0 );
 */
 Image * load_dds( const unsigned char * mem, int size, int face, int mipmap, DDSFormat * format );
 
+class DirectDrawSurface;
+
+//! Open a DDS file for decoding several mipmaps.
+/*!
+ * The header is read once; mipmaps are then decoded with DirectDrawSurface::mipmapRGBA() or DirectDrawSurface::mipmap().
+ * \param format Describes headerless pixel data, or 0 if mem starts with a DDS header.
+ * \return 0 if the file is not valid or not supported, or pointer to the surface otherwise. The caller is responsible for destructing the surface object (using delete).
+ */
+DirectDrawSurface * open_dds( const unsigned char * mem, int size, DDSFormat * format = 0 );
+
 #endif /* __DDS_API_H */
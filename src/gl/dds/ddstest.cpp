@@ -0,0 +1,250 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2012, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+
+/*
+ * Checks that DirectDrawSurface::mipmapRGBA() decodes DXT1/3/5 exactly like
+ * the ColorBlock path taken by DirectDrawSurface::mipmap().
+ *
+ * With --bench, times both paths over the mipmap chain of a large surface;
+ * the ColorBlock path includes the copy into RGBA that texLoadDXT() made.
+ *
+ * Build with ddstest.pro, or directly:
+ * g++ -O2 -o ddstest *.cpp
+ */
+
+#include "DirectDrawSurface.h"
+
+#include <chrono>   // std::chrono::steady_clock
+#include <stdio.h>  // printf
+#include <string.h> // memcmp, strcmp
+#include <vector>
+
+static uint seed = 0x1234567;
+
+static uint8 randomByte()
+{
+	// Numerical Recipes LCG; the upper bits are the useful ones
+	seed = seed * 1664525 + 1013904223;
+	return uint8( seed >> 24 );
+}
+
+static uint mipmapCount( uint w, uint h )
+{
+	// every level down to 1x1
+	uint mipmaps = 1;
+	for ( uint s = std::max( w, h ); s > 1; s /= 2 )
+		mipmaps++;
+
+	return mipmaps;
+}
+
+//! Fills data with a random surface of the given format and size
+static DDSHeader randomSurface( const char * fourcc, uint w, uint h, uint mipmaps, std::vector<uint8> & data )
+{
+	DDSHeader hdr;
+	hdr.setFourCC( fourcc[0], fourcc[1], fourcc[2], fourcc[3] );
+	hdr.setWidth( w );
+	hdr.setHeight( h );
+	hdr.setTexture2D();
+	hdr.setMipmapCount( mipmaps );
+	hdr.setOffset( 0 );
+
+	const uint blockSize = ( fourcc[3] == '1' ) ? 8 : 16;
+
+	uint size = 0;
+	uint mw = w, mh = h;
+
+	for ( uint m = 0; m < mipmaps; m++ ) {
+		size += blockSize * ( (mw + 3) / 4 ) * ( (mh + 3) / 4 );
+		mw = std::max( 1U, mw / 2 );
+		mh = std::max( 1U, mh / 2 );
+	}
+
+	data.resize( size );
+
+	for ( uint i = 0; i < size; i++ )
+		data[i] = randomByte();
+
+	return hdr;
+}
+
+static bool testSurface( const char * fourcc, uint w, uint h, uint mipmaps )
+{
+	std::vector<uint8> data;
+	DDSHeader hdr = randomSurface( fourcc, w, h, mipmaps, data );
+	DirectDrawSurface dds( hdr, &data[0], uint( data.size() ) );
+
+	bool ok = true;
+	uint mw = w, mh = h;
+
+	for ( uint m = 0; m < mipmaps; m++ ) {
+		Image img;
+		dds.mipmap( &img, 0, m );
+
+		std::vector<uint8> expected( 4 * mw * mh );
+
+		for ( uint i = 0; i < mw * mh; i++ ) {
+			const Color32 & c = img.pixel( i );
+			expected[4 * i + 0] = c.r;
+			expected[4 * i + 1] = c.g;
+			expected[4 * i + 2] = c.b;
+			expected[4 * i + 3] = c.a;
+		}
+
+		// fill with a pattern so that unwritten pixels are caught
+		std::vector<uint8> rgba( 4 * mw * mh, 0xCD );
+
+		if ( img.width() != mw || img.height() != mh ) {
+			printf( "FAIL %s %ux%u mipmap %u: image is %ux%u\n", fourcc, w, h, m, img.width(), img.height() );
+			ok = false;
+		} else if ( !dds.mipmapRGBA( &rgba[0], 0, m ) ) {
+			printf( "FAIL %s %ux%u mipmap %u: not decoded\n", fourcc, w, h, m );
+			ok = false;
+		} else if ( memcmp( &rgba[0], &expected[0], rgba.size() ) != 0 ) {
+			for ( uint i = 0; i < mw * mh; i++ ) {
+				if ( memcmp( &rgba[4 * i], &expected[4 * i], 4 ) != 0 ) {
+					printf( "FAIL %s %ux%u mipmap %u: pixel (%u, %u) is %02X%02X%02X%02X, expected %02X%02X%02X%02X\n",
+						fourcc, w, h, m, i % mw, i / mw,
+						rgba[4 * i], rgba[4 * i + 1], rgba[4 * i + 2], rgba[4 * i + 3],
+						expected[4 * i], expected[4 * i + 1], expected[4 * i + 2], expected[4 * i + 3] );
+					break;
+				}
+			}
+
+			ok = false;
+		}
+
+		mw = std::max( 1U, mw / 2 );
+		mh = std::max( 1U, mh / 2 );
+	}
+
+	return ok;
+}
+
+//! Decodes the mipmap chain of dds through the ColorBlock path, as texLoadDXT() did
+static void decodeColorBlock( DirectDrawSurface & dds, uint mipmaps, std::vector<uint8> & rgba )
+{
+	for ( uint m = 0; m < mipmaps; m++ ) {
+		Image img;
+		dds.mipmap( &img, 0, m );
+
+		const Color32 * src = img.pixels();
+		uint8 * dst = &rgba[0];
+
+		for ( uint c = img.width() * img.height(); c > 0; c-- ) {
+			*dst++ = src->r;
+			*dst++ = src->g;
+			*dst++ = src->b;
+			*dst++ = src->a;
+			src++;
+		}
+	}
+}
+
+//! Decodes the mipmap chain of dds straight into RGBA
+static void decodeRGBA( DirectDrawSurface & dds, uint mipmaps, std::vector<uint8> & rgba )
+{
+	for ( uint m = 0; m < mipmaps; m++ )
+		dds.mipmapRGBA( &rgba[0], 0, m );
+}
+
+//! Milliseconds taken by the fastest of a few runs of decode
+template <typename Decode>
+static double timeDecode( Decode decode, DirectDrawSurface & dds, uint mipmaps, std::vector<uint8> & rgba )
+{
+	double best = 0;
+
+	for ( int run = 0; run < 5; run++ ) {
+		auto start = std::chrono::steady_clock::now();
+		decode( dds, mipmaps, rgba );
+		std::chrono::duration<double, std::milli> t = std::chrono::steady_clock::now() - start;
+
+		if ( run == 0 || t.count() < best )
+			best = t.count();
+	}
+
+	return best;
+}
+
+static int bench()
+{
+	static const char * formats[] = { "DXT1", "DXT3", "DXT5" };
+	const uint w = 2048, h = 2048;
+	const uint mipmaps = mipmapCount( w, h );
+
+	std::vector<uint8> rgba( 4 * w * h );
+
+	printf( "%ux%u, %u mipmaps, best of 5\n", w, h, mipmaps );
+
+	for ( const char * fourcc : formats ) {
+		std::vector<uint8> data;
+		DDSHeader hdr = randomSurface( fourcc, w, h, mipmaps, data );
+		DirectDrawSurface dds( hdr, &data[0], uint( data.size() ) );
+
+		double colorBlock = timeDecode( decodeColorBlock, dds, mipmaps, rgba );
+		double direct = timeDecode( decodeRGBA, dds, mipmaps, rgba );
+
+		printf( "%s: ColorBlock %.2f ms, mipmapRGBA %.2f ms, %.2fx\n", fourcc, colorBlock, direct, colorBlock / direct );
+	}
+
+	return 0;
+}
+
+int main( int argc, char ** argv )
+{
+	if ( argc > 1 && strcmp( argv[1], "--bench" ) == 0 )
+		return bench();
+
+	static const char * formats[] = { "DXT1", "DXT3", "DXT5" };
+	static const uint sizes[][2] = {
+		{ 1, 1 }, { 2, 3 }, { 4, 4 }, { 5, 7 }, { 13, 6 }, { 16, 16 }, { 17, 33 }, { 64, 3 }, { 255, 129 }
+	};
+
+	uint failed = 0;
+	uint tests = 0;
+
+	for ( const char * fourcc : formats ) {
+		for ( const auto & size : sizes ) {
+			const uint w = size[0], h = size[1];
+
+			tests++;
+
+			if ( !testSurface( fourcc, w, h, mipmapCount( w, h ) ) )
+				failed++;
+		}
+	}
+
+	printf( "%u of %u surfaces decoded bit-exact\n", tests - failed, tests );
+
+	return failed ? 1 : 0;
+}
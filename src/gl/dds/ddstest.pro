@@ -0,0 +1,13 @@
+TEMPLATE = app
+LANGUAGE = C++
+TARGET   = ddstest
+
+CONFIG -= qt
+CONFIG += c++11 release warn_on console
+
+DESTDIR = ./
+
+HEADERS += *.h
+SOURCES += *.cpp
+
+# vim: set filetype=config :
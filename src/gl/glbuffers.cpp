@@ -0,0 +1,136 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2012, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+#include "glbuffers.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+
+
+//! \file glbuffers.cpp BufferCache
+
+BufferCache::BufferCache( QOpenGLFunctions * f )
+	: fn( f ), supported( false )
+{
+}
+
+BufferCache::~BufferCache()
+{
+	for ( const void * owner : buffers.keys() ) {
+		release( owner );
+	}
+
+	flush();
+}
+
+bool BufferCache::initialize()
+{
+	supported = fn && fn->hasOpenGLFeature( QOpenGLFunctions::Buffers );
+
+	return supported;
+}
+
+const void * BufferCache::bind( const void * owner, Array array, const void * data, int bytes, int & changed, bool stream )
+{
+	bool upload = changed & ( 1 << array );
+	changed &= ~( 1 << array );
+
+	if ( !supported )
+		return data;
+
+	GLenum target = ( array == Indices ) ? GL_ELEMENT_ARRAY_BUFFER : GL_ARRAY_BUFFER;
+
+	Buffers & b = buffers[owner];
+
+	if ( !b.ids[array] ) {
+		fn->glGenBuffers( 1, &b.ids[array] );
+		upload = true;
+	}
+
+	fn->glBindBuffer( target, b.ids[array] );
+
+	if ( upload ) {
+		// a new data store lets the driver keep drawing from the old one
+		fn->glBufferData( target, bytes, data, stream ? GL_STREAM_DRAW : GL_STATIC_DRAW );
+		b.sizes[array] = bytes;
+	}
+
+	return nullptr;
+}
+
+void BufferCache::unbind()
+{
+	if ( !supported )
+		return;
+
+	fn->glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	fn->glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+}
+
+void BufferCache::release( const void * owner )
+{
+	auto it = buffers.find( owner );
+
+	if ( it == buffers.end() )
+		return;
+
+	for ( int a = 0; a < NumArrays; a++ ) {
+		if ( it->ids[a] )
+			released.append( it->ids[a] );
+	}
+
+	buffers.erase( it );
+}
+
+void BufferCache::flush()
+{
+	if ( released.isEmpty() )
+		return;
+
+	if ( supported && QOpenGLContext::currentContext() )
+		fn->glDeleteBuffers( released.count(), released.constData() );
+
+	released.clear();
+}
+
+qint64 BufferCache::bytes() const
+{
+	qint64 total = 0;
+
+	for ( const Buffers & b : buffers ) {
+		for ( int a = 0; a < NumArrays; a++ ) {
+			total += b.sizes[a];
+		}
+	}
+
+	return total;
+}
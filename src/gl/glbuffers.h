@@ -0,0 +1,113 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2012, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+#ifndef GLBUFFERS_H
+#define GLBUFFERS_H
+
+#include <QHash>
+#include <QVector>
+
+
+class QOpenGLFunctions;
+
+typedef unsigned int GLuint;
+
+//! \file glbuffers.h BufferCache header
+
+//! Keeps the vertex and index arrays of the scene in OpenGL buffer objects
+/*!
+ * Each owner, usually a Mesh, has one buffer per array. An array is only
+ * uploaded again when its owner marks it as changed, so static geometry is
+ * sent to the GPU once; arrays which change every frame are streamed.
+ * Without buffer object support the arrays are drawn from client memory.
+ */
+class BufferCache final
+{
+public:
+	//! The arrays of an owner
+	enum Array
+	{
+		Vertices, Normals, Colors, Indices, NumArrays
+	};
+
+	//! All arrays, as a combination of the (1 << Array) bits
+	static const int AllArrays = ( 1 << NumArrays ) - 1;
+
+	//! Constructor
+	BufferCache( QOpenGLFunctions * fn );
+	//! Destructor; the context must be current
+	~BufferCache();
+
+	//! Checks for buffer object support; the context must be current
+	bool initialize();
+	//! Whether arrays are kept in buffer objects
+	bool isSupported() const { return supported; }
+
+	//! Binds \a array of \a owner for drawing
+	/*!
+	 * Uploads \a bytes of \a data first if the array's bit is set in \a changed,
+	 * and clears that bit.
+	 *
+	 * @param stream	Whether the array changes every frame
+	 * @return			The pointer to pass to gl*Pointer or glDrawElements
+	 */
+	const void * bind( const void * owner, Array array, const void * data, int bytes, int & changed, bool stream = false );
+	//! Unbinds the array and index buffers, so that client arrays can be used again
+	void unbind();
+
+	//! Releases the buffers of \a owner; they are deleted by the next flush()
+	void release( const void * owner );
+	//! Deletes the released buffers; the context must be current
+	void flush();
+
+	//! Estimated memory taken by the buffers, in bytes
+	qint64 bytes() const;
+
+protected:
+	//! The buffers of one owner
+	struct Buffers
+	{
+		Buffers() : ids(), sizes() {}
+
+		GLuint ids[NumArrays];
+		int sizes[NumArrays];
+	};
+
+	QOpenGLFunctions * fn;
+	bool supported;
+
+	QHash<const void *, Buffers> buffers;
+	//! Buffers released since the last flush()
+	QVector<GLuint> released;
+};
+
+#endif
@@ -35,6 +35,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "glscene.h"
 
+#include <algorithm>
+
 
 /*
  *  Controllable
@@ -267,17 +269,19 @@ float Controller::ctrlTime( float time ) const
 
 bool Controller::timeIndex( float time, const NifModel * nif, const QModelIndex & array, int & i, int & j, float & x )
 {
+	static const NifFieldKey timeKey( "Time" );
+
 	int count;
 
 	if ( array.isValid() && ( count = nif->rowCount( array ) ) > 0 ) {
-		if ( time <= nif->get<float>( array.child( 0, 0 ), "Time" ) ) {
+		if ( time <= nif->get<float>( array.child( 0, 0 ), timeKey ) ) {
 			i = j = 0;
 			x = 0.0;
 
 			return true;
 		}
 
-		if ( time >= nif->get<float>( array.child( count - 1, 0 ), "Time" ) ) {
+		if ( time >= nif->get<float>( array.child( count - 1, 0 ), timeKey ) ) {
 			i = j = count - 1;
 			x = 0.0;
 
@@ -287,13 +291,13 @@ bool Controller::timeIndex( float time, const NifModel * nif, const QModelIndex
 		if ( i < 0 || i >= count )
 			i = 0;
 
-		float tI = nif->get<float>( array.child( i, 0 ), "Time" );
+		float tI = nif->get<float>( array.child( i, 0 ), timeKey );
 
 		if ( time > tI ) {
 			j = i + 1;
 			float tJ;
 
-			while ( time >= ( tJ = nif->get<float>( array.child( j, 0 ), "Time" ) ) ) {
+			while ( time >= ( tJ = nif->get<float>( array.child( j, 0 ), timeKey ) ) ) {
 				i  = j++;
 				tI = tJ;
 			}
@@ -305,7 +309,7 @@ bool Controller::timeIndex( float time, const NifModel * nif, const QModelIndex
 			j = i - 1;
 			float tJ;
 
-			while ( time <= ( tJ = nif->get<float>( array.child( j, 0 ), "Time" ) ) ) {
+			while ( time <= ( tJ = nif->get<float>( array.child( j, 0 ), timeKey ) ) ) {
 				i  = j--;
 				tI = tJ;
 			}
@@ -324,20 +328,201 @@ bool Controller::timeIndex( float time, const NifModel * nif, const QModelIndex
 	return false;
 }
 
+/*
+ *  Key tracks
+ */
+
+//! The times of a key array, copied out of the model
+struct KeyTrackBase
+{
+	KeyTrackBase() : interpolation( 0 ) {}
+	virtual ~KeyTrackBase() {}
+
+	//! Key times, in file order
+	QVector<float> times;
+	//! The "Interpolation" of the key group
+	int interpolation;
+
+	//! Finds the keys around time
+	/*!
+	 * Starts from the keys found by the previous call, which are nearly always
+	 * the right ones during playback, and falls back to a binary search.
+	 *
+	 * \param time The time to look up
+	 * \param i The previous key on entry, the key at or before time on return
+	 * \param j The key after time on return, or i if time is on or outside a key
+	 * \param x The fraction of the way from key i to key j
+	 */
+	bool find( float time, int & i, int & j, float & x ) const
+	{
+		int count = times.count();
+
+		if ( count == 0 )
+			return false;
+
+		const float * t = times.constData();
+
+		if ( time <= t[0] ) {
+			i = j = 0;
+			x = 0.0;
+			return true;
+		}
+
+		if ( time >= t[count - 1] ) {
+			i = j = count - 1;
+			x = 0.0;
+			return true;
+		}
+
+		if ( !( i >= 0 && i < count - 1 && t[i] <= time && time < t[i + 1] ) ) {
+			if ( i >= 0 && i < count - 2 && t[i + 1] <= time && time < t[i + 2] )
+				i++;
+			else
+				i = int( std::upper_bound( t, t + count, time ) - t ) - 1;
+		}
+
+		if ( time == t[i] ) {
+			j = i;
+			x = 0.0;
+			return true;
+		}
+
+		j = i + 1;
+		x = ( time - t[i] ) / ( t[j] - t[i] );
+		return true;
+	}
+};
+
+//! The times and values of a key array, copied out of the model
+template <typename T> struct KeyTrack final : public KeyTrackBase
+{
+	//! Key values, parallel to times
+	QVector<T> values;
+};
+
+//! Identifies a key track: the item holding it, the name of its key array and the value type
+struct KeyTrackId final
+{
+	const void * item;
+	QString arrayName;
+	//! The address of a variable unique to the value type, see KeyTrackCache::typeTag()
+	const void * type;
+
+	bool operator==( const KeyTrackId & other ) const
+	{
+		return item == other.item && type == other.type && arrayName == other.arrayName;
+	}
+};
+
+inline uint qHash( const KeyTrackId & id, uint seed = 0 )
+{
+	return qHash( id.item, seed ) ^ qHash( id.arrayName, seed ) ^ qHash( id.type, seed );
+}
+
+//! Compiled key tracks of the models being animated
+/*!
+ * Reading each key through the model on every frame costs two named lookups
+ * per key visited; a track is compiled once per key array instead and is
+ * dropped as soon as its model changes.
+ */
+class KeyTrackCache final : public QObject
+{
+public:
+	~KeyTrackCache()
+	{
+		for ( const auto & tracks : models )
+			qDeleteAll( tracks );
+	}
+
+	//! Returns the compiled keys arrayName of array
+	template <typename T> const KeyTrack<T> * track( const NifModel * nif, const QModelIndex & array, const QString & arrayName )
+	{
+		static const NifFieldKey timeKey( "Time" );
+		static const NifFieldKey valueKey( "Value" );
+		static const NifFieldKey interpolationKey( "Interpolation" );
+
+		auto m = models.find( nif );
+
+		if ( m == models.end() ) {
+			m = models.insert( nif, QHash<KeyTrackId, KeyTrackBase *>() );
+
+			auto flush = [this, nif]() {
+				auto it = models.find( nif );
+
+				if ( it != models.end() ) {
+					qDeleteAll( it.value() );
+					it.value().clear();
+				}
+			};
+
+			connect( nif, &NifModel::dataChanged, this, flush );
+			connect( nif, &NifModel::rowsInserted, this, flush );
+			connect( nif, &NifModel::rowsRemoved, this, flush );
+			connect( nif, &NifModel::rowsMoved, this, flush );
+			connect( nif, &NifModel::modelReset, this, flush );
+			connect( nif, &NifModel::destroyed, this, [this, nif]() {
+				qDeleteAll( models.take( nif ) );
+			} );
+		}
+
+		// an item may hold several key arrays, and an array may be read as more than one type
+		KeyTrackBase *& slot = m.value()[KeyTrackId{ array.internalPointer(), arrayName, typeTag<T>() }];
+
+		if ( slot )
+			return static_cast<KeyTrack<T> *>( slot );
+
+		KeyTrack<T> * t = new KeyTrack<T>;
+		slot = t;
+
+		QModelIndex frames = nif->getIndex( array, arrayName );
+		int count = frames.isValid() ? nif->rowCount( frames ) : 0;
+
+		t->times.reserve( count );
+		t->values.reserve( count );
+
+		for ( int r = 0; r < count; r++ ) {
+			QModelIndex key = frames.child( r, 0 );
+			t->times.append( nif->get<float>( key, timeKey ) );
+			t->values.append( nif->get<T>( key, valueKey ) );
+		}
+
+		t->interpolation = nif->get<int>( array, interpolationKey );
+
+		return t;
+	}
+
+private:
+	//! Returns an address that is unique to T
+	template <typename T> static const void * typeTag()
+	{
+		static const char tag = 0;
+		return &tag;
+	}
+
+	//! Tracks by model, then by key array and type
+	QHash<const NifModel *, QHash<KeyTrackId, KeyTrackBase *>> models;
+};
+
+static KeyTrackCache & keyTracks()
+{
+	static KeyTrackCache cache;
+	return cache;
+}
+
 template <typename T> bool interpolate( T & value, const QModelIndex & array, float time, int & last )
 {
 	const NifModel * nif = static_cast<const NifModel *>( array.model() );
 
 	if ( nif && array.isValid() ) {
-		QModelIndex frames = nif->getIndex( array, "Keys" );
+		const KeyTrack<T> * track = keyTracks().track<T>( nif, array, "Keys" );
 		int next;
 		float x;
 
-		if ( Controller::timeIndex( time, nif, frames, last, next, x ) ) {
-			T v1 = nif->get<T>( frames.child( last, 0 ), "Value" );
-			T v2 = nif->get<T>( frames.child( next, 0 ), "Value" );
+		if ( track->find( time, last, next, x ) ) {
+			const T & v1 = track->values.at( last );
+			const T & v2 = track->values.at( next );
 
-			switch ( nif->get<int>( array, "Interpolation" ) ) {
+			switch ( track->interpolation ) {
 			/*
 			case 2:
 			{
@@ -396,10 +581,10 @@ template <> bool Controller::interpolate( bool & value, const QModelIndex & arra
 	const NifModel * nif = static_cast<const NifModel *>( array.model() );
 
 	if ( nif && array.isValid() ) {
-		QModelIndex frames = nif->getIndex( array, "Keys" );
+		const KeyTrack<int> * track = keyTracks().track<int>( nif, array, "Keys" );
 
-		if ( timeIndex( time, nif, frames, last, next, x ) ) {
-			value = nif->get<int>( frames.child( last, 0 ), "Value" );
+		if ( track->find( time, last, next, x ) ) {
+			value = track->values.at( last );
 
 			return true;
 		}
@@ -436,11 +621,11 @@ template <> bool Controller::interpolate( Matrix & value, const QModelIndex & ar
 			break;
 		default:
 			{
-				QModelIndex frames = nif->getIndex( array, "Quaternion Keys" );
+				const KeyTrack<Quat> * track = keyTracks().track<Quat>( nif, array, "Quaternion Keys" );
 
-				if ( timeIndex( time, nif, frames, last, next, x ) ) {
-					Quat v1 = nif->get<Quat>( frames.child( last, 0 ), "Value" );
-					Quat v2 = nif->get<Quat>( frames.child( next, 0 ), "Value" );
+				if ( track->find( time, last, next, x ) ) {
+					Quat v1 = track->values.at( last );
+					const Quat & v2 = track->values.at( next );
 
 					if ( Quat::dotproduct( v1, v2 ) < 0 )
 						v1.negate(); // don't take the long path
@@ -485,21 +670,23 @@ template <typename T>
 struct qarray
 {
 	qarray( const QModelIndex & array, uint off = 0 )
-		: array_( array ), off_( off )
+		: off_( off )
 	{
-		nif_ = static_cast<const NifModel *>( array_.model() );
+		// the control points are a packed array; copy them as one block
+		const NifModel * nif = static_cast<const NifModel *>( array.model() );
+		if ( nif )
+			array_ = nif->getArray<T>( array );
 	}
 	qarray( const qarray & other, uint off = 0 )
-		: nif_( other.nif_ ), array_( other.array_ ), off_( other.off_ + off )
+		: array_( other.array_ ), off_( other.off_ + off )
 	{
 	}
 
 	T operator[]( uint index ) const
 	{
-		return nif_->get<T>( array_.child( index + off_, 0 ) );
+		return array_.value( index + off_ );
 	}
-	const NifModel * nif_;
-	const QModelIndex & array_;
+	QVector<T> array_;
 	uint off_;
 };
 
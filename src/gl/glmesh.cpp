@@ -40,7 +40,10 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <QBuffer>
 #include <QDebug>
-#include <QSettings>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
 
 
 //! \file glmesh.cpp Mesh, MorphController, UVController
@@ -230,7 +233,11 @@ void Mesh::clear()
 	tristrips.clear();
 	weights.clear();
 	partitions.clear();
+	skinOffsets.clear();
+	skinWeights.clear();
+	boneSlots.clear();
 	sortedTriangles.clear();
+	drawIndices.clear();
 	indices.clear();
 	transVerts.clear();
 	transNorms.clear();
@@ -240,12 +247,23 @@ void Mesh::clear()
 
 	isBSLODPresent = false;
 	double_sided = false;
+
+	shaderPrograms.clear();
+	shaderProperties.clear();
+	shaderRevision = -1;
+
+	scene->buffers->release( this );
+	upBuffers = BufferCache::AllArrays;
+	isLOD = false;
 }
 
 void Mesh::update( const NifModel * nif, const QModelIndex & index )
 {
 	Node::update( nif, index );
 
+	// the blocks the program conditions read may have changed
+	shaderRevision = -1;
+
 	if ( !iBlock.isValid() || !index.isValid() )
 		return;
 
@@ -265,6 +283,14 @@ void Mesh::update( const NifModel * nif, const QModelIndex & index )
 	upSkin |= ( iSkinPart == index );
 
 	if ( iBlock == index ) {
+		isLOD = nif->isNiBlock( iBlock, "BSLODTriShape" );
+
+		if ( isLOD ) {
+			lodSizes[0] = nif->get<uint>( iBlock, "Level 0 Size" );
+			lodSizes[1] = nif->get<uint>( iBlock, "Level 1 Size" );
+			lodSizes[2] = nif->get<uint>( iBlock, "Level 2 Size" );
+		}
+
 		// NiMesh presents a problem because we are almost guaranteed to have multiple "data" blocks
 		// for eg. vertices, indices, normals, texture data etc.
 #ifndef QT_NO_DEBUG
@@ -355,6 +381,7 @@ void Mesh::transform()
 
 	if ( upData ) {
 		upData = false;
+		upBuffers = BufferCache::AllArrays;
 
 		// update for NiMesh
 		if ( nif->checkVersion( 0x14050000, 0 ) && nif->inherits( iBlock, "NiMesh" ) ) {
@@ -374,8 +401,10 @@ void Mesh::transform()
 				qWarning() << "Submeshes: " << numSubmeshes;
 				QPersistentModelIndex submeshMap = nif->getIndex( iData.child( i, 0 ), "Submesh To Region Map" );
 
+				QVector<ushort> submeshRegions = nif->getArray<ushort>( submeshMap );
+
 				for ( int j = 0; j < numSubmeshes; j++ ) {
-					qWarning() << "Submesh" << j << "maps to region" << nif->get<ushort>( submeshMap.child( j, 0 ) );
+					qWarning() << "Submesh" << j << "maps to region" << submeshRegions.value( j );
 				}
 
 				// each stream can have multiple components, and each has a starting index
@@ -688,6 +717,7 @@ void Mesh::transform()
 		upSkin = false;
 		weights.clear();
 		partitions.clear();
+		skinOffsets.clear();
 
 		iSkinData = nif->getBlock( nif->getLink( iSkin, "Data" ), "NiSkinData" );
 
@@ -724,115 +754,289 @@ void Mesh::transform()
 	Node::transform();
 }
 
-void Mesh::transformShapes()
+/*
+ *  Skinning
+ */
+
+//! A bone transform of the skinning palette, as flat arrays
+struct SkinBone
 {
-	if ( isHidden() || !Options::drawMeshes() )
-		return;
+	//! Rotation times scale, for positions
+	float scaled[9];
+	//! Rotation, for normals
+	float rotation[9];
+	float translation[3];
 
-	Node::transformShapes();
+	void set( const Transform & t )
+	{
+		for ( int r = 0; r < 3; r++ ) {
+			for ( int c = 0; c < 3; c++ ) {
+				rotation[r * 3 + c] = t.rotation( r, c );
+				scaled[r * 3 + c] = t.rotation( r, c ) * t.scale;
+			}
 
-	transformRigid = true;
+			translation[r] = t.translation[r];
+		}
+	}
+};
 
-	if ( weights.count() ) {
-		transformRigid = false;
+//! The inputs and outputs of one skinning pass
+struct SkinJob
+{
+	const SkinBone * palette;
+	const int * offsets;
+	const QPair<int, float> * weights;
+
+	const Vector3 * verts;
+	const Vector3 * norms;
+	const Vector3 * tangents;
+	const Vector3 * bitangents;
+
+	Vector3 * transVerts;
+	Vector3 * transNorms;
+	Vector3 * transTangents;
+	Vector3 * transBitangents;
+
+	int numNorms;
+	int numTangents;
+	int numBitangents;
+};
 
-		transVerts.resize( verts.count() );
-		transVerts.fill( Vector3() );
-		transNorms.resize( norms.count() );
-		transNorms.fill( Vector3() );
-		transTangents.resize( tangents.count() );
-		transTangents.fill( Vector3() );
-		transBitangents.resize( bitangents.count() );
-		transBitangents.fill( Vector3() );
+static inline Vector3 mul( const float * m, const Vector3 & v )
+{
+	return Vector3( m[0] * v[0] + m[1] * v[1] + m[2] * v[2],
+	                m[3] * v[0] + m[4] * v[1] + m[5] * v[2],
+	                m[6] * v[0] + m[7] * v[1] + m[8] * v[2] );
+}
 
-		Node * root = findParent( skelRoot );
+/*!
+ * Blends the palette matrices of each vertex's bones and transforms the
+ * vertex once by the blend, which is the same as summing the weighted
+ * transformed vertices but does less work per influence.
+ */
+static void skinRange( const SkinJob & job, int from, int to )
+{
+	for ( int v = from; v < to; v++ ) {
+		float s[9] = {}, r[9] = {}, t[3] = {};
 
-		if ( partitions.count() ) {
-			foreach ( const SkinPartition part, partitions ) {
-				QVector<Transform> boneTrans( part.boneMap.count() );
+		for ( int i = job.offsets[v]; i < job.offsets[v + 1]; i++ ) {
+			const SkinBone & bone = job.palette[job.weights[i].first];
+			float w = job.weights[i].second;
 
-				for ( int t = 0; t < boneTrans.count(); t++ ) {
-					Node * bone = root ? root->findChild( bones.value( part.boneMap[t] ) ) : 0;
-					boneTrans[ t ] = viewTrans() * skelTrans;
+			for ( int k = 0; k < 9; k++ ) {
+				s[k] += bone.scaled[k] * w;
+				r[k] += bone.rotation[k] * w;
+			}
 
-					if ( bone )
-						boneTrans[ t ] = boneTrans[ t ] * bone->localTransFrom( skelRoot ) * weights.value( part.boneMap[t] ).trans;
+			for ( int k = 0; k < 3; k++ )
+				t[k] += bone.translation[k] * w;
+		}
 
-					//if ( bone ) boneTrans[ t ] = bone->viewTrans() * weights.value( part.boneMap[t] ).trans;
-				}
+		job.transVerts[v] = mul( s, job.verts[v] ) + Vector3( t[0], t[1], t[2] );
 
-				for ( int v = 0; v < part.vertexMap.count(); v++ ) {
-					int vindex = part.vertexMap[ v ];
+		if ( v < job.numNorms )
+			job.transNorms[v] = mul( r, job.norms[v] ).normalize();
 
-					if ( vindex < 0 || vindex > transVerts.count() )
-						break;
+		if ( v < job.numTangents )
+			job.transTangents[v] = mul( r, job.tangents[v] ).normalize();
 
-					if ( transVerts[vindex] == Vector3() ) {
-						for ( int w = 0; w < part.numWeightsPerVertex; w++ ) {
-							QPair<int, float> weight = part.weights[ v * part.numWeightsPerVertex + w ];
-							Transform trans = boneTrans.value( weight.first );
+		if ( v < job.numBitangents )
+			job.transBitangents[v] = mul( r, job.bitangents[v] ).normalize();
+	}
+}
 
-							if ( verts.count() > vindex )
-								transVerts[vindex] += trans * verts[ vindex ] * weight.second;
+//! Skins one range of vertices on a pool thread
+class SkinTask final : public QRunnable
+{
+public:
+	SkinTask( const SkinJob & job, int from, int to, QSemaphore * done )
+		: job( job ), from( from ), to( to ), done( done ) {}
 
-							if ( norms.count() > vindex )
-								transNorms[vindex] += trans.rotation * norms[ vindex ] * weight.second;
+	void run() override final
+	{
+		skinRange( job, from, to );
+		done->release();
+	}
 
-							if ( tangents.count() > vindex )
-								transTangents[vindex] += trans.rotation * tangents[ vindex ] * weight.second;
+private:
+	const SkinJob & job;
+	int from, to;
+	QSemaphore * done;
+};
 
-							if ( bitangents.count() > vindex )
-								transBitangents[vindex] += trans.rotation * bitangents[ vindex ] * weight.second;
-						}
-					}
-				}
-			}
-		} else {
-			int x = 0;
-			foreach ( const BoneWeights bw, weights ) {
-				Transform trans = viewTrans() * skelTrans;
-				Node * bone = root ? root->findChild( bw.bone ) : 0;
+//! Skins numVerts vertices, splitting large meshes across threads
+static void skinVertices( const SkinJob & job, int numVerts )
+{
+	// below this, handing work to other threads costs more than it saves
+	const int minChunk = 4096;
 
-				if ( bone )
-					trans = trans * bone->localTransFrom( skelRoot ) * bw.trans;
+	static QThreadPool pool;
+	int chunks = qMin( qMax( QThread::idealThreadCount(), 1 ), numVerts / minChunk );
 
-				if ( bone )
-					weights[x++].tcenter = bone->viewTrans() * bw.center;
-				else
-					x++;
+	if ( chunks <= 1 ) {
+		skinRange( job, 0, numVerts );
+		return;
+	}
+
+	QSemaphore done;
+	int size = ( numVerts + chunks - 1 ) / chunks;
+
+	for ( int c = 1; c < chunks; c++ )
+		pool.start( new SkinTask( job, c * size, qMin( numVerts, ( c + 1 ) * size ), &done ) );
+
+	skinRange( job, 0, qMin( numVerts, size ) );
+	done.acquire( chunks - 1 );
+}
+
+void Mesh::packSkin()
+{
+	int numVerts = verts.count();
+	int numBones = bones.count();
 
-				Matrix natrix = trans.rotation;
-				for ( const VertexWeight& vw : bw.weights ) {
-					if ( transVerts.count() > vw.vertex )
-						transVerts[ vw.vertex ] += trans * verts[ vw.vertex ] * vw.weight;
+	// the first occurrence of a bone node wins, as with Node::findChild()
+	boneSlots.clear();
+	for ( int b = numBones - 1; b >= 0; b-- )
+		boneSlots.insert( bones[b], b );
 
-					if ( transNorms.count() > vw.vertex )
-						transNorms[ vw.vertex ] += natrix * norms[ vw.vertex ] * vw.weight;
+	QVector<QVector<QPair<int, float> > > influences( numVerts );
 
-					if ( transTangents.count() > vw.vertex )
-						transTangents[ vw.vertex ] += natrix * tangents[ vw.vertex ] * vw.weight;
+	if ( partitions.count() ) {
+		// a vertex shared by several partitions is skinned by the first one
+		QVector<bool> done( numVerts, false );
+
+		for ( const SkinPartition& part : partitions ) {
+			for ( int v = 0; v < part.vertexMap.count(); v++ ) {
+				int vindex = part.vertexMap[v];
+
+				if ( vindex < 0 || vindex >= numVerts )
+					break;
+
+				if ( done[vindex] )
+					continue;
+
+				done[vindex] = true;
+
+				for ( int w = 0; w < part.numWeightsPerVertex; w++ ) {
+					QPair<int, float> weight = part.weights.value( v * part.numWeightsPerVertex + w );
+					int slot = numBones + 1;
+
+					if ( weight.first >= 0 && weight.first < part.boneMap.count() ) {
+						slot = part.boneMap[weight.first];
+
+						if ( slot < 0 || slot >= numBones )
+							slot = numBones;
+					}
 
-					if ( transBitangents.count() > vw.vertex )
-						transBitangents[ vw.vertex ] += natrix * bitangents[ vw.vertex ] * vw.weight;
+					influences[vindex].append( { slot, weight.second } );
 				}
 			}
 		}
+	} else {
+		for ( int b = 0; b < weights.count(); b++ ) {
+			for ( const VertexWeight& vw : weights[b].weights ) {
+				if ( vw.vertex >= 0 && vw.vertex < numVerts )
+					influences[vw.vertex].append( { b, vw.weight } );
+			}
+		}
+	}
+
+	skinOffsets.resize( numVerts + 1 );
+	skinWeights.clear();
+
+	for ( int v = 0; v < numVerts; v++ ) {
+		skinOffsets[v] = skinWeights.count();
+		skinWeights += influences[v];
+	}
+
+	skinOffsets[numVerts] = skinWeights.count();
+}
 
-		for ( int n = 0; n < transNorms.count(); n++ )
-			transNorms[n].normalize();
+void Mesh::transformShapes()
+{
+	if ( isHidden() || !Options::drawMeshes() )
+		return;
 
-		for ( int t = 0; t < transTangents.count(); t++ )
-			transTangents[t].normalize();
+	Node::transformShapes();
 
-		for ( int t = 0; t < transBitangents.count(); t++ )
-			transBitangents[t].normalize();
+	transformRigid = true;
+
+	if ( weights.count() ) {
+		transformRigid = false;
+
+		if ( skinOffsets.count() != verts.count() + 1 )
+			packSkin();
+
+		transVerts.resize( verts.count() );
+		transNorms.resize( norms.count() );
+		transNorms.fill( Vector3() );
+		transTangents.resize( tangents.count() );
+		transTangents.fill( Vector3() );
+		transBitangents.resize( bitangents.count() );
+		transBitangents.fill( Vector3() );
+
+		// The bone palette: every bone, then the skin transform for bones
+		// missing from the skeleton, then identity for bad partition indices
+		int numBones = bones.count();
+		QVector<SkinBone> palette( numBones + 2 );
+
+		Transform base = viewTrans() * skelTrans;
+		Node * root = findParent( skelRoot );
+		QVector<Node *> boneNodes( numBones );
+
+		if ( root )
+			root->findChildren( boneSlots, boneNodes );
+
+		for ( int b = 0; b < numBones; b++ ) {
+			Node * bone = boneNodes.value( boneSlots.value( bones[b], b ) );
+
+			if ( bone ) {
+				palette[b].set( base * bone->localTransFrom( skelRoot ) * weights.value( b ).trans );
+
+				if ( b < weights.count() )
+					weights[b].tcenter = bone->viewTrans() * weights[b].center;
+			} else {
+				palette[b].set( base );
+			}
+		}
+
+		palette[numBones].set( base );
+		palette[numBones + 1].set( Transform() );
+
+		SkinJob job;
+		job.palette = palette.constData();
+		job.offsets = skinOffsets.constData();
+		job.weights = skinWeights.constData();
+		job.verts = verts.constData();
+		job.norms = norms.constData();
+		job.tangents = tangents.constData();
+		job.bitangents = bitangents.constData();
+		job.transVerts = transVerts.data();
+		job.transNorms = transNorms.data();
+		job.transTangents = transTangents.data();
+		job.transBitangents = transBitangents.data();
+		job.numNorms = norms.count();
+		job.numTangents = tangents.count();
+		job.numBitangents = bitangents.count();
+
+		skinVertices( job, verts.count() );
+
+		upBuffers |= ( 1 << BufferCache::Vertices ) | ( 1 << BufferCache::Normals );
 
 		bndSphere = BoundSphere( transVerts );
 		bndSphere.applyInv( viewTrans() );
 		upBounds = false;
 	} else {
-		transVerts = verts;
-		transNorms = norms;
+		// an array still sharing its source's data cannot have changed
+		if ( transVerts.constData() != verts.constData() ) {
+			transVerts = verts;
+			upBuffers |= 1 << BufferCache::Vertices;
+		}
+
+		if ( transNorms.constData() != norms.constData() ) {
+			transNorms = norms;
+			upBuffers |= 1 << BufferCache::Normals;
+		}
+
 		transTangents = tangents;
 		transBitangents = bitangents;
 	}
@@ -882,9 +1086,37 @@ void Mesh::transformShapes()
 	else
 	{
 	*/
-	sortedTriangles = triangles;
+	if ( sortedTriangles.constData() != triangles.constData() ) {
+		sortedTriangles = triangles;
+		upBuffers |= 1 << BufferCache::Indices;
+	}
 	//}
 
+	if ( upBuffers & ( 1 << BufferCache::Indices ) ) {
+		// draw the strips as triangles, so that the mesh takes a single draw call
+		drawIndices.clear();
+		drawIndices.reserve( sortedTriangles.count() * 3 );
+
+		for ( const Triangle & t : sortedTriangles ) {
+			drawIndices << t[0] << t[1] << t[2];
+		}
+
+		for ( const QVector<quint16> & strip : tristrips ) {
+			for ( int i = 2; i < strip.count(); i++ ) {
+				quint16 a = strip[i - 2], b = strip[i - 1], c = strip[i];
+
+				if ( a == b || b == c || a == c )
+					continue;
+
+				// every other triangle of a strip is wound the other way
+				if ( i & 1 )
+					drawIndices << b << a << c;
+				else
+					drawIndices << a << b << c;
+			}
+		}
+	}
+
 	MaterialProperty * matprop = findProperty<MaterialProperty>();
 
 	if ( matprop && matprop->alphaValue() != 1.0 ) {
@@ -893,8 +1125,11 @@ void Mesh::transformShapes()
 
 		for ( int c = 0; c < colors.count(); c++ )
 			transColors[c] = colors[c].blend( a );
-	} else {
+
+		upBuffers |= 1 << BufferCache::Colors;
+	} else if ( transColors.constData() != colors.constData() ) {
 		transColors = colors;
+		upBuffers |= 1 << BufferCache::Colors;
 	}
 }
 
@@ -913,8 +1148,6 @@ void Mesh::drawShapes( NodeList * draw2nd )
 	if ( isHidden() || !Options::drawMeshes() )
 		return;
 
-	auto nif = static_cast<const NifModel *>(iBlock.model());
-	
 	if ( Node::SELECTING ) {
 		int s_nodeId = ID2COLORKEY( nodeId );
 		glColor4ubv( (GLubyte *)&s_nodeId );
@@ -942,23 +1175,30 @@ void Mesh::drawShapes( NodeList * draw2nd )
 	glEnable( GL_POLYGON_OFFSET_FILL );
 	glPolygonOffset( 1.0f, 2.0f );
 
+	// skinned meshes change every frame, rigid ones only when edited or morphed
+	BufferCache * buffers = scene->buffers;
+	bool stream = !transformRigid;
+
 	glEnableClientState( GL_VERTEX_ARRAY );
-	glVertexPointer( 3, GL_FLOAT, 0, transVerts.data() );
+	glVertexPointer( 3, GL_FLOAT, 0, buffers->bind( this, BufferCache::Vertices, transVerts.constData(), transVerts.count() * sizeof( Vector3 ), upBuffers, stream ) );
 
 	if ( !Node::SELECTING ) {
 		if ( transNorms.count() ) {
 			glEnableClientState( GL_NORMAL_ARRAY );
-			glNormalPointer( GL_FLOAT, 0, transNorms.data() );
+			glNormalPointer( GL_FLOAT, 0, buffers->bind( this, BufferCache::Normals, transNorms.constData(), transNorms.count() * sizeof( Vector3 ), upBuffers, stream ) );
 		}
 
 		if ( transColors.count() ) {
 			glEnableClientState( GL_COLOR_ARRAY );
-			glColorPointer( 4, GL_FLOAT, 0, transColors.data() );
+			glColorPointer( 4, GL_FLOAT, 0, buffers->bind( this, BufferCache::Colors, transColors.constData(), transColors.count() * sizeof( Color4 ), upBuffers, stream ) );
 		} else {
 			glColor( Color3( 1.0f, 0.2f, 1.0f ) );
 		}
 	}
 
+	// the texture coordinates are still client arrays
+	buffers->unbind();
+
 	if ( !Node::SELECTING )
 		shader = scene->renderer->setupProgram( this, shader );
 
@@ -969,45 +1209,39 @@ void Mesh::drawShapes( NodeList * draw2nd )
 		glDisable( GL_CULL_FACE );
 	}
 
-	auto bsLOD = nif->getBlock( iBlock, "BSLODTriShape" );
-	if ( !bsLOD.isValid() ) {
+	// render the triangles, limited to the visible levels of a BSLODTriShape, then the strips
+	int numTriangles = sortedTriangles.count() * 3;
+	int numDrawn = numTriangles;
 
-		// render the triangles
-		if ( sortedTriangles.count() )
-			glDrawElements( GL_TRIANGLES, sortedTriangles.count() * 3, GL_UNSIGNED_SHORT, sortedTriangles.data() );
+	if ( isLOD ) {
+		int n = lodSizes[0];
 
-	} else {
-		auto lod0 = nif->get<uint>( bsLOD, "Level 0 Size" );
-		auto lod1 = nif->get<uint>( bsLOD, "Level 1 Size" );
-		auto lod2 = nif->get<uint>( bsLOD, "Level 2 Size" );
-
-		auto lod0tris = sortedTriangles.mid( 0, lod0 );
-		auto lod1tris = sortedTriangles.mid( lod0, lod1 );
-		auto lod2tris = sortedTriangles.mid( lod0 + lod1, lod2 );
-
-		QSettings cfg;
-		int lodLevel = cfg.value( "GLView/LOD Level", 2 ).toInt();
-
-		// render level 0 (always visible)
-		if ( lod0tris.count() )
-			glDrawElements( GL_TRIANGLES, lod0tris.count() * 3, GL_UNSIGNED_SHORT, lod0tris.data() );
-
-		if ( lodLevel > 0 ) {
-			// render level 1
-			if ( lod1tris.count() )
-				glDrawElements( GL_TRIANGLES, lod1tris.count() * 3, GL_UNSIGNED_SHORT, lod1tris.data() );
-			
-			if ( lodLevel > 1 ) {
-				// render level 2
-				if ( lod2tris.count() )
-					glDrawElements( GL_TRIANGLES, lod2tris.count() * 3, GL_UNSIGNED_SHORT, lod2tris.data() );
-			}
-		}
+		if ( scene->lodLevel > 0 )
+			n += lodSizes[1];
+
+		if ( scene->lodLevel > 1 )
+			n += lodSizes[2];
+
+		numDrawn = qBound( 0, n * 3, numTriangles );
 	}
 
-	// render the tristrips
-	for ( int s = 0; s < tristrips.count(); s++ )
-		glDrawElements( GL_TRIANGLE_STRIP, tristrips[s].count(), GL_UNSIGNED_SHORT, tristrips[s].data() );
+	if ( drawIndices.count() ) {
+		// with buffer objects this is an offset into the bound buffer, not a pointer, so offsets are added as bytes
+		const void * idx = buffers->bind( this, BufferCache::Indices, drawIndices.constData(), drawIndices.count() * sizeof( quint16 ), upBuffers );
+		const void * strips = reinterpret_cast<const void *>( reinterpret_cast<quintptr>( idx ) + numTriangles * sizeof( quint16 ) );
+
+		if ( numDrawn == numTriangles ) {
+			glDrawElements( GL_TRIANGLES, drawIndices.count(), GL_UNSIGNED_SHORT, idx );
+		} else {
+			if ( numDrawn )
+				glDrawElements( GL_TRIANGLES, numDrawn, GL_UNSIGNED_SHORT, idx );
+
+			if ( drawIndices.count() > numTriangles )
+				glDrawElements( GL_TRIANGLES, drawIndices.count() - numTriangles, GL_UNSIGNED_SHORT, strips );
+		}
+
+		buffers->unbind();
+	}
 
 	if ( double_sided || double_sided_es ) {
 		glEnable( GL_CULL_FACE );
@@ -1114,10 +1348,8 @@ void Mesh::drawSelection() const
 
 		if ( points.isValid() ) {
 			for ( int j = 0; j < nif->rowCount( points ); j++ ) {
-				QModelIndex iPoints = points.child( j, 0 );
-
-				for ( int k = 0; k < nif->rowCount( iPoints ); k++ ) {
-					glVertex( transVerts.value( nif->get<quint16>( iPoints.child( k, 0 ) ) ) );
+				for ( quint16 point : nif->getArray<quint16>( points.child( j, 0 ) ) ) {
+					glVertex( transVerts.value( point ) );
 				}
 			}
 		}
@@ -1131,12 +1363,12 @@ void Mesh::drawSelection() const
 			QModelIndex iPoints = points.child( i, 0 );
 
 			if ( nif->isArray( scene->currentIndex ) ) {
-				for ( int j = 0; j < nif->rowCount( iPoints ); j++ ) {
-					glVertex( transVerts.value( nif->get<quint16>( iPoints.child( j, 0 ) ) ) );
+				for ( quint16 point : nif->getArray<quint16>( iPoints ) ) {
+					glVertex( transVerts.value( point ) );
 				}
 			} else {
 				iPoints = scene->currentIndex.parent();
-				glVertex( transVerts.value( nif->get<quint16>( iPoints.child( i, 0 ) ) ) );
+				glVertex( transVerts.value( nif->getArray<quint16>( iPoints ).value( i ) ) );
 			}
 
 			glEnd();
@@ -34,11 +34,14 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define GLMESH_H
 
 #include "glnode.h" // Inherited
+#include "glbuffers.h"
 #include "gltools.h"
 
 #include <QPersistentModelIndex>
+#include <QHash>
 #include <QVector>
 #include <QString>
+#include <QStringList>
 
 
 //! \file glmesh.h Mesh class
@@ -47,7 +50,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 class Mesh : public Node
 {
 public:
-	Mesh( Scene * s, const QModelIndex & b ) : Node( s, b ) { double_sided = false; double_sided_es = false; }
+	Mesh( Scene * s, const QModelIndex & b ) : Node( s, b ) { double_sided = false; double_sided_es = false; shaderRevision = -1; upBuffers = BufferCache::AllArrays; isLOD = false; }
 	~Mesh() { clear(); }
 
 	void clear() override;
@@ -83,6 +86,13 @@ protected:
 	bool upData;
 	//! Unsure - does teh skin data need updating?
 	bool upSkin;
+	//! Arrays changed since they were last uploaded, as BufferCache::Array bits
+	int upBuffers;
+
+	//! Whether this is a BSLODTriShape
+	bool isLOD;
+	//! Triangle counts of the BSLODTriShape levels
+	int lodSizes[3];
 
 	//! Vertices
 	QVector<Vector3> verts;
@@ -115,12 +125,24 @@ protected:
 	QVector<BoneWeights> weights;
 	QVector<SkinPartition> partitions;
 
+	//! Start of the influences of each vertex in skinWeights, plus one past the last
+	QVector<int> skinOffsets;
+	//! Bone influences of all vertices, as bone palette slot and weight
+	QVector<QPair<int, float> > skinWeights;
+	//! Slot in bones of each bone node id
+	QHash<int, int> boneSlots;
+
+	//! Pack the skin weights and partitions into per vertex influences
+	void packSkin();
+
 	//! Triangles
 	QVector<Triangle> triangles;
 	//! Strip points
 	QList<QVector<quint16> > tristrips;
 	//! Sorted triangles
 	QVector<Triangle> sortedTriangles;
+	//! Sorted triangles followed by the triangulated strips, as kept in the index buffer
+	QVector<quint16> drawIndices;
 	//! Triangle indices
 	QVector<quint16> indices;
 
@@ -131,6 +153,15 @@ protected:
 
 	QString shader;
 
+	//! Programs whose conditions the mesh satisfied, in the order they are tried
+	QStringList shaderPrograms;
+	//! The active properties when shaderPrograms was filled
+	QList<Property *> shaderProperties;
+	//! The sum of the revisions of shaderProperties when shaderPrograms was filled
+	qint64 shaderPropertyRevisions;
+	//! The renderer revision when shaderPrograms was filled, or -1 if it is stale
+	int shaderRevision;
+
 	friend class MorphController;
 	friend class UVController;
 	friend class Renderer;
@@ -612,6 +612,12 @@ void Node::update( const NifModel * nif, const QModelIndex & index )
 
 void Node::makeParent( Node * newParent )
 {
+	// while blocks are deferred a cycle may be pruned at a link the scene already followed
+	for ( Node * p = newParent; p; p = p->parent ) {
+		if ( p == this )
+			return;
+	}
+
 	if ( parent )
 		parent->children.del( this );
 
@@ -729,6 +735,24 @@ Node * Node::findChild( int id ) const
 	return 0;
 }
 
+/*!
+ * Looks up several nodes in one pass over the subtree: a descendant whose id
+ * maps to slot n in ids is stored in found[n], unless an earlier one was.
+ */
+void Node::findChildren( const QHash<int, int> & ids, QVector<Node *> & found ) const
+{
+	for ( Node * child : children.list() ) {
+		if ( child ) {
+			int slot = ids.value( child->nodeId, -1 );
+
+			if ( slot >= 0 && slot < found.count() && !found[slot] )
+				found[slot] = child;
+
+			child->findChildren( ids, found );
+		}
+	}
+}
+
 Node * Node::findChild( const QString & name ) const
 {
 	if ( this->name == name )
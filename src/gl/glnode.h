@@ -36,9 +36,11 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "glcontrolable.h" // Inherited
 #include "glproperty.h"
 
+#include <QHash>
 #include <QList>
 #include <QPersistentModelIndex>
 #include <QPointer>
+#include <QVector>
 
 
 class Node;
@@ -111,6 +113,7 @@ public:
 	Node * findParent( int id ) const;
 	Node * findChild( int id ) const;
 	Node * findChild( const QString & name ) const;
+	void findChildren( const QHash<int, int> & ids, QVector<Node *> & found ) const;
 	Node * parentNode() const { return parent; }
 	void makeParent( Node * parent );
 
@@ -94,6 +94,13 @@ Property * Property::create( Scene * scene, const NifModel * nif, const QModelIn
 	return property;
 }
 
+void Property::update( const NifModel * nif, const QModelIndex & index )
+{
+	Controllable::update( nif, index );
+
+	rev++;
+}
+
 PropertyList::PropertyList()
 {
 }
@@ -296,6 +303,10 @@ void TexturingProperty::update( const NifModel * nif, const QModelIndex & proper
 {
 	Property::update( nif, property );
 
+	// the source or its file name may have changed
+	for ( int t = 0; t < numTextures; t++ )
+		textures[t].derived.clear();
+
 	if ( iBlock.isValid() && iBlock == property ) {
 		static const char * texnames[numTextures] = {
 			"Base Texture", "Dark Texture", "Detail Texture", "Gloss Texture", "Glow Texture", "Bump Map Texture", "Decal 0 Texture", "Decal 1 Texture", "Decal 2 Texture", "Decal 3 Texture"
@@ -457,6 +468,31 @@ QString TexturingProperty::fileName( int id ) const
 	return QString();
 }
 
+QString TexturingProperty::fileName( int id, const QString & suffix ) const
+{
+	if ( id < 0 || id > (numTextures - 1) )
+		return QString();
+
+	auto it = textures[id].derived.constFind( suffix );
+
+	if ( it != textures[id].derived.constEnd() )
+		return it.value();
+
+	QString fname = fileName( id );
+
+	if ( !fname.isEmpty() ) {
+		int pos = fname.indexOf( "_" );
+
+		if ( pos >= 0 )
+			fname = fname.left( pos ) + suffix + ".dds";
+		else if ( ( pos = fname.lastIndexOf( "." ) ) >= 0 )
+			fname = fname.insert( pos, suffix );
+	}
+
+	textures[id].derived.insert( suffix, fname );
+	return fname;
+}
+
 int TexturingProperty::coordSet( int id ) const
 {
 	if ( id >= 0 && id <= (numTextures - 1) ) {
@@ -496,7 +532,13 @@ public:
 
 		// TexturingProperty
 		if ( target ) {
-			target->textures[flipSlot & 7 ].iSource = nif->getBlock( nif->getLink( iSources.child( (int)r, 0 ) ), "NiSourceTexture" );
+			TexturingProperty::TexDesc & tex = target->textures[flipSlot & 7];
+			QModelIndex iSource = nif->getBlock( nif->getLink( iSources.child( (int)r, 0 ) ), "NiSourceTexture" );
+
+			if ( tex.iSource != iSource ) {
+				tex.iSource = iSource;
+				tex.derived.clear();
+			}
 		} else if ( oldTarget ) {
 			oldTarget->iImage = nif->getBlock( nif->getLink( iSources.child( (int)r, 0 ) ), "NiImage" );
 		}
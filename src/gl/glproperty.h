@@ -52,9 +52,10 @@ class Property : public Controllable
 {
 protected:
 	//! Protected constructor; see Controllable()
-	Property( Scene * scene, const QModelIndex & index ) : Controllable( scene, index ), ref( 0 ) {}
+	Property( Scene * scene, const QModelIndex & index ) : Controllable( scene, index ), ref( 0 ), rev( 0 ) {}
 
 	int ref;
+	int rev;
 
 	//! List of properties
 	friend class PropertyList;
@@ -68,6 +69,11 @@ public:
 	 */
 	static Property * create( Scene * scene, const NifModel * nif, const QModelIndex & index );
 
+	void update( const NifModel * nif, const QModelIndex & index ) override;
+
+	//! Counts the updates of the property; state derived from it is stale once this changes
+	int revision() const { return rev; }
+
 	enum Type
 	{
 		Alpha, ZBuffer, Material, Texturing, Texture, Specular, Wireframe, VertexColor, Stencil, ShaderLighting
@@ -204,6 +210,9 @@ class TexturingProperty final : public Property
 		Vector2 tiling;
 		float rotation;
 		Vector2 center;
+
+		//! File names derived from the source's, by suffix; see fileName( int, const QString & )
+		mutable QHash<QString, QString> derived;
 	};
 
 public:
@@ -222,6 +231,8 @@ public:
 	bool bind( int id, const QList<QVector<Vector2> > & texcoords, int stage );
 
 	QString fileName( int id ) const;
+	//! The file name of texture \a id with \a suffix appended to its stem, e.g. "_n" for its normal map
+	QString fileName( int id, const QString & suffix ) const;
 	int coordSet( int id ) const;
 
 	static int getId( const QString & id );
@@ -41,6 +41,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <QOpenGLContext>
 #include <QOpenGLFunctions>
+#include <QSet>
+#include <QSettings>
 
 
 //! \file glscene.cpp Scene management
@@ -48,18 +50,26 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 Scene::Scene( TexCache * texcache, QOpenGLContext * context, QOpenGLFunctions * functions )
 {
 	renderer = new Renderer( context, functions );
+	buffers = new BufferCache( functions );
 
 	currentBlock = currentIndex = QModelIndex();
 	animate = true;
 
 	time = 0.0;
 	sceneBoundsValid = timeBoundsValid = false;
+	depNodes = depProperties = -1;
 
 	textures = texcache;
+	lodLevel = 2;
 }
 
 Scene::~Scene()
 {
+	// the meshes release their buffers
+	nodes.clear();
+	roots.clear();
+
+	delete buffers;
 	delete renderer;
 }
 
@@ -73,6 +83,10 @@ void Scene::clear( bool flushTextures )
 	animGroups.clear();
 	animTags.clear();
 
+	nodeDeps.clear();
+	propertyDeps.clear();
+	depNodes = depProperties = -1;
+
 	//if ( flushTextures )
 	textures->flush();
 
@@ -90,12 +104,28 @@ void Scene::update( const NifModel * nif, const QModelIndex & index )
 		if ( !block.isValid() )
 			return;
 
-		for ( Property * prop : properties.list() ) {
-			prop->update( nif, block );
-		}
+		// objects created since the index was built may read any block
+		if ( depNodes != nodes.list().count() || depProperties != properties.list().count() )
+			updateDependencies( nif );
 
-		for ( Node * node : nodes.list() ) {
-			node->update( nif, block );
+		if ( isAnimation( nif, block ) ) {
+			for ( Property * prop : properties.list() ) {
+				prop->update( nif, block );
+			}
+
+			for ( Node * node : nodes.list() ) {
+				node->update( nif, block );
+			}
+		} else {
+			int b = nif->getBlockNumber( block );
+
+			for ( Property * prop : propertyDeps.values( b ) ) {
+				prop->update( nif, block );
+			}
+
+			for ( Node * node : nodeDeps.values( b ) ) {
+				node->update( nif, block );
+			}
 		}
 	} else {
 		properties.validate();
@@ -109,6 +139,7 @@ void Scene::update( const NifModel * nif, const QModelIndex & index )
 			p->update( nif, QModelIndex() );
 		}
 
+		// deferred blocks are parsed as the objects reading them are built
 		roots.clear();
 		for ( const auto link : nif->getRootLinks() ) {
 			QModelIndex iBlock = nif->getBlock( link );
@@ -122,11 +153,104 @@ void Scene::update( const NifModel * nif, const QModelIndex & index )
 				}
 			}
 		}
+
+		// the index reads the links of every block; it is built by the first edit
+		depNodes = depProperties = -1;
 	}
 
 	timeBoundsValid = false;
 }
 
+/*!
+ * Controller sequences name the objects they animate instead of linking
+ * them, so an interpolator or key data block of a sequence is read by
+ * objects it is not linked to. Changes to controllers, interpolators and
+ * key data are passed to every object instead of going through the index.
+ */
+bool Scene::isAnimation( const NifModel * nif, const QModelIndex & block )
+{
+	static const QStringList types = {
+		"NiTimeController", "NiInterpolator", "NiSequence",
+		"NiKeyframeData", "NiFloatData", "NiPosData", "NiBoolData", "NiColorData",
+		"NiMorphData", "NiUVData", "NiVisData", "NiBSplineData", "NiBSplineBasisData",
+		"NiTextKeyExtraData", "NiStringPalette", "NiDefaultAVObjectPalette"
+	};
+
+	for ( const QString & type : types ) {
+		if ( nif->inherits( block, type ) )
+			return true;
+	}
+
+	return false;
+}
+
+/*!
+ * An object reads its own block and the blocks it reaches through links
+ * without passing another object's block: its data, skin, controllers,
+ * interpolators and texture sources. The blocks of other nodes and
+ * properties only concern their own objects.
+ */
+void Scene::updateDependencies( const NifModel * nif )
+{
+	nodeDeps.clear();
+	propertyDeps.clear();
+
+	QSet<int> owned;
+
+	for ( Node * node : nodes.list() ) {
+		owned.insert( nif->getBlockNumber( node->index() ) );
+	}
+
+	for ( Property * prop : properties.list() ) {
+		owned.insert( nif->getBlockNumber( prop->index() ) );
+	}
+
+	auto reached = [nif, &owned]( int start ) {
+		QList<int> blocks;
+
+		if ( start < 0 )
+			return blocks;
+
+		QSet<int> seen;
+		QStack<int> stack;
+		stack.push( start );
+		seen.insert( start );
+
+		while ( !stack.isEmpty() ) {
+			int b = stack.pop();
+
+			if ( b != start && owned.contains( b ) )
+				continue;
+
+			blocks.append( b );
+
+			for ( const auto l : nif->getChildLinks( b ) + nif->getParentLinks( b ) ) {
+				if ( l >= 0 && !seen.contains( l ) ) {
+					seen.insert( l );
+					stack.push( l );
+				}
+			}
+		}
+
+		return blocks;
+	};
+
+	for ( Node * node : nodes.list() ) {
+		for ( const auto b : reached( nif->getBlockNumber( node->index() ) ) ) {
+			nodeDeps.insert( b, node );
+		}
+	}
+
+	for ( Property * prop : properties.list() ) {
+		for ( const auto b : reached( nif->getBlockNumber( prop->index() ) ) ) {
+			propertyDeps.insert( b, prop );
+		}
+	}
+
+	depNodes = nodes.list().count();
+	depProperties = properties.list().count();
+}
+
 void Scene::make( NifModel * nif, bool flushTextures )
 {
 	clear( flushTextures );
@@ -239,12 +363,15 @@ void Scene::transform( const Transform & trans, float time )
 	}
 
 	sceneBoundsValid = false;
-
-	// TODO: purge unused textures
 }
 
 void Scene::draw()
 {
+	textures->beginFrame();
+	buffers->flush();
+
+	lodLevel = QSettings().value( "GLView/LOD Level", 2 ).toInt();
+
 	drawShapes();
 
 	if ( Options::drawNodes() )
@@ -255,6 +382,9 @@ void Scene::draw()
 		drawFurn();
 
 	drawSelection();
+
+	// release what the scene no longer draws
+	textures->purge();
 }
 
 void Scene::drawShapes()
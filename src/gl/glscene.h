@@ -35,6 +35,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "nifmodel.h"
 
+#include "glbuffers.h"
 #include "glnode.h"
 #include "glproperty.h"
 #include "gltex.h"
@@ -43,6 +44,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <QHash>
 #include <QMap>
+#include <QMultiHash>
 #include <QPersistentModelIndex>
 #include <QStack>
 #include <QStringList>
@@ -85,6 +87,8 @@ public:
 	Property * getProperty( const NifModel * nif, const QModelIndex & iProperty );
 
 	Renderer * renderer;
+	//! Vertex and index buffers of the meshes
+	BufferCache * buffers;
 
 	NodeList nodes;
 	PropertyList properties;
@@ -107,6 +111,9 @@ public:
 
 	TexCache * textures;
 
+	//! The BSLODTriShape level to draw, read from the settings each frame
+	int lodLevel;
+
 	QPersistentModelIndex currentBlock;
 	QPersistentModelIndex currentIndex;
 
@@ -121,6 +128,18 @@ protected:
 	mutable float tMin, tMax;
 
 	void updateTimeBounds() const;
+
+	//! Scene nodes reading each block, by block number
+	QMultiHash<int, Node *> nodeDeps;
+	//! Scene properties reading each block, by block number
+	QMultiHash<int, Property *> propertyDeps;
+	//! Number of nodes and properties when the dependency index was built; -1 if it needs rebuilding
+	int depNodes, depProperties;
+
+	//! Rebuild the index from blocks to the scene objects that read them
+	void updateDependencies( const NifModel * nif );
+	//! Whether block belongs to an animation, whose changes bypass the index
+	static bool isAnimation( const NifModel * nif, const QModelIndex & block );
 };
 
 #endif
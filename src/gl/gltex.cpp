@@ -41,12 +41,24 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <fsengine/fsmanager.h>
 #endif
 
+#include <QAtomicInteger>
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QFileSystemWatcher>
 #include <QListView>
+#include <QMutex>
 #include <QOpenGLContext>
 #include <QOpenGLFunctions>
+#include <QRegularExpression>
+#include <QRunnable>
+#include <QSet>
+#include <QStandardPaths>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm> // std::sort
 
 
 //! \file gltex.cpp TexCache management
@@ -56,6 +68,11 @@ GLint num_texture_units = 0;
 //! Maximum anisotropy
 float max_anisotropy = 1.0f;
 
+//! Nanoseconds spent in each texture loading stage, see TexCache::LoadTimes
+static QAtomicInteger<qint64> resolveTime, readTime, decodeTime, uploadTime;
+//! Number of textures loaded
+static QAtomicInt loadCount;
+
 //! Accessor function for glProperty etc.
 float get_max_anisotropy()
 {
@@ -133,48 +150,267 @@ void resetTextureUnits()
 
 
 /*
-    TexCache
+    TextureIndex
 */
 
-TexCache::TexCache( QObject * parent ) : QObject( parent )
+//! Directory listings and resolved texture names shared by every TexCache::find()
+/*!
+ * Looking a texture up used to stat every candidate name in every texture
+ * folder. Instead each directory is listed once, names are matched
+ * case-insensitively against the listing, and the outcome of a lookup is
+ * remembered. Listed directories are watched; a change to any of them, or
+ * to the texture folder options, discards what is affected.
+ *
+ * The names of the files in the archives are merged into one table when
+ * the archives change, so that finding a name in them is a single lookup.
+ */
+class TextureIndex final : public QObject
 {
-	watcher = new QFileSystemWatcher( this );
-	connect( watcher, &QFileSystemWatcher::fileChanged, this, &TexCache::fileChanged );
-}
+public:
+	//! Where a texture was found; both null if it was not
+	struct Source
+	{
+		//! Path in the file system, or in archive
+		QString path;
+		//! The path of the archive holding the texture, if any; archives are looked up again when extracting
+		QString archive;
+	};
+
+	//! Returns the index shared by all texture caches
+	static TextureIndex & get()
+	{
+		// never destroyed: the watcher must not outlive the application's event dispatcher
+		static TextureIndex * index = new TextureIndex;
+		return *index;
+	}
 
-TexCache::~TexCache()
-{
-	//flush();
-}
+	//! Returns the actual path of the file at path relative to folder, or a null string
+	QString locate( const QString & folder, const QString & path )
+	{
+		QString dir = QDir( folder ).absolutePath();
 
-QString TexCache::find( const QString & file, const QString & nifdir )
-{
-	return find( file, nifdir, *(new QByteArray()) );
-}
+		for ( const QString & part : path.split( QRegularExpression( "[/\\\\]" ), QString::SkipEmptyParts ) ) {
+			if ( part == "." )
+				continue;
 
-QString TexCache::find( const QString & file, const QString & nifdir, QByteArray & data )
-{
-	if ( file.isEmpty() )
-		return QString();
+			if ( part == ".." ) {
+				dir = QDir::cleanPath( dir + "/.." );
+				continue;
+			}
+
+			QString entry = listing( dir ).value( part.toLower() );
+
+			if ( entry.isEmpty() )
+				return QString();
+
+			dir = dir + "/" + entry;
+		}
+
+		return dir;
+	}
+
+	//! Returns where file was last found from nifdir, if it was looked up since the last change
+	bool lookup( const QString & nifdir, const QString & file, const QStringList & currentFolders, bool currentAlternatives, Source & source )
+	{
+		QMutexLocker lock( &mutex );
+
+		if ( currentFolders != folders || currentAlternatives != alternatives ) {
+			folders = currentFolders;
+			alternatives = currentAlternatives;
+			resolved.clear();
+			return false;
+		}
+
+		auto it = resolved.constFind( key( nifdir, file ) );
+
+		if ( it == resolved.constEnd() )
+			return false;
+
+		source = it.value();
+		return true;
+	}
+
+	//! Remembers where file was found from nifdir
+	void insert( const QString & nifdir, const QString & file, const Source & source )
+	{
+		QMutexLocker lock( &mutex );
+		resolved.insert( key( nifdir, file ), source );
+	}
+
+	//! Returns the path of the first archive holding the lower case path, or a null string
+	QString archive( const QString & path )
+	{
+		QMutexLocker lock( &mutex );
+		return archived.value( path );
+	}
+
+	//! Watches the directories that were listed on other threads; call from the GUI thread
+	void watchPending()
+	{
+		QMutexLocker lock( &mutex );
+
+		if ( !unwatched.isEmpty() ) {
+			watcher->addPaths( unwatched );
+			unwatched.clear();
+		}
+	}
+
+private:
+	TextureIndex() : changes( 0 ), alternatives( false )
+	{
+		watcher = new QFileSystemWatcher( this );
+
+		connect( watcher, &QFileSystemWatcher::directoryChanged, this, [this]( const QString & dir ) {
+			QMutexLocker lock( &mutex );
+			listings.remove( dir );
+			resolved.clear();
+			changes++;
+		} );
+
+#ifdef FSENGINE
+		indexArchives();
+
+		// textures may now be found in other archives, or no longer in removed ones
+		connect( FSManager::get(), &FSManager::archivesChanged, this, &TextureIndex::indexArchives );
+#endif
+	}
+
+#ifdef FSENGINE
+	//! Merges the file names of the archives into archived; the archives are only changed on the GUI thread, which runs this
+	void indexArchives()
+	{
+		QHash<QString, QString> names;
+
+		for ( FSArchiveFile * archive : FSManager::archiveList() ) {
+			if ( !archive )
+				continue;
+
+			QString path = archive->path();
+
+			// the first archive holding a name wins, as when they were searched in turn
+			for ( const QString & name : archive->fileList() ) {
+				if ( !names.contains( name ) )
+					names.insert( name, path );
+			}
+		}
 
+		QMutexLocker lock( &mutex );
+		archived.swap( names );
+		resolved.clear();
+	}
+#endif
+
+	//! Lookups are case-insensitive and do not depend on the separators used
+	static QString key( const QString & nifdir, const QString & file )
+	{
+		return nifdir + QLatin1Char( '|' ) + QDir::fromNativeSeparators( file ).toLower();
+	}
+
+	//! Returns the entries of dir by lower case name
+	/*!
+	 * The directory is listed without holding the mutex, so that a slow
+	 * file system does not stall the lookups of other threads.
+	 */
+	QHash<QString, QString> listing( const QString & dir )
+	{
+		quint64 listed;
+
+		{
+			QMutexLocker lock( &mutex );
+			auto it = listings.constFind( dir );
+
+			if ( it != listings.constEnd() )
+				return it.value();
+
+			listed = changes;
+		}
+
+		QHash<QString, QString> entries;
+		QDir d( dir );
+
+		for ( const QString & entry : d.entryList( QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot ) ) {
+			QString lower = entry.toLower();
+
+			if ( !entries.contains( lower ) )
+				entries.insert( lower, entry );
+		}
+
+		bool exists = d.exists();
+
+		QMutexLocker lock( &mutex );
+
+		// another thread may have listed it meanwhile
+		auto it = listings.constFind( dir );
+
+		if ( it != listings.constEnd() )
+			return it.value();
+
+		// a directory changed while listing; this listing may be stale, so use it once only
+		if ( listed != changes )
+			return entries;
+
+		// the watcher lives in the GUI thread; directories listed elsewhere wait for watchPending()
+		if ( exists ) {
+			if ( QThread::currentThread() == watcher->thread() )
+				watcher->addPath( dir );
+			else
+				unwatched.append( dir );
+		}
+
+		listings.insert( dir, entries );
+
+		return entries;
+	}
+
+	QMutex mutex;
+	QFileSystemWatcher * watcher;
+
+	//! Listed directories
+	QHash<QString, QHash<QString, QString>> listings;
+	//! Number of directory changes seen, so that listings made meanwhile are not kept
+	quint64 changes;
+	//! Outcome of each lookup, see key()
+	QHash<QString, Source> resolved;
+	//! Directories listed off the GUI thread and not yet watched
+	QStringList unwatched;
+	//! The archive holding each file of the archives, by lower case path
+	QHash<QString, QString> archived;
+
+	//! Options the lookups were made with
+	QStringList folders;
+	bool alternatives;
+};
+
+
+//! Finds a texture in the texture folders or the archives
+/*!
+ * \param file The texture file name, not empty
+ * \param nifdir The folder of the nif using the texture
+ * \param folders The texture folders option
+ * \param alternatives The texture alternatives option
+ * \param source Contains where the texture was found, if it was
+ * \return The name to report when the texture was not found
+ */
+static QString resolveTexture( const QString & file, const QString & nifdir, const QStringList & folders, bool alternatives, TextureIndex::Source & source )
+{
 	QString filename = QDir::toNativeSeparators( file );
 
 	while ( filename.startsWith( "/" ) || filename.startsWith( "\\" ) )
 		filename.remove( 0, 1 );
 
+	// folders and archives are both searched case-insensitively, see TextureIndex::locate()
 	QStringList extensions;
 	extensions << ".tga" << ".dds" << ".bmp" << ".nif" << ".texcache";
-#ifndef Q_OS_WIN
-	extensions << ".TGA" << ".DDS" << ".BMP" << ".NIF" << ".TEXCACHE";
-#endif
+	QString originalExt;
 	bool replaceExt = false;
 
-	if ( Options::textureAlternatives() ) {
+	if ( alternatives ) {
 		for ( const QString ext : QStringList{ extensions } )
 		{
-			if ( filename.endsWith( ext ) ) {
+			if ( filename.endsWith( ext, Qt::CaseInsensitive ) ) {
 				extensions.removeAll( ext );
 				extensions.prepend( ext );
+				originalExt = filename.right( ext.length() );
 				filename = filename.left( filename.length() - ext.length() );
 				replaceExt = true;
 				break;
@@ -182,61 +418,368 @@ QString TexCache::find( const QString & file, const QString & nifdir, QByteArray
 		}
 	}
 
-	// attempt to find the texture in one of the folders
-	QDir dir;
-	for ( const QString& ext : extensions ) {
-		if ( replaceExt ) {
-			filename += ext;
-		}
+	TextureIndex & index = TextureIndex::get();
+
+	if ( !index.lookup( nifdir, file, folders, alternatives, source ) ) {
+		source = TextureIndex::Source();
+
+		// attempt to find the texture in one of the folders, then in the archives
+		for ( const QString& ext : extensions ) {
+			QString name = replaceExt ? filename + ext : filename;
 
-		for ( QString folder : Options::textureFolders() ) {
-			// TODO: Always search nifdir without requiring a relative entry
-			// in folders?  Not too intuitive to require ".\" in your texture folder list
-			// even if it is added by default.
-			if ( folder.startsWith( "./" ) || folder.startsWith( ".\\" ) ) {
-				folder = nifdir + "/" + folder;
+			for ( QString folder : folders ) {
+				// TODO: Always search nifdir without requiring a relative entry
+				// in folders?  Not too intuitive to require ".\" in your texture folder list
+				// even if it is added by default.
+				if ( folder.startsWith( "./" ) || folder.startsWith( ".\\" ) ) {
+					folder = nifdir + "/" + folder;
+				}
+
+				source.path = index.locate( folder, name );
+
+				if ( !source.path.isEmpty() )
+					break;
 			}
 
-			dir.setPath( folder );
+#ifdef FSENGINE
+			if ( source.path.isEmpty() ) {
+				QString archived = QDir::fromNativeSeparators( name.toLower() );
+
+				source.archive = index.archive( archived );
 
-			if ( dir.exists( filename ) ) {
-				filename = dir.filePath( filename );
-				return filename;
+				if ( !source.archive.isEmpty() )
+					source.path = archived;
 			}
+#endif
+			if ( !source.path.isEmpty() || !replaceExt )
+				break;
 		}
 
+		index.insert( nifdir, file, source );
+	}
+
+	// Fix separators
+	filename = QDir::toNativeSeparators( filename );
+
+	if ( replaceExt )
+		return filename + originalExt; // Restore original file extension
+
+	return filename;
+}
+
+//! The archives a texture may be extracted from; they stay open while this is held
+struct TexArchives
+{
 #ifdef FSENGINE
-		// Search through archives last, and load any requested textures into memory.
-		for ( FSArchiveFile * archive : FSManager::archiveList() ) {
-			if ( archive ) {
-				filename = QDir::fromNativeSeparators( filename.toLower() );
+	//! Takes a snapshot of the registered archives, see FSManager::archiveSet()
+	TexArchives() : set( FSManager::archiveSet() ) {}
 
-				if ( archive->hasFile( filename ) ) {
-					QByteArray outData;
-					//qDebug() << "Extracting " << filename;
-					archive->fileContents( filename, outData );
+	FSArchiveSet set;
+#endif
+};
 
-					if ( !outData.isEmpty() ) {
-						data = outData;
+//! Loads a texture found in an archive into memory
+/*!
+ * If \a view is set, an uncompressed texture is not copied out of the
+ * archive (see BSA::fileView()); the caller must be done with the data
+ * before \a archives is released.
+ */
+static bool extractTexture( const TexArchives & archives, const TextureIndex::Source & source, QByteArray & data, bool view = false )
+{
+#ifdef FSENGINE
+	if ( !source.archive.isEmpty() ) {
+		for ( const QSharedPointer<FSArchiveHandler> & handler : archives.set ) {
+			FSArchiveFile * archive = handler->getArchive();
+
+			if ( !archive || archive->path() != source.archive )
+				continue;
+
+			QByteArray outData;
+			//qDebug() << "Extracting " << source.path;
+			if ( view )
+				archive->fileView( source.path, outData );
+			else
+				archive->fileContents( source.path, outData );
+
+			if ( !outData.isEmpty() ) {
+				data = outData;
+				return true;
+			}
 
-						return file;
-					}
-				}
+			break;
+		}
+	}
+#else
+	Q_UNUSED( archives );
+	Q_UNUSED( source );
+	Q_UNUSED( data );
+	Q_UNUSED( view );
+#endif
+
+	return false;
+}
+
+
+/*
+    TexDecodeTask
+*/
+
+//! Outcome of resolving and decoding a texture on the worker pool
+struct TexDecode
+{
+	TexDecode() : archived( false ), done( 0 ) {}
+
+	//! The texture file path
+	QString filepath;
+	//! The texture file contents
+	QByteArray data;
+	//! Whether data was extracted from an archive
+	bool archived;
+	//! The decoded texture; empty if it must be loaded on the render thread
+	TexImage image;
+	//! Status messages
+	QString status;
+	//! Set once the fields above are complete
+	QAtomicInt done;
+};
+
+//! Resolves, reads and decodes a texture on the worker pool
+class TexDecodeTask final : public QRunnable
+{
+public:
+	//! Options and archives are read here, on the GUI thread that owns them
+	TexDecodeTask( TexCache * cache, const QString & filename, const QString & nifFolder, const QSharedPointer<TexDecode> & result )
+		: cache( cache ), filename( filename ), nifFolder( nifFolder ),
+		folders( Options::textureFolders() ), alternatives( Options::textureAlternatives() ), cacheLimit( 0 ), result( result )
+	{
+		if ( Options::textureDiskCache() ) {
+			cacheFolder = QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + "/textures";
+			cacheLimit = Options::textureDiskCacheSize();
+		}
+	}
+
+	void run() override
+	{
+		TexDecode & r = *result;
+		TextureIndex::Source source;
+
+		QElapsedTimer timer;
+		timer.start();
+
+		if ( !filename.isEmpty() )
+			r.filepath = resolveTexture( filename, nifFolder, folders, alternatives, source );
+
+		resolveTime.fetchAndAddRelaxed( timer.nsecsElapsed() );
+		timer.restart();
+
+		// the archives stay open until this task is deleted, even if removed meanwhile
+		if ( extractTexture( archives, source, r.data, true ) ) {
+			r.filepath = filename;
+			r.archived = true;
+		} else {
+			if ( source.archive.isEmpty() && !source.path.isEmpty() )
+				r.filepath = source.path;
+
+			QFile f( r.filepath );
+
+			if ( f.open( QIODevice::ReadOnly ) )
+				r.data = f.readAll();
+		}
+
+		readTime.fetchAndAddRelaxed( timer.nsecsElapsed() );
+		timer.restart();
+
+		bool pixelData = r.filepath.endsWith( ".nif", Qt::CaseInsensitive ) || r.filepath.endsWith( ".texcache", Qt::CaseInsensitive );
+
+		try
+		{
+			if ( r.data.isEmpty() )
+				throw QString( "could not open file" );
+
+			if ( !pixelData ) {
+				if ( cacheFolder.isEmpty() )
+					texDecode( r.filepath, r.data, r.image );
+				else
+					texDecodeCached( r.filepath, r.data, r.image, cacheFolder, cacheLimit );
 			}
 		}
+		catch ( QString e )
+		{
+			r.status = e;
+		}
+
+		decodeTime.fetchAndAddRelaxed( timer.nsecsElapsed() );
+
+		// only pixel data is read again, on the render thread; it must not view an archive by then
+		if ( r.archived )
+			r.data = pixelData ? QByteArray( r.data.constData(), r.data.size() ) : QByteArray();
+
+		r.done.storeRelease( 1 );
+		QMetaObject::invokeMethod( cache, "sigRefresh", Qt::QueuedConnection );
+	}
+
+private:
+	TexCache * cache;
+	QString filename;
+	QString nifFolder;
+	QStringList folders;
+	bool alternatives;
+	//! Folder of the decoded texture cache, empty if it is disabled
+	QString cacheFolder;
+	//! Size the decoded texture cache is pruned to, in bytes
+	qint64 cacheLimit;
+	//! The archives the texture may be extracted from
+	TexArchives archives;
+	QSharedPointer<TexDecode> result;
+};
+
+
+/*
+    TexCache
+*/
+
+TexCache::TexCache( QObject * parent ) : QObject( parent ), placeholder( 0 ), frame( 0 )
+{
+	counters.hits = counters.misses = counters.evictions = 0;
+	counters.resident = 0;
+
+	watcher = new QFileSystemWatcher( this );
+	connect( watcher, &QFileSystemWatcher::fileChanged, this, &TexCache::fileChanged );
+
+	// create the index here so that its watcher lives in the GUI thread, not a decoder's
+	TextureIndex::get();
+
+	// leave a core to the render thread
+	decoders = new QThreadPool( this );
+	decoders->setMaxThreadCount( qMax( 1, QThread::idealThreadCount() - 1 ) );
+
+#ifdef FSENGINE
+	connect( FSManager::get(), &FSManager::archivesChanging, this, &TexCache::archivesChanging );
 #endif
-		if ( !replaceExt )
+}
+
+TexCache::~TexCache()
+{
+	// tasks signal this cache when they finish
+	decoders->clear();
+	decoders->waitForDone();
+	//flush();
+}
+
+TexCache::LoadTimes TexCache::loadTimes()
+{
+	LoadTimes times;
+	times.resolve = resolveTime.loadAcquire();
+	times.read = readTime.loadAcquire();
+	times.decode = decodeTime.loadAcquire();
+	times.upload = uploadTime.loadAcquire();
+	times.count = loadCount.loadAcquire();
+	return times;
+}
+
+TexCache::Stats TexCache::stats() const
+{
+	return counters;
+}
+
+void TexCache::beginFrame()
+{
+	++frame;
+}
+
+void TexCache::purge()
+{
+	qint64 budget = Options::textureBudget();
+	qint64 resident = 0;
+
+	for ( Tex * tx : textures )
+		resident += tx->bytes();
+	for ( Tex * tx : embedTextures )
+		resident += tx->bytes();
+
+	counters.resident = resident;
+
+	if ( resident <= budget )
+		return;
+
+	// textures not bound this frame, least recently used first
+	QVector<QPair<quint64, Tex *>> unused;
+
+	for ( Tex * tx : textures ) {
+		if ( tx->lastUsed < frame && !tx->pending )
+			unused.append( { tx->lastUsed, tx } );
+	}
+	for ( Tex * tx : embedTextures ) {
+		if ( tx->lastUsed < frame )
+			unused.append( { tx->lastUsed, tx } );
+	}
+
+	std::sort( unused.begin(), unused.end() );
+
+	QSet<Tex *> evicted;
+
+	for ( const auto & u : unused ) {
+		if ( resident <= budget )
 			break;
 
-		// Remove file extension
-		filename = filename.left( filename.length() - ext.length() );
+		resident -= u.second->bytes();
+		evicted.insert( u.second );
 	}
 
-	// Fix separators
-	filename = QDir::toNativeSeparators( filename );
+	QStringList paths;
 
-	if ( replaceExt )
-		return filename + extensions.value( 0 ); // Restore original file extension
+	QMutableHashIterator<QString, Tex *> it( textures );
+	while ( it.hasNext() ) {
+		if ( evicted.contains( it.next().value() ) ) {
+			paths << it.value()->filepath;
+			it.remove();
+		}
+	}
+
+	QMutableHashIterator<QModelIndex, Tex *> ie( embedTextures );
+	while ( ie.hasNext() ) {
+		if ( evicted.contains( ie.next().value() ) )
+			ie.remove();
+	}
+
+	for ( Tex * tx : evicted ) {
+		if ( tx->id )
+			glDeleteTextures( 1, &tx->id );
+	}
+	qDeleteAll( evicted );
+
+	// stop watching files no longer loaded
+	for ( Tex * tx : textures )
+		paths.removeAll( tx->filepath );
+
+	for ( const QString & path : paths ) {
+		if ( watcher->files().contains( path ) )
+			watcher->removePath( path );
+	}
+
+	counters.evictions += evicted.count();
+	counters.resident = resident;
+}
+
+QString TexCache::find( const QString & file, const QString & nifdir )
+{
+	QByteArray data;
+	return find( file, nifdir, data );
+}
+
+QString TexCache::find( const QString & file, const QString & nifdir, QByteArray & data )
+{
+	if ( file.isEmpty() )
+		return QString();
+
+	TextureIndex::Source source;
+	QString filename = resolveTexture( file, nifdir, Options::textureFolders(), Options::textureAlternatives(), source );
+
+	if ( extractTexture( TexArchives(), source, data ) )
+		return file;
+
+	if ( source.archive.isEmpty() && !source.path.isEmpty() )
+		return source.path;
 
 	return filename;
 }
@@ -283,6 +826,20 @@ bool TexCache::canLoad( const QString & filePath )
 	return texCanLoad( filePath );
 }
 
+void TexCache::archivesChanging()
+{
+	// running decoders hold their own archives, see TexArchives; queued ones would read stale ones
+	decoders->clear();
+
+	// the textures whose decode was dropped are requested again by bind()
+	for ( Tex * tx : textures ) {
+		if ( tx->pending && !tx->pending->done.loadAcquire() ) {
+			tx->pending.reset();
+			tx->reload = true;
+		}
+	}
+}
+
 void TexCache::fileChanged( const QString & filepath )
 {
 	QMutableHashIterator<QString, Tex *> it( textures );
@@ -309,6 +866,26 @@ void TexCache::fileChanged( const QString & filepath )
 }
 
 int TexCache::bind( const QString & fname )
+{
+	return bindFile( fname, false );
+}
+
+int TexCache::bind( const QModelIndex & iSource )
+{
+	return bindSource( iSource, false );
+}
+
+int TexCache::load( const QString & fname )
+{
+	return bindFile( fname, true );
+}
+
+int TexCache::load( const QModelIndex & iSource )
+{
+	return bindSource( iSource, true );
+}
+
+int TexCache::bindFile( const QString & fname, bool wait )
 {
 	Tex * tx = textures.value( fname );
 
@@ -323,29 +900,56 @@ int TexCache::bind( const QString & fname )
 		textures.insert( tx->filename, tx );
 	}
 
-	QByteArray outData;
+	tx->lastUsed = frame;
 
-	if ( tx->filepath.isEmpty() || tx->reload )
-		tx->filepath = find( tx->filename, nifFolder, outData );
+	if ( ( !tx->id || tx->reload ) && !tx->pending ) {
+		counters.misses++;
+		tx->reload = false;
+		tx->pending = QSharedPointer<TexDecode>( new TexDecode );
 
-	if ( !outData.isEmpty() ) {
-		tx->data = outData;
+		if ( wait )
+			TexDecodeTask( this, tx->filename, nifFolder, tx->pending ).run();
+		else
+			decoders->start( new TexDecodeTask( this, tx->filename, nifFolder, tx->pending ) );
 	}
 
-	if ( !tx->id || tx->reload ) {
+	// a decode started by an earlier bind() may still be queued
+	if ( wait && tx->pending && !tx->pending->done.loadAcquire() )
+		decoders->waitForDone();
+
+	if ( tx->pending && tx->pending->done.loadAcquire() ) {
+		tx->upload();
+		TextureIndex::get().watchPending();
+
 		if ( QFile::exists( tx->filepath ) && QFileInfo( tx->filepath ).isWritable() && ( !watcher->files().contains( tx->filepath ) ) )
 			watcher->addPath( tx->filepath );
+	}
+
+	if ( !tx->id ) {
+		// draw with a plain grey texture until the first decode arrives
+		if ( !placeholder ) {
+			static const quint8 grey[4] = { 0x80, 0x80, 0x80, 0xff };
+
+			glGenTextures( 1, &placeholder );
+			glBindTexture( GL_TEXTURE_2D, placeholder );
+			glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+			glTexImage2D( GL_TEXTURE_2D, 0, 4, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey );
+		}
 
-		tx->load();
+		glBindTexture( GL_TEXTURE_2D, placeholder );
+
+		return 1;
 	}
 
+	counters.hits++;
+
 	glBindTexture( GL_TEXTURE_2D, tx->id );
 	glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, get_max_anisotropy() );
 
 	return tx->mipmaps;
 }
 
-int TexCache::bind( const QModelIndex & iSource )
+int TexCache::bindSource( const QModelIndex & iSource, bool wait )
 {
 	const NifModel * nif = qobject_cast<const NifModel *>( iSource.model() );
 
@@ -357,6 +961,7 @@ int TexCache::bind( const QModelIndex & iSource )
 				Tex * tx = embedTextures.value( iData );
 
 				if ( !tx ) {
+					counters.misses++;
 					tx = new Tex();
 					tx->id = 0;
 					tx->reload = false;
@@ -370,15 +975,19 @@ int TexCache::bind( const QModelIndex & iSource )
 					catch ( QString e ) {
 						tx->status = e;
 					}
+				} else {
+					counters.hits++;
 				}
 
+				tx->lastUsed = frame;
+
 				glBindTexture( GL_TEXTURE_2D, tx->id );
 				glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, get_max_anisotropy() );
 
 				return tx->mipmaps;
 			}
 		} else if ( !nif->get<QString>( iSource, "File Name" ).isEmpty() ) {
-			return bind( nif->get<QString>( iSource, "File Name" ) );
+			return bindFile( nif->get<QString>( iSource, "File Name" ), wait );
 		}
 	}
 
@@ -401,6 +1010,11 @@ void TexCache::flush()
 	qDeleteAll( embedTextures );
 	embedTextures.clear();
 
+	if ( placeholder ) {
+		glDeleteTextures( 1, &placeholder );
+		placeholder = 0;
+	}
+
 	if ( !watcher->files().empty() ) {
 		watcher->removePaths( watcher->files() );
 	}
@@ -435,6 +1049,7 @@ QString TexCache::info( const QModelIndex & iSource )
 		} else {
 			QString filename = nif->get<QString>( iSource, "File Name" );
 			Tex * tx = textures.value( filename );
+			LoadTimes times = loadTimes();
 			temp = QString( "External texture file: %1\nTexture path: %2\nFormat: %3\nWidth: %4\nHeight: %5\nMipmaps: %6" )
 			       .arg( tx->filename )
 			       .arg( tx->filepath )
@@ -442,6 +1057,17 @@ QString TexCache::info( const QModelIndex & iSource )
 			       .arg( tx->width )
 			       .arg( tx->height )
 			       .arg( tx->mipmaps );
+			temp += QString( "\n\nCache hits: %1\nMisses: %2\nEvictions: %3\nResident: %4 MB" )
+			        .arg( counters.hits )
+			        .arg( counters.misses )
+			        .arg( counters.evictions )
+			        .arg( counters.resident / ( 1024 * 1024 ) );
+			temp += QString( "\n\nAll %1 textures loaded in (ms):\nResolve: %2\nRead: %3\nDecode: %4\nUpload: %5" )
+			        .arg( times.count )
+			        .arg( times.resolve / 1000000 )
+			        .arg( times.read / 1000000 )
+			        .arg( times.decode / 1000000 )
+			        .arg( times.upload / 1000000 );
 		}
 	}
 
@@ -468,7 +1094,18 @@ bool TexCache::importFile( NifModel * nif, const QModelIndex & iSource, QModelIn
 			QString filename = nif->get<QString>( iSource, "File Name" );
 			//qWarning() << "TexCache::importFile: Texture has filename (from NIF) " << filename;
 			Tex * tx = textures.value( filename );
-			return tx->savePixelData( nif, iSource, iData );
+
+			if ( !tx )
+				return false;
+
+			try
+			{
+				return tx->savePixelData( nif, iSource, iData );
+			}
+			catch ( QString e )
+			{
+				tx->status = e;
+			}
 		}
 	}
 
@@ -490,6 +1127,9 @@ void TexCache::Tex::load()
 
 	glBindTexture( GL_TEXTURE_2D, id );
 
+	QElapsedTimer timer;
+	timer.start();
+
 	try
 	{
 		texLoad( filepath, format, width, height, mipmaps, data );
@@ -498,6 +1138,54 @@ void TexCache::Tex::load()
 	{
 		status = e;
 	}
+
+	decodeTime.fetchAndAddRelaxed( timer.nsecsElapsed() );
+	loadCount.fetchAndAddRelaxed( 1 );
+}
+
+qint64 TexCache::Tex::bytes() const
+{
+	// RGBA8, a full mipmap chain adding a third
+	qint64 size = qint64( width ) * height * 4;
+
+	if ( mipmaps > 1 )
+		size += size / 3;
+
+	return size + data.size();
+}
+
+void TexCache::Tex::upload()
+{
+	QSharedPointer<TexDecode> decoded = pending;
+	pending.reset();
+
+	filepath = decoded->filepath;
+
+	if ( decoded->image.levels.isEmpty() && decoded->status.isEmpty() ) {
+		// pixel data files need a NifModel, they are loaded here as before
+		data = decoded->archived ? decoded->data : QByteArray();
+		load();
+		// the contents are read again on reload, do not keep them around
+		data = QByteArray();
+		return;
+	}
+
+	if ( !id )
+		glGenTextures( 1, &id );
+
+	glBindTexture( GL_TEXTURE_2D, id );
+
+	QElapsedTimer timer;
+	timer.start();
+
+	format = decoded->image.format;
+	width  = decoded->image.width;
+	height = decoded->image.height;
+	status = decoded->status;
+	mipmaps = texUpload( decoded->image );
+
+	uploadTime.fetchAndAddRelaxed( timer.nsecsElapsed() );
+	loadCount.fetchAndAddRelaxed( 1 );
 }
 
 bool TexCache::Tex::saveAsFile( const QModelIndex & index, QString & savepath )
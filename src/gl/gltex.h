@@ -39,14 +39,17 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QByteArray>
 #include <QHash>
 #include <QPersistentModelIndex>
+#include <QSharedPointer>
 #include <QString>
 
 
 class GroupBox;
+struct TexDecode;
 
 class QAction;
 class QFileSystemWatcher;
 class QOpenGLContext;
+class QThreadPool;
 
 typedef unsigned int GLuint;
 
@@ -63,6 +66,8 @@ class TexCache final : public QObject
 	//! A structure for storing information on a single texture.
 	struct Tex
 	{
+		Tex() : id( 0 ), width( 0 ), height( 0 ), mipmaps( 0 ), reload( false ), lastUsed( 0 ) {}
+
 		//! The texture file name.
 		QString filename;
 		//! The texture file path.
@@ -83,9 +88,17 @@ class TexCache final : public QObject
 		QString format;
 		//! Status messages
 		QString status;
+		//! Resolution and decode running on the worker pool, if any
+		QSharedPointer<TexDecode> pending;
+		//! Frame in which the texture was last bound
+		quint64 lastUsed;
 
 		//! Load the texture
 		void load();
+		//! Upload the texture decoded by pending
+		void upload();
+		//! Estimate the memory taken by the texture, in bytes
+		qint64 bytes() const;
 
 		//! Save the texture as a file
 		bool saveAsFile( const QModelIndex & index, QString & savepath );
@@ -104,6 +117,16 @@ public:
 	//! Bind a texture from pixel data
 	int bind( const QModelIndex & iSource );
 
+	//! Bind a texture from filename, waiting until it is loaded
+	/*!
+	 * bind() returns before a texture file is decoded and draws a placeholder
+	 * meanwhile. Callers outside the render loop that use the texture right
+	 * away, such as the texture spells, load it instead.
+	 */
+	int load( const QString & fname );
+	//! Bind a texture from pixel data, waiting until it is loaded
+	int load( const QModelIndex & iSource );
+
 	//! Debug function for getting info about a texture
 	QString info( const QModelIndex & iSource );
 
@@ -120,6 +143,45 @@ public:
 	//! Checks whether the given file can be loaded
 	static bool canLoad( const QString & file );
 
+	//! Time spent loading textures, by stage
+	struct LoadTimes
+	{
+		//! Nanoseconds spent finding texture files in folders and archives
+		qint64 resolve;
+		//! Nanoseconds spent reading files and extracting them from archives
+		qint64 read;
+		//! Nanoseconds spent decoding pixel data; includes the upload of textures loaded on the render thread
+		qint64 decode;
+		//! Nanoseconds spent uploading decoded textures on the render thread
+		qint64 upload;
+		//! Number of textures loaded
+		int count;
+	};
+
+	//! Returns the time spent loading textures by all caches since startup
+	static LoadTimes loadTimes();
+
+	//! Counters describing the use of a cache
+	struct Stats
+	{
+		//! Binds of a texture that was already loaded
+		quint64 hits;
+		//! Binds which started loading a texture
+		quint64 misses;
+		//! Textures released to stay within the budget
+		quint64 evictions;
+		//! Estimated memory taken by the loaded textures as of the last purge(), in bytes
+		qint64 resident;
+	};
+
+	//! Returns the counters of this cache
+	Stats stats() const;
+
+	//! Start a frame; the textures bound from now on are in use by the scene
+	void beginFrame();
+	//! Release the least recently used textures not bound this frame, until the cache fits in its budget
+	void purge();
+
 signals:
 	void sigRefresh();
 
@@ -135,11 +197,26 @@ public slots:
 
 protected slots:
 	void fileChanged( const QString & filepath );
+	//! Drops the queued decoders before FSManager changes the archives
+	void archivesChanging();
 
 protected:
+	//! Bind a texture from filename; if wait is set, decode it before returning
+	int bindFile( const QString & fname, bool wait );
+	//! Bind a texture from pixel data; if wait is set, decode a texture file before returning
+	int bindSource( const QModelIndex & iSource, bool wait );
+
 	QHash<QString, Tex *> textures;
 	QHash<QModelIndex, Tex *> embedTextures;
 	QFileSystemWatcher * watcher;
+	//! Resolves and decodes textures off the render thread
+	QThreadPool * decoders;
+	//! Bound in place of textures still being decoded
+	GLuint placeholder;
+
+	//! Current frame, see beginFrame()
+	quint64 frame;
+	Stats counters;
 
 	QString nifFolder;
 };
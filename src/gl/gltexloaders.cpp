@@ -37,14 +37,21 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "dds/DirectDrawSurface.h" // unused? check if upstream has cleaner or documented API yet
 
 #include <QBuffer>
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QDebug>
+#include <QDir>
 #include <QFile>
 #include <QFileInfo>
 #include <QModelIndex>
+#include <QMutex>
 #include <QOpenGLContext>
+#include <QSaveFile>
 #include <QString>
 #include <QtEndian>
 
+#include <algorithm> // std::copy, std::sort
+
 
 /*! \file gltexloaders.cpp
  * \brief Texture loading functions.
@@ -103,6 +110,53 @@ static const quint8 unk8bytes32[] = {
 	129, 8, 130, 32, 0, 65, 12, 0
 };
 
+//! Decoded levels are collected here instead of uploaded while texDecode() runs on this thread
+static thread_local TexImage * decodeTarget = nullptr;
+
+//! Directs the levels loaded on this thread into an image for the lifetime of the scope
+class DecodeScope final
+{
+public:
+	DecodeScope( TexImage & image ) : previous( decodeTarget )
+	{
+		decodeTarget = &image;
+	}
+
+	~DecodeScope()
+	{
+		decodeTarget = previous;
+	}
+
+private:
+	TexImage * previous;
+};
+
+//! Stores mipmap level m of the texture being loaded, to the bound OpenGL texture or to the decode target
+static void texStoreLevel( int m, int w, int h, const QByteArray & rgba )
+{
+	if ( !decodeTarget ) {
+		glTexImage2D( GL_TEXTURE_2D, m, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.constData() );
+		return;
+	}
+
+	if ( m == 0 ) {
+		decodeTarget->width = w;
+		decodeTarget->height = h;
+		decodeTarget->levels.clear();
+	}
+
+	decodeTarget->levels.append( rgba );
+}
+
+//! Stores mipmap level m of the texture being loaded, copying the pixels only if they are kept
+static void texStoreLevel( int m, int w, int h, const void * rgba )
+{
+	if ( !decodeTarget )
+		glTexImage2D( GL_TEXTURE_2D, m, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba );
+	else
+		texStoreLevel( m, w, h, QByteArray( (const char *)rgba, w * h * 4 ) );
+}
+
 //! Check whether a number is a power of two.
 bool isPowerOfTwo( unsigned int x )
 {
@@ -112,7 +166,7 @@ bool isPowerOfTwo( unsigned int x )
 	return ( x == 1 );
 }
 
-//! Completes mipmap sequence of the current active OpenGL texture.
+//! Completes mipmap sequence of the current active OpenGL texture, or of the decode target.
 /*!
  * \param m Number of mipmaps that are already in the texture.
  * \return Total number of mipmaps.
@@ -120,15 +174,28 @@ bool isPowerOfTwo( unsigned int x )
 int generateMipMaps( int m )
 {
 	GLint w = 0, h = 0;
+	quint8 * data;
 
 	// load the (m-1)'th mipmap as a basis
-	glGetTexLevelParameteriv( GL_TEXTURE_2D, m - 1, GL_TEXTURE_WIDTH, &w );
-	glGetTexLevelParameteriv( GL_TEXTURE_2D, m - 1, GL_TEXTURE_HEIGHT, &h );
+	if ( decodeTarget ) {
+		w = qMax( 1, int( decodeTarget->width >> ( m - 1 ) ) );
+		h = qMax( 1, int( decodeTarget->height >> ( m - 1 ) ) );
 
-	//qWarning() << m-1 << w << h;
+		const QByteArray & level = decodeTarget->levels.at( m - 1 );
+
+		data = (quint8 *)malloc( w * h * 4 );
+
+		if ( data )
+			memcpy( data, level.constData(), w * h * 4 );
+	} else {
+		glGetTexLevelParameteriv( GL_TEXTURE_2D, m - 1, GL_TEXTURE_WIDTH, &w );
+		glGetTexLevelParameteriv( GL_TEXTURE_2D, m - 1, GL_TEXTURE_HEIGHT, &h );
 
-	quint8 * data = (quint8 *)malloc( w * h * 4 );
-	glGetTexImage( GL_TEXTURE_2D, m - 1, GL_RGBA, GL_UNSIGNED_BYTE, data );
+		//qWarning() << m-1 << w << h;
+
+		data = (quint8 *)malloc( w * h * 4 );
+		glGetTexImage( GL_TEXTURE_2D, m - 1, GL_RGBA, GL_UNSIGNED_BYTE, data );
+	}
 
 	// now generate the mipmaps until width is one or height is one.
 	while ( w > 1 || h > 1 ) {
@@ -166,7 +233,7 @@ int generateMipMaps( int m )
 			src += yo;
 		}
 
-		glTexImage2D( GL_TEXTURE_2D, m++, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data );
+		texStoreLevel( m++, w, h, data );
 	}
 
 	free( data );
@@ -286,8 +353,10 @@ int texLoadRaw( QIODevice & f, int width, int height, int num_mipmaps, int bpp,
 	if ( bytespp * 8 != bpp || bpp > 32 || bpp < 8 )
 		throw QString( "unsupported image depth %1 / %2" ).arg( bpp ).arg( bytespp );
 
-	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
-	glPixelStorei( GL_UNPACK_SWAP_BYTES, GL_FALSE );
+	if ( !decodeTarget ) {
+		glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+		glPixelStorei( GL_UNPACK_SWAP_BYTES, GL_FALSE );
+	}
 
 	quint8 * data1 = (quint8 *)malloc( width * height * 4 );
 	quint8 * data2 = (quint8 *)malloc( width * height * 4 );
@@ -320,7 +389,7 @@ int texLoadRaw( QIODevice & f, int width, int height, int num_mipmaps, int bpp,
 
 		convertToRGBA( data1, w, h, bytespp, mask, flipV, flipH, data2 );
 
-		glTexImage2D( GL_TEXTURE_2D, m++, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data2 );
+		texStoreLevel( m++, w, h, data2 );
 
 		if ( w == 1 && h == 1 )
 			break;
@@ -341,8 +410,10 @@ int texLoadPal( QIODevice & f, int width, int height, int num_mipmaps, int bpp,
 	if ( bpp != 8 || bytespp != 1 )
 		throw QString( "unsupported image depth %1 / %2" ).arg( bpp ).arg( bytespp );
 
-	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
-	glPixelStorei( GL_UNPACK_SWAP_BYTES, GL_FALSE );
+	if ( !decodeTarget ) {
+		glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+		glPixelStorei( GL_UNPACK_SWAP_BYTES, GL_FALSE );
+	}
 
 	quint8 * data = (quint8 *)malloc( width * height * 1 );
 	quint8 * pixl = (quint8 *)malloc( width * height * 4 );
@@ -383,7 +454,7 @@ int texLoadPal( QIODevice & f, int width, int height, int num_mipmaps, int bpp,
 			}
 		}
 
-		glTexImage2D( GL_TEXTURE_2D, m++, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixl );
+		texStoreLevel( m++, w, h, pixl );
 
 		if ( w == 1 && h == 1 )
 			break;
@@ -569,6 +640,47 @@ void flipDXT( GLenum glFormat, int width, int height, unsigned char * image )
 	}
 }
 
+//! Load the mipmaps of a DXT compressed surface
+/*!
+ * \param dds The surface, its header already read
+ * \param mipmaps The number of mipmaps to read
+ * \return The total number of mipmaps
+ */
+GLuint texLoadDXT( DirectDrawSurface * dds, quint32 mipmaps )
+{
+	GLuint m = 0;
+
+	while ( m < mipmaps ) {
+		quint32 w = qMax( 1u, dds->width() >> m );
+		quint32 h = qMax( 1u, dds->height() >> m );
+
+		// decode face 0, mipmap m straight into the level
+		QByteArray pixels( w * h * 4, Qt::Uninitialized );
+
+		if ( !dds->mipmapRGBA( (quint8 *)pixels.data(), 0, m ) ) {
+			// convert texture to OpenGL RGBA format
+			Image img;
+			dds->mipmap( &img, 0, m );
+
+			Color32 * src = img.pixels();
+			quint8 * dst = (quint8 *)pixels.data();
+
+			for ( quint32 c = w * h; c > 0; c-- ) {
+				*dst++ = src->r;
+				*dst++ = src->g;
+				*dst++ = src->b;
+				*dst++ = src->a;
+				src++;
+			}
+		}
+
+		texStoreLevel( m++, w, h, pixels );
+	}
+
+	m = generateMipMaps( m );
+	return m;
+}
+
 //! Load a DXT compressed DDS texture from file
 /*!
  * \param f File to load from
@@ -591,40 +703,14 @@ GLuint texLoadDXT( QIODevice & f, GLenum /*glFormat*/, int /*blockSize*/, quint3
 	// load the pixels
 	f.seek( 0 );
 	QByteArray bytes = f.readAll();
-	GLuint m = 0;
 
-	while ( m < mipmaps ) {
-		// load face 0, mipmap m
-		Image * img = load_dds( (unsigned char *)bytes.data(), bytes.size(), 0, m );
-
-		if ( !img )
-			return (0);
-
-		// convert texture to OpenGL RGBA format
-		unsigned int w = img->width();
-		unsigned int h = img->height();
-		GLubyte * pixels = new GLubyte[w * h * 4];
-		Color32 * src = img->pixels();
-		GLubyte * dst = pixels;
-
-		//qWarning() << "flipV = " << flipV;
-		for ( quint32 y = 0; y < h; y++ ) {
-			for ( quint32 x = 0; x < w; x++ ) {
-				*dst++ = src->r;
-				*dst++ = src->g;
-				*dst++ = src->b;
-				*dst++ = src->a;
-				src++;
-			}
-		}
+	DirectDrawSurface * dds = open_dds( (const unsigned char *)bytes.constData(), bytes.size() );
 
-		delete img;
-		// load the texture into OpenGL
-		glTexImage2D( GL_TEXTURE_2D, m++, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels );
-		delete [] pixels;
-	}
+	if ( !dds )
+		return (0);
 
-	m = generateMipMaps( m );
+	GLuint m = texLoadDXT( dds, mipmaps );
+	delete dds;
 	return m;
 /*
 #ifdef WIN32
@@ -749,45 +835,17 @@ GLuint texLoadDDS( QIODevice & f, QString & texformat )
  */
 GLuint texLoadDXT( DDSFormat & hdr, const quint8 * pixels, uint size )
 {
-	int m = 0;
-
-	while ( m < (int)hdr.dwMipMapCount ) {
-		// load face 0, mipmap m
-		Image * img = load_dds( pixels, (int)size, 0, m, &hdr );
-
-		if ( !img )
-			return (0);
+	DirectDrawSurface * dds = open_dds( pixels, (int)size, &hdr );
 
-		// convert texture to OpenGL RGBA format
-		unsigned int w = img->width();
-		unsigned int h = img->height();
-		GLubyte * pixels = new GLubyte[w * h * 4];
-		Color32 * src = img->pixels();
-		GLubyte * dst = pixels;
+	if ( !dds )
+		return (0);
 
-		//qWarning() << "flipV = " << flipV;
-		for ( quint32 y = 0; y < h; y++ ) {
-			for ( quint32 x = 0; x < w; x++ ) {
-				*dst++ = src->r;
-				*dst++ = src->g;
-				*dst++ = src->b;
-				*dst++ = src->a;
-				src++;
-			}
-		}
-
-		delete img;
-		// load the texture into OpenGL
-		glTexImage2D( GL_TEXTURE_2D, m++, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels );
-		delete [] pixels;
-	}
-
-	m = generateMipMaps( m );
+	GLuint m = texLoadDXT( dds, hdr.dwMipMapCount );
+	delete dds;
 	return m;
 }
 
 
-
 // TGA constants
 // Note that TGA_X_RLE = TGA_X + 8
 // i.e. RLE = hdr[2] & 0x8
@@ -1142,8 +1200,13 @@ bool texLoad( const QModelIndex & iData, QString & texformat, GLuint & width, GL
 		}
 
 		if ( ok ) {
-			glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, (GLint *)&width );
-			glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, (GLint *)&height );
+			if ( decodeTarget ) {
+				width = decodeTarget->width;
+				height = decodeTarget->height;
+			} else {
+				glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, (GLint *)&width );
+				glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, (GLint *)&height );
+			}
 		}
 	}
 
@@ -1217,12 +1280,250 @@ bool texLoad( const QString & filepath, QString & format, GLuint & width, GLuint
 
 	f.close();
 
-	glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, (GLint *)&width );
-	glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, (GLint *)&height );
+	if ( decodeTarget ) {
+		width = decodeTarget->width;
+		height = decodeTarget->height;
+	} else {
+		glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, (GLint *)&width );
+		glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, (GLint *)&height );
+	}
 
 	return mipmaps > 0;
 }
 
+// (public function, documented in gltexloaders.h)
+bool texDecode( const QString & filepath, QByteArray & data, TexImage & image )
+{
+	if ( filepath.endsWith( ".nif", Qt::CaseInsensitive ) || filepath.endsWith( ".texcache", Qt::CaseInsensitive ) )
+		throw QString( "pixel data files must be loaded on the render thread" );
+
+	DecodeScope scope( image );
+
+	GLuint width, height, mipmaps;
+	return texLoad( filepath, image.format, width, height, mipmaps, data );
+}
+
+//! Version of the output of the loaders; bump it whenever that changes, to invalidate cached textures
+static const quint32 TEXCACHE_VERSION = 1;
+//! Identifies a decoded texture in the cache
+static const char TEXCACHE_MAGIC[4] = { 'N', 'S', 'D', 'T' };
+
+//! Header of a decoded texture in the cache, followed by the format name and the levels
+struct TexCacheHeader
+{
+	char magic[4];
+	quint32 version;
+	quint32 width;
+	quint32 height;
+	quint32 levels;
+	quint32 formatSize;
+};
+
+//! Size in bytes of mipmap level m of an RGBA8 texture
+static qint64 texLevelSize( quint32 width, quint32 height, int m )
+{
+	return qint64( qMax( 1u, width >> m ) ) * qMax( 1u, height >> m ) * 4;
+}
+
+//! Maps a decoded texture from the cache
+static bool texReadCache( const QString & cachepath, TexImage & image )
+{
+	QSharedPointer<QFile> file( new QFile( cachepath ) );
+
+	if ( !file->open( QIODevice::ReadOnly ) || file->size() < qint64( sizeof( TexCacheHeader ) ) )
+		return false;
+
+	qint64 size = file->size();
+	const uchar * map = file->map( 0, size );
+
+	if ( !map )
+		return false;
+
+	TexCacheHeader hdr;
+	memcpy( &hdr, map, sizeof( hdr ) );
+
+	if ( memcmp( hdr.magic, TEXCACHE_MAGIC, 4 ) != 0 || hdr.version != TEXCACHE_VERSION || hdr.levels == 0 || hdr.levels > 32 )
+		return false;
+
+	qint64 offset = sizeof( hdr ) + hdr.formatSize;
+	qint64 total = offset;
+
+	for ( quint32 m = 0; m < hdr.levels; m++ )
+		total += texLevelSize( hdr.width, hdr.height, m );
+
+	if ( total != size )
+		return false;
+
+	image.format = QString::fromUtf8( (const char *)map + sizeof( hdr ), hdr.formatSize );
+	image.width  = hdr.width;
+	image.height = hdr.height;
+	image.levels.clear();
+
+	for ( quint32 m = 0; m < hdr.levels; m++ ) {
+		qint64 levelSize = texLevelSize( hdr.width, hdr.height, m );
+		image.levels.append( QByteArray::fromRawData( (const char *)map + offset, levelSize ) );
+		offset += levelSize;
+	}
+
+	// the levels point into the mapping, which lasts as long as the file object
+	image.mapping = file;
+
+	return true;
+}
+
+//! Stores a decoded texture in the cache
+static void texWriteCache( const QString & cachepath, const TexImage & image )
+{
+	QDir().mkpath( QFileInfo( cachepath ).absolutePath() );
+
+	QSaveFile file( cachepath );
+
+	if ( !file.open( QIODevice::WriteOnly ) )
+		return;
+
+	QByteArray format = image.format.toUtf8();
+
+	TexCacheHeader hdr;
+	memcpy( hdr.magic, TEXCACHE_MAGIC, 4 );
+	hdr.version = TEXCACHE_VERSION;
+	hdr.width   = image.width;
+	hdr.height  = image.height;
+	hdr.levels  = image.levels.count();
+	hdr.formatSize = format.size();
+
+	file.write( (const char *)&hdr, sizeof( hdr ) );
+	file.write( format );
+
+	for ( const QByteArray & level : image.levels )
+		file.write( level );
+
+	file.commit();
+}
+
+//! Marks a cached texture as used now, so that it is pruned last
+static void texTouchCache( const QString & cachepath )
+{
+#if QT_VERSION >= QT_VERSION_CHECK( 5, 10, 0 )
+	QFile file( cachepath );
+
+	if ( file.open( QIODevice::ReadWrite ) )
+		file.setFileTime( QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime );
+#else
+	// the access time is used instead, where the file system keeps it
+	Q_UNUSED( cachepath );
+#endif
+}
+
+//! Deletes the least recently used textures from the cache until it is well below limit
+/*!
+ * The size of the cache is counted once per folder and then kept up to date
+ * by the writes, so the folder is only listed again when it has to be pruned.
+ */
+static void texPruneCache( const QString & cacheFolder, qint64 written, qint64 limit )
+{
+	static QMutex mutex;
+	static QString folder;
+	static qint64 total = -1;
+
+	QMutexLocker lock( &mutex );
+
+	if ( folder != cacheFolder ) {
+		folder = cacheFolder;
+		total = -1;
+	}
+
+	if ( total >= 0 ) {
+		total += written;
+
+		if ( total <= limit )
+			return;
+	}
+
+	QFileInfoList entries = QDir( cacheFolder ).entryInfoList( { "*.rgba" }, QDir::Files );
+
+	total = 0;
+	for ( const QFileInfo & entry : entries )
+		total += entry.size();
+
+	if ( total <= limit )
+		return;
+
+	// least recently used first; mapped files cannot be deleted on some systems, those are skipped
+	auto used = []( const QFileInfo & entry ) {
+		return qMax( entry.lastModified(), entry.lastRead() );
+	};
+
+	std::sort( entries.begin(), entries.end(), [&used]( const QFileInfo & a, const QFileInfo & b ) {
+		return used( a ) < used( b );
+	} );
+
+	// leave some room, so that the next few writes do not prune again
+	qint64 target = limit - limit / 8;
+
+	for ( const QFileInfo & entry : entries ) {
+		if ( total <= target )
+			break;
+
+		if ( QFile::remove( entry.absoluteFilePath() ) )
+			total -= entry.size();
+	}
+}
+
+// (public function, documented in gltexloaders.h)
+bool texDecodeCached( const QString & filepath, QByteArray & data, TexImage & image, const QString & cacheFolder, qint64 cacheLimit )
+{
+	if ( data.isEmpty() ) {
+		QFile tmpF( filepath );
+
+		if ( !tmpF.open( QIODevice::ReadOnly ) )
+			throw QString( "could not open file" );
+
+		data = tmpF.readAll();
+
+		if ( data.isEmpty() )
+			return false;
+	}
+
+	// the extension selects the loader, so it is part of the key
+	QCryptographicHash hash( QCryptographicHash::Sha1 );
+	hash.addData( data );
+	hash.addData( QFileInfo( filepath ).suffix().toLower().toLatin1() );
+	hash.addData( (const char *)&TEXCACHE_VERSION, sizeof( TEXCACHE_VERSION ) );
+
+	QString cachepath = cacheFolder + "/" + QString::fromLatin1( hash.result().toHex() ) + ".rgba";
+
+	if ( texReadCache( cachepath, image ) ) {
+		texTouchCache( cachepath );
+		return true;
+	}
+
+	if ( !texDecode( filepath, data, image ) )
+		return false;
+
+	texWriteCache( cachepath, image );
+	texPruneCache( cacheFolder, QFileInfo( cachepath ).size(), cacheLimit );
+
+	return true;
+}
+
+// (public function, documented in gltexloaders.h)
+GLuint texUpload( const TexImage & image )
+{
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+	glPixelStorei( GL_UNPACK_SWAP_BYTES, GL_FALSE );
+
+	GLuint m = 0;
+
+	for ( const QByteArray & level : image.levels ) {
+		GLsizei w = qMax( 1u, image.width >> m );
+		GLsizei h = qMax( 1u, image.height >> m );
+
+		glTexImage2D( GL_TEXTURE_2D, m++, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, level.constData() );
+	}
+
+	return m;
+}
+
 // (public function, documented in gltexloaders.h)
 bool texCanLoad( const QString & filepath )
 {
@@ -1658,16 +1959,12 @@ bool texSaveNIF( NifModel * nif, const QString & filepath, QModelIndex & iData )
 			unknownSrc  = pix.getIndex( iPixData, "Unknown 3 Bytes" );
 			unknownDest = nif->getIndex( iData, "Unknown 3 Bytes" );
 
-			for ( int i = 0; i < pix.rowCount( unknownSrc ); i++ ) {
-				nif->set<quint8>( unknownDest.child( i, 0 ), pix.get<quint8>( unknownSrc.child( i, 0 ) ) );
-			}
+			nif->setArray<quint8>( unknownDest, pix.getArray<quint8>( unknownSrc ) );
 
 			unknownSrc  = pix.getIndex( iPixData, "Unknown 8 Bytes" );
 			unknownDest = nif->getIndex( iData, "Unknown 8 Bytes" );
 
-			for ( int i = 0; i < pix.rowCount( unknownSrc ); i++ ) {
-				nif->set<quint8>( unknownDest.child( i, 0 ), pix.get<quint8>( unknownSrc.child( i, 0 ) ) );
-			}
+			nif->setArray<quint8>( unknownDest, pix.getArray<quint8>( unknownSrc ) );
 
 			if ( nif->checkVersion( 0x0A010000, 0x0A020000 ) && pix.checkVersion( 0x0A010000, 0x0A020000 ) ) {
 				nif->set<quint32>( iData, "Unknown Int", pix.get<quint32>( iPixData, "Unknown Int" ) );
@@ -1766,10 +2063,10 @@ bool texSaveNIF( NifModel * nif, const QString & filepath, QModelIndex & iData )
 			nif->set<quint32>( iData, "Alpha Mask", RGBA_INV_MASK[3] );
 
 			QModelIndex unknownEightBytes = nif->getIndex( iData, "Unknown 8 Bytes" );
+			QVector<quint8> unknownBytes( 8 );
 
-			for ( int i = 0; i < 8; i++ ) {
-				nif->set<quint8>( unknownEightBytes.child( i, 0 ), unk8bytes32[i] );
-			}
+			std::copy( unk8bytes32, unk8bytes32 + 8, unknownBytes.begin() );
+			nif->setArray<quint8>( unknownEightBytes, unknownBytes );
 		} else if ( nif->checkVersion( 0x14000004, 0 ) ) {
 			// set stuff
 			nif->set<qint32>( iData, "Unknown Int 2", -1 ); // probably a link to something
@@ -1900,12 +2197,12 @@ bool texSaveNIF( NifModel * nif, const QString & filepath, QModelIndex & iData )
 
 			QModelIndex unknownEightBytes = nif->getIndex( iData, "Unknown 8 Bytes" );
 
-			for ( int i = 0; i < 8; i++ ) {
-				if ( ddsHeader.ddsPixelFormat.dwBPP == 24 ) {
-					nif->set<quint8>( unknownEightBytes.child( i, 0 ), unk8bytes24[i] );
-				} else if ( ddsHeader.ddsPixelFormat.dwBPP == 32 ) {
-					nif->set<quint8>( unknownEightBytes.child( i, 0 ), unk8bytes32[i] );
-				}
+			if ( ddsHeader.ddsPixelFormat.dwBPP == 24 || ddsHeader.ddsPixelFormat.dwBPP == 32 ) {
+				const quint8 * unk8bytes = ( ddsHeader.ddsPixelFormat.dwBPP == 24 ) ? unk8bytes24 : unk8bytes32;
+				QVector<quint8> unknownBytes( 8 );
+
+				std::copy( unk8bytes, unk8bytes + 8, unknownBytes.begin() );
+				nif->setArray<quint8>( unknownEightBytes, unknownBytes );
 			}
 		} else if ( nif->checkVersion( 0x14000004, 0 ) ) {
 			// set stuff
@@ -34,15 +34,35 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define GLTEXLOADERS_H
 
 #include <QByteArray>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
 
 
+class QFile;
 class QModelIndex;
-class QString;
 
 typedef unsigned int GLuint;
 
 //! \file gltexloaders.h Texture loading functions header
 
+//! A texture decoded to RGBA, not yet uploaded to OpenGL
+struct TexImage
+{
+	TexImage() : width( 0 ), height( 0 ) {}
+
+	//! Format of the source, for instance "DDS (DXT3)" or "TGA"
+	QString format;
+	//! Width of the first level
+	GLuint width;
+	//! Height of the first level
+	GLuint height;
+	//! Mipmap levels in RGBA8, each half the size of the one before
+	QVector<QByteArray> levels;
+	//! The cache file mapped by levels, when read from the decoded texture cache
+	QSharedPointer<QFile> mapping;
+};
+
 //! A function for loading textures.
 /*!
  * Loads a texture pointed to by filepath.
@@ -76,6 +96,46 @@ extern bool texLoad( const QString & filepath, QString & format, GLuint & width,
 */
 extern bool texLoad( const QModelIndex & iData, QString & format, GLuint & width, GLuint & height, GLuint & mipmaps );
 
+//! A function for decoding textures without an OpenGL context.
+/*!
+ * Decodes the texture held in data, or read from filepath if data is empty,
+ * into image. Makes no OpenGL calls, so it may run on any thread; the result
+ * is uploaded with texUpload(). NIF pixel data files are not supported, they
+ * must be loaded with texLoad().
+ * Returns true on success, and throws a QString otherwise.
+ *
+ * \param filepath The full path to the texture, its extension selects the format.
+ * \param data The texture file contents, filled from filepath if empty.
+ * \param image Contains the decoded mipmap levels on successful load.
+ * \return true if the load was successful, false otherwise.
+ */
+extern bool texDecode( const QString & filepath, QByteArray & data, TexImage & image );
+
+//! A function for decoding textures through a cache of decoded textures.
+/*!
+ * Like texDecode(), but first looks for the texture in cacheFolder, keyed by
+ * a hash of data and of the loader version, and maps it from there if it was
+ * decoded before. Otherwise the texture is decoded and stored in cacheFolder,
+ * and the least recently used textures are deleted from it once it holds
+ * more than cacheLimit bytes.
+ * Returns true on success, and throws a QString otherwise.
+ *
+ * \param filepath The full path to the texture, its extension selects the format.
+ * \param data The texture file contents, filled from filepath if empty.
+ * \param image Contains the decoded mipmap levels on successful load.
+ * \param cacheFolder The folder holding decoded textures.
+ * \param cacheLimit The size cacheFolder is pruned to, in bytes.
+ * \return true if the load was successful, false otherwise.
+ */
+extern bool texDecodeCached( const QString & filepath, QByteArray & data, TexImage & image, const QString & cacheFolder, qint64 cacheLimit );
+
+//! Uploads a decoded texture to the currently bound OpenGL texture.
+/*!
+ * \param image The texture decoded by texDecode().
+ * \return The number of mipmaps uploaded.
+ */
+extern GLuint texUpload( const TexImage & image );
+
 //! A function which checks whether the given file can be loaded.
 /*!
  * The function checks whether the file exists, is readable, and whether its extension
@@ -82,12 +82,13 @@ SkinPartition::SkinPartition( const NifModel * nif, const QModelIndex & index )
 	weights.resize( vertexMap.count() * numWeightsPerVertex );
 
 	for ( int v = 0; v < vertexMap.count(); v++ ) {
-		for ( int w = 0; w < numWeightsPerVertex; w++ ) {
-			QModelIndex iw = iWeights.child( v, 0 ).child( w, 0 );
-			QModelIndex ib = iBoneIndices.child( v, 0 ).child( w, 0 );
+		// the rows of each vertex are packed; missing ones count as 0
+		QVector<float> vw = nif->getArray<float>( iWeights.child( v, 0 ) );
+		QVector<int> vb = nif->getArray<int>( iBoneIndices.child( v, 0 ) );
 
-			weights[ v * numWeightsPerVertex + w ].first  = ( ib.isValid() ? nif->get<int>( ib ) : 0 );
-			weights[ v * numWeightsPerVertex + w ].second = ( iw.isValid() ? nif->get<float>( iw ) : 0 );
+		for ( int w = 0; w < numWeightsPerVertex; w++ ) {
+			weights[ v * numWeightsPerVertex + w ].first  = vb.value( w );
+			weights[ v * numWeightsPerVertex + w ].second = vw.value( w );
 		}
 	}
 
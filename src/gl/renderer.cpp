@@ -50,6 +50,10 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 bool shader_initialized = false;
 bool shader_ready = false;
 
+//! Suffixes of the normal and glow maps next to a base texture
+static const QString normalSuffix = QStringLiteral( "_n" );
+static const QString glowSuffix = QStringLiteral( "_g" );
+
 bool Renderer::initialize()
 {
 	if ( !shader_initialized ) {
@@ -242,7 +246,7 @@ bool Renderer::Shader::load( const QString & filepath )
 
 
 Renderer::Program::Program( const QString & n, QOpenGLFunctions * fn )
-	: name( n ), id( 0 ), status( false ), f( fn )
+	: name( n ), id( 0 ), status( false ), f( fn ), uniBaseMap( -1 ), uniNormalMap( -1 ), uniGlowMap( -1 )
 {
 	id = f->glCreateProgram();
 }
@@ -350,6 +354,10 @@ bool Renderer::Program::load( const QString & filepath, Renderer * renderer )
 				throw errlog;
 			}
 		}
+
+		uniBaseMap = f->glGetUniformLocation( id, "BaseMap" );
+		uniNormalMap = f->glGetUniformLocation( id, "NormalMap" );
+		uniGlowMap = f->glGetUniformLocation( id, "GlowMap" );
 	}
 	catch ( QString x )
 	{
@@ -362,7 +370,7 @@ bool Renderer::Program::load( const QString & filepath, Renderer * renderer )
 }
 
 Renderer::Renderer( QOpenGLContext * c, QOpenGLFunctions * f )
-	: cx( c ), fn( f )
+	: cx( c ), fn( f ), revision( 0 )
 {
 }
 
@@ -418,6 +426,8 @@ void Renderer::releaseShaders()
 	if ( !shader_ready )
 		return;
 
+	revision++;
+
 	qDeleteAll( programs );
 	programs.clear();
 	qDeleteAll( shaders );
@@ -434,23 +444,50 @@ QString Renderer::setupProgram( Mesh * mesh, const QString & hint )
 		return QString( "fixed function pipeline" );
 	}
 
-	QList<QModelIndex> iBlocks;
-	iBlocks << mesh->index();
-	iBlocks << mesh->iData;
-	for ( Property * p : props.list() ) {
-		iBlocks.append( p->index() );
+	// the conditions only read the mesh, its data and its properties,
+	// so the programs they allow stay the same until one of those changes
+	QList<Property *> plist = props.list();
+	qint64 prevs = 0;
+	for ( Property * p : plist ) {
+		prevs += p->revision();
 	}
 
-	if ( !hint.isEmpty() ) {
+	if ( mesh->shaderRevision != revision || mesh->shaderProperties != plist || mesh->shaderPropertyRevisions != prevs ) {
+		const NifModel * nif = qobject_cast<const NifModel *>( mesh->index().model() );
+
+		QList<QModelIndex> iBlocks;
+		iBlocks << mesh->index();
+		iBlocks << mesh->iData;
+		for ( Property * p : plist ) {
+			iBlocks.append( p->index() );
+		}
+
+		mesh->shaderPrograms.clear();
+
+		if ( nif && mesh->index().isValid() ) {
+			for ( Program * program : programs ) {
+				if ( program->status && program->conditions.eval( nif, iBlocks ) )
+					mesh->shaderPrograms.append( program->name );
+			}
+		}
+
+		mesh->shaderProperties = plist;
+		mesh->shaderPropertyRevisions = prevs;
+		mesh->shaderRevision = revision;
+	}
+
+	if ( !hint.isEmpty() && mesh->shaderPrograms.contains( hint ) ) {
 		Program * program = programs.value( hint );
 
-		if ( program && program->status && setupProgram( program, mesh, props, iBlocks ) )
+		if ( program && setupProgram( program, mesh, props ) )
 			return hint;
 	}
 
-	for ( Program * program : programs ) {
-		if ( program->status && setupProgram( program, mesh, props, iBlocks ) )
-			return program->name;
+	for ( const QString & name : mesh->shaderPrograms ) {
+		Program * program = programs.value( name );
+
+		if ( program && name != hint && setupProgram( program, mesh, props ) )
+			return name;
 	}
 
 	stopProgram();
@@ -467,16 +504,8 @@ void Renderer::stopProgram()
 	resetTextureUnits();
 }
 
-bool Renderer::setupProgram( Program * prog, Mesh * mesh, const PropertyList & props, const QList<QModelIndex> & iBlocks )
+bool Renderer::setupProgram( Program * prog, Mesh * mesh, const PropertyList & props )
 {
-	const NifModel * nif = qobject_cast<const NifModel *>( mesh->index().model() );
-
-	if ( !mesh->index().isValid() || !nif )
-		return false;
-
-	if ( !prog->conditions.eval( nif, iBlocks ) )
-		return false;
-
 	fn->glUseProgram( prog->id );
 
 	// texturing
@@ -486,9 +515,7 @@ bool Renderer::setupProgram( Program * prog, Mesh * mesh, const PropertyList & p
 
 	int texunit = 0;
 
-	GLint uniBaseMap = fn->glGetUniformLocation( prog->id, "BaseMap" );
-
-	if ( uniBaseMap >= 0 ) {
+	if ( prog->uniBaseMap >= 0 ) {
 		if ( !texprop && !bsprop )
 			return false;
 
@@ -498,25 +525,16 @@ bool Renderer::setupProgram( Program * prog, Mesh * mesh, const PropertyList & p
 		if ( (texprop && !texprop->bind( 0 )) || (bsprop && !bsprop->bind( 0 )) )
 			return false;
 
-		fn->glUniform1i( uniBaseMap, texunit++ );
+		fn->glUniform1i( prog->uniBaseMap, texunit++ );
 	}
 
-	GLint uniNormalMap = fn->glGetUniformLocation( prog->id, "NormalMap" );
-
-	if ( uniNormalMap >= 0 ) {
+	if ( prog->uniNormalMap >= 0 ) {
 		if ( texprop ) {
-			QString fname = texprop->fileName( 0 );
+			QString fname = texprop->fileName( 0, normalSuffix );
 
 			if ( fname.isEmpty() )
 				return false;
 
-			int pos = fname.indexOf( "_" );
-
-			if ( pos >= 0 )
-				fname = fname.left( pos ) + "_n.dds";
-			else if ( ( pos = fname.lastIndexOf( "." ) ) >= 0 )
-				fname = fname.insert( pos, "_n" );
-
 			if ( !activateTextureUnit( texunit ) || !texprop->bind( 0, fname ) )
 				return false;
 		} else if ( bsprop ) {
@@ -526,25 +544,16 @@ bool Renderer::setupProgram( Program * prog, Mesh * mesh, const PropertyList & p
 				return false;
 		}
 
-		fn->glUniform1i( uniNormalMap, texunit++ );
+		fn->glUniform1i( prog->uniNormalMap, texunit++ );
 	}
 
-	GLint uniGlowMap = fn->glGetUniformLocation( prog->id, "GlowMap" );
-
-	if ( uniGlowMap >= 0 ) {
+	if ( prog->uniGlowMap >= 0 ) {
 		if ( texprop ) {
-			QString fname = texprop->fileName( 0 );
+			QString fname = texprop->fileName( 0, glowSuffix );
 
 			if ( fname.isEmpty() )
 				return false;
 
-			int pos = fname.indexOf( "_" );
-
-			if ( pos >= 0 )
-				fname = fname.left( pos ) + "_g.dds";
-			else if ( ( pos = fname.lastIndexOf( "." ) ) >= 0 )
-				fname = fname.insert( pos, "_g" );
-
 			if ( !activateTextureUnit( texunit ) || !texprop->bind( 0, fname ) )
 				return false;
 		} else if ( bsprop ) {
@@ -554,7 +563,7 @@ bool Renderer::setupProgram( Program * prog, Mesh * mesh, const PropertyList & p
 				return false;
 		}
 
-		fn->glUniform1i( uniGlowMap, texunit++ );
+		fn->glUniform1i( prog->uniGlowMap, texunit++ );
 	}
 
 	QMapIterator<int, QString> itx( prog->texcoords );
@@ -43,6 +43,7 @@ class QOpenGLContext;
 class QOpenGLFunctions;
 
 typedef unsigned int GLenum;
+typedef int GLint;
 typedef unsigned int GLuint;
 
 //! Manages rendering and shaders?
@@ -155,14 +156,20 @@ public:
 
 		ConditionGroup conditions;
 		QMap<int, QString> texcoords;
+
+		//! Sampler uniform locations, resolved once the program is linked
+		GLint uniBaseMap, uniNormalMap, uniGlowMap;
 	};
 
 	QMap<QString, Shader *> shaders;
 	QMap<QString, Program *> programs;
 
+	//! Counts the shader reloads; a mesh's cached programs are stale once it changes
+	int revision;
+
 	friend class Program;
 
-	bool setupProgram( Program *, Mesh *, const PropertyList &, const QList<QModelIndex> & iBlocks );
+	bool setupProgram( Program *, Mesh *, const PropertyList & );
 	void setupFixedFunction( Mesh *, const PropertyList & );
 };
 
@@ -47,6 +47,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QDebug>
 #include <QDialog>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QLabel>
 #include <QKeyEvent>
 #include <QMenu>
@@ -158,6 +159,10 @@ GLView::GLView( const QGLFormat & format, const QGLWidget * shareWidget )
 	fpsacc = 0.0;
 	fpscnt = 0;
 
+	drawact = 0.0;
+	drawacc = 0.0;
+	drawcnt = 0;
+
 	textures = new TexCache( this );
 
 	scene = new Scene( textures, glContext, glFuncs );
@@ -326,6 +331,9 @@ GLView::GLView( const QGLFormat & format, const QGLWidget * shareWidget )
 
 GLView::~GLView()
 {
+	// the scene releases its buffers
+	makeCurrent();
+
 	delete scene;
 }
 
@@ -367,6 +375,8 @@ void GLView::initializeGL()
 
 	initializeTextureUnits( glContext );
 
+	scene->buffers->initialize();
+
 	if ( scene->renderer->initialize() )
 		updateShaders();
 
@@ -582,9 +592,15 @@ void GLView::paintGL()
 	}
 #endif
 
-	// Draw the model
+	// Draw the model, timing the CPU side of it
+	QElapsedTimer drawTimer;
+	drawTimer.start();
+
 	scene->draw();
 
+	drawacc += drawTimer.nsecsElapsed() / 1000000.0;
+	drawcnt++;
+
 	// Restore GL state
 	glPopAttrib();
 	glMatrixMode( GL_MODELVIEW );
@@ -608,6 +624,12 @@ void GLView::paintGL()
 
 		fpsacc = 0;
 		fpscnt = 0;
+
+		if ( drawcnt )
+			drawact = drawacc / drawcnt;
+
+		drawacc = 0;
+		drawcnt = 0;
 	}
 
 	emit paintUpdate();
@@ -623,6 +645,7 @@ void GLView::paintGL()
 
 		if ( Options::benchmark() ) {
 			painter.drawText( 10, y++ *ls, QString( "FPS %1" ).arg( int(fpsact) ) );
+			painter.drawText( 10, y++ *ls, QString( "Draw %1 ms" ).arg( drawact, 0, 'f', 2 ) );
 			y++;
 		}
 
@@ -186,6 +186,11 @@ private:
 	float fpsact;
 	float fpsacc;
 
+	//! Average CPU time of Scene::draw() in ms, over the last FPS period
+	int drawcnt;
+	float drawact;
+	float drawacc;
+
 	float Dist;
 	Vector3 Pos;
 	Vector3 Rot;
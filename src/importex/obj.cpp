@@ -954,10 +954,17 @@ void importObj( NifModel * nif, const QModelIndex & index )
 			if ( iLengths.isValid() && iPoints.isValid() ) {
 				nif->updateArray( iLengths );
 				nif->updateArray( iPoints );
+
+				// the strip lengths size the strips, so they are set first
+				QVector<int> lengths;
+				for ( const QVector<quint16> & strip : strips )
+					lengths.append( strip.count() );
+
+				nif->setArray<int>( iLengths, lengths );
+
 				int x = 0;
 				int z = 0;
 				foreach ( QVector<quint16> strip, strips ) {
-					nif->set<int>( iLengths.child( x, 0 ), strip.count() );
 					QModelIndex iStrip = iPoints.child( x, 0 );
 					nif->updateArray( iStrip );
 					nif->setArray<quint16>( iStrip, strip );
@@ -232,8 +232,9 @@ void KfmModel::insertType( NifItem * parent, const NifData & data, int at )
 
 bool KfmModel::setItemValue( NifItem * item, const NifValue & val )
 {
+	itemEditing( item );
 	item->value() = val;
-	emit dataChanged( createIndex( item->row(), ValueCol, item ), createIndex( item->row(), ValueCol, item ) );
+	itemChanged( item );
 	return true;
 }
 
@@ -33,6 +33,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "nifexpr.h"
 
 #include <QDebug>
+#include <QRegExp>
+#include <QRegularExpression>
 
 //#include "basemodel.h"
 
@@ -144,17 +146,114 @@ Expression::Operator Expression::operatorFromString( const QString & str )
 	return Expression::e_nop;
 }
 
+Expression::Expression( const QString & cond, int startpos, int endpos )
+	: Expression( cond.mid( startpos, endpos - startpos + 1 ) )
+{
+}
+
+Expression::Expression( const QString & cond )
+{
+	compile( cond );
+}
+
+void Expression::compile( const QString & cond )
+{
+	program.clear();
+	names.clear();
+
+	if ( cond.isEmpty() )
+		return;
+
+	try
+	{
+		partition( cond );
+	}
+	catch ( const char * err )
+	{
+		qWarning() << err << cond;
+		program.clear();
+		names.clear();
+		return;
+	}
+
+	// Validate the stack usage once so that evaluation needs no checks
+	int depth = 0;
+	for ( const Instruction & ins : program ) {
+		if ( ins.kind != Instruction::iOp )
+			depth++;
+		else if ( ins.op != Expression::e_not )
+			depth--;
+
+		if ( depth < 1 || depth > MaxDepth ) {
+			qWarning() << "expression too complex" << cond;
+			program.clear();
+			names.clear();
+			return;
+		}
+	}
+
+	if ( depth != 1 ) {
+		qWarning() << "expression syntax error" << cond;
+		program.clear();
+		names.clear();
+	}
+}
+
+void Expression::emitOperator( Operator op )
+{
+	Instruction ins;
+	ins.kind = Instruction::iOp;
+	ins.op = op;
+	ins.value = 0;
+	program.append( ins );
+}
+
+void Expression::emitOperand( const QString & cond )
+{
+	static QRegularExpression reInt( "\\A(?:[-+]?[0-9]+)\\z" );
+	static QRegularExpression reUInt( "\\A(?:0[xX][0-9A-Fa-f]+)\\z" );
+	static QRegularExpression reVersion( "\\A(?:[0-9]+\\.[0-9]+\\.[0-9]+\\.[0-9]+)\\z" );
+
+	Instruction ins;
+	ins.kind = Instruction::iConst;
+	ins.op = Expression::e_nop;
+	ins.value = 0;
+
+	if ( cond.isEmpty() ) {
+		// missing operand, as before evaluates to nothing
+	} else if ( reUInt.match( cond ).hasMatch() ) {
+		ins.value = cond.mid( 2 ).toUInt( 0, 16 );
+	} else if ( reInt.match( cond ).hasMatch() ) {
+		ins.value = quint32( cond.toInt() );
+	} else if ( reVersion.match( cond ).hasMatch() ) {
+		ins.value = version2number( cond );
+	} else {
+		// identifier, resolved at evaluation time
+		int idx = names.indexOf( cond );
+
+		if ( idx < 0 ) {
+			idx = names.count();
+			names.append( cond );
+		}
+
+		ins.kind = Instruction::iName;
+		ins.value = quint32( idx );
+	}
+
+	program.append( ins );
+}
+
 void Expression::partition( const QString & cond, int offset /*= 0*/ )
 {
 	int pos;
 
 	if ( cond.isEmpty() ) {
-		this->opcode = Expression::e_nop;
+		emitOperand( cond );
 		return;
 	}
 
 	// Handle unary operators
-	QRegularExpression reUnary( "^\\s*!(.*)" );
+	static QRegularExpression reUnary( "^\\s*!(.*)" );
 	QRegularExpressionMatch reUnaryMatch = reUnary.match( cond, offset );
 	pos = reUnaryMatch.capturedStart();
 
@@ -162,32 +261,23 @@ void Expression::partition( const QString & cond, int offset /*= 0*/ )
 	int oldPos;
 	QRegExp reUnaryOld( "^\\s*!(.*)" );
 	oldPos = reUnaryOld.indexIn( cond, offset, QRegExp::CaretAtOffset );
-	//qDebug() << reUnaryOld.capturedTexts();
-	//qDebug() << reUnaryMatch.capturedTexts();
 	Q_ASSERT( pos == oldPos );
-	//Q_ASSERT( reUnaryOld.capturedTexts() == reUnaryMatch.capturedTexts() );
 #endif
 
 	if ( pos != -1 ) {
-		Expression e( reUnaryMatch.captured( 1 ).trimmed() );
-		this->opcode = Expression::e_not;
-		this->rhs = QVariant::fromValue( e );
-#ifndef QT_NO_DEBUG
-		Expression e2( reUnaryOld.cap( 1 ).trimmed() );
-		Q_ASSERT( e.toString() == e2.toString() );
-#endif
+		partition( reUnaryMatch.captured( 1 ).trimmed() );
+		emitOperator( Expression::e_not );
 		return;
 	}
 
 	// Check for left group
 	int lstartpos = -1, lendpos = -1, ostartpos = -1, oendpos = -1, rstartpos = -1, rendpos = -1;
-	//QRegExp tokens("\b(!=|==|>=|<=|>|<|\\&|\+|-|\\&\\&|\\|\\||\(|\)|[a-zA-Z0-9][a-zA-Z0-9_ \\?]*[a-zA-Z0-9_\\?]?)\b");
 
 	// TODO: Do we want single & and single | in here? Staring with
 	// Qt5 in QRegularExpression, I had to put the && and || before
 	// the single ones in order to get the correct match
-	QRegularExpression reOps( "(!=|==|>=|<=|>|<|\\+|-|\\&\\&|\\|\\||\\&|\\|)" );
-	QRegularExpression reLParen( "^\\s*\\(.*" );
+	static QRegularExpression reOps( "(!=|==|>=|<=|>|<|\\+|-|\\&\\&|\\|\\||\\&|\\|)" );
+	static QRegularExpression reLParen( "^\\s*\\(.*" );
 
 	QRegularExpressionMatch reLParenMatch = reLParen.match( cond, offset );
 	pos = reLParenMatch.capturedStart();
@@ -196,13 +286,6 @@ void Expression::partition( const QString & cond, int offset /*= 0*/ )
 	QRegExp reOpsOld( "(!=|==|>=|<=|>|<|\\&|\\||\\+|-|\\&\\&|\\|\\|)" );
 	QRegExp reLParenOld( "^\\s*\\(.*" );
 	oldPos = reLParenOld.indexIn( cond, offset, QRegExp::CaretAtOffset );
-	//QRegularExpression testOps( R"rx((!=|==|>=|<=|>|<|\+|-|\&\&|\|\||\&|\|))rx" );
-	//auto testStr = "what what && what what";
-	//auto testMatch = testOps.match( testStr, 0 );
-	//Q_ASSERT( testMatch.hasMatch() );
-	//Q_ASSERT( testMatch.captured( 0 ) == "&&" );
-	//qDebug() << "reLParenMatch captured: " << reLParenMatch.captured();
-	//qDebug() << reLParenMatch.hasMatch();
 	Q_ASSERT( pos == oldPos );
 #endif
 
@@ -212,14 +295,7 @@ void Expression::partition( const QString & cond, int offset /*= 0*/ )
 		pos = reOpsMatch.capturedStart();
 
 #ifndef QT_NO_DEBUG
-		//qDebug() << "Condition: " << cond;
-		//qDebug() << "Start Pos: " << lstartpos;
-		//qDebug() << "End Pos:   " << lendpos;
 		oldPos = reOpsOld.indexIn( cond, lendpos + 1, QRegExp::CaretAtOffset );
-		//qDebug() << "reOpsOld captured:      " << reOpsOld.capturedTexts();
-		//qDebug() << "cond length:         " << cond.length();
-		//qDebug() << "reOpsMatch captured: " << reOpsMatch.captured();
-		//qDebug() << "reOpsMatch match:    " << reOpsMatch.hasMatch();
 		Q_ASSERT( pos == oldPos );
 #endif
 
@@ -230,12 +306,6 @@ void Expression::partition( const QString & cond, int offset /*= 0*/ )
 			oendpos = ostartpos + reOpsMatch.captured( 0 ).length();
 #ifndef QT_NO_DEBUG
 			int oendpos2 = ostartpos + reOpsOld.cap( 0 ).length();
-			//qDebug() << reOpsOld.capturedTexts();
-			//qDebug() << reOpsOld.cap( 0 );
-			//qDebug() << reOpsOld.cap( 0 ).length();
-			//qDebug() << reOpsMatch.capturedTexts();
-			//qDebug() << reOpsMatch.captured( 0 );
-			//qDebug() << reOpsMatch.captured( 0 ).length();
 			Q_ASSERT( oendpos == oendpos2 );
 #endif
 		} else {
@@ -259,41 +329,8 @@ void Expression::partition( const QString & cond, int offset /*= 0*/ )
 			Q_ASSERT( oendpos == oendpos2 );
 #endif
 		} else {
-#ifndef QT_NO_DEBUG
-			static QRegExp reIntOld( "[-+]?[0-9]+" );
-			static QRegExp reUIntOld( "0[xX][0-9]+" );
-			static QRegExp reFloatOld( "^[-+]?[0-9]*\\.?[0-9]+([eE][-+]?[0-9]+)?$" );
-			static QRegExp reVersionOld( "[0-9]+\\.[0-9]+\\.[0-9]+\\.[0-9]+" );
-#endif
-			static QRegularExpression reInt( "\\A(?:[-+]?[0-9]+)\\z" );
-			static QRegularExpression reUInt( "\\A(?:0[xX][0-9]+)\\z" );
-			static QRegularExpression reFloat( "^[-+]?[0-9]*\\.?[0-9]+([eE][-+]?[0-9]+)?$" );
-			static QRegularExpression reVersion( "\\A(?:[0-9]+\\.[0-9]+\\.[0-9]+\\.[0-9]+)\\z" );
-
 			// termination
-			this->lhs.setValue( cond );
-
-			if ( reUInt.match( cond ).hasMatch() ) {
-#ifndef QT_NO_DEBUG
-				//qDebug() << "reUInt exact match";
-				Q_ASSERT( reUIntOld.exactMatch( cond ) );
-#endif
-				this->lhs.convert( QVariant::UInt );
-			} else if ( reInt.match( cond ).hasMatch() ) {
-#ifndef QT_NO_DEBUG
-				//qDebug() << "reInt exact match";
-				Q_ASSERT( reIntOld.exactMatch( cond ) );
-#endif
-				this->lhs.convert( QVariant::Int );
-			} else if ( reVersion.match( cond ).hasMatch() ) {
-#ifndef QT_NO_DEBUG
-				//qDebug() << "reVersion exact match";
-				Q_ASSERT( reVersionOld.exactMatch( cond ) );
-#endif
-				this->lhs.setValue( version2number( cond ) );
-			}
-
-			this->opcode = Expression::e_nop;
+			emitOperand( cond );
 			return;
 		}
 	}
@@ -301,85 +338,84 @@ void Expression::partition( const QString & cond, int offset /*= 0*/ )
 	rstartpos = oendpos + 1;
 	rendpos = cond.size() - 1;
 
-	Expression lhsexp( cond.mid( lstartpos, lendpos - lstartpos + 1 ).trimmed() );
-	Expression rhsexp( cond.mid( rstartpos, rendpos - rstartpos + 1 ).trimmed() );
-
-	if ( lhsexp.opcode == Expression::e_nop ) {
-		this->lhs = lhsexp.lhs;
-	} else {
-		this->lhs = QVariant::fromValue( lhsexp );
-	}
-
-	this->opcode = operatorFromString( cond.mid( ostartpos, oendpos - ostartpos ) );
-
-	if ( rhsexp.opcode == Expression::e_nop ) {
-		this->rhs = rhsexp.lhs;
-	} else {
-		this->rhs = QVariant::fromValue( rhsexp );
-	}
+	partition( cond.mid( lstartpos, lendpos - lstartpos + 1 ).trimmed() );
+	partition( cond.mid( rstartpos, rendpos - rstartpos + 1 ).trimmed() );
+	emitOperator( operatorFromString( cond.mid( ostartpos, oendpos - ostartpos ) ) );
 }
 
 QString Expression::toString() const
 {
-	QString l = lhs.toString();
-	QString r = rhs.toString();
-
-	if ( lhs.type() == QVariant::UserType && lhs.canConvert<Expression>() )
-		l = lhs.value<Expression>().toString();
-
-	if ( rhs.type() == QVariant::UserType && rhs.canConvert<Expression>() )
-		r = rhs.value<Expression>().toString();
-
-	switch ( opcode ) {
-	case Expression::e_not:
-		return QString( "!%1" ).arg( r );
-	case Expression::e_not_eq:
-		return QString( "(%1 != %2)" ).arg( l, r );
-	case Expression::e_eq:
-		return QString( "(%1 == %2)" ).arg( l, r );
-	case Expression::e_gte:
-		return QString( "(%1 >= %2)" ).arg( l, r );
-	case Expression::e_lte:
-		return QString( "(%1 <= %2)" ).arg( l, r );
-	case Expression::e_gt:
-		return QString( "(%1 > %2)" ).arg( l, r );
-	case Expression::e_lt:
-		return QString( "(%1 < %2)" ).arg( l, r );
-	case Expression::e_bit_and:
-		return QString( "(%1 & %2)" ).arg( l, r );
-	case Expression::e_bit_or:
-		return QString( "(%1 | %2)" ).arg( l, r );
-	case Expression::e_add:
-		return QString( "(%1 + %2)" ).arg( l, r );
-	case Expression::e_sub:
-		return QString( "(%1 - %2)" ).arg( l, r );
-	case Expression::e_bool_and:
-		return QString( "(%1 && %2)" ).arg( l, r );
-	case Expression::e_bool_or:
-		return QString( "(%1 || %2)" ).arg( l, r );
-	case Expression::e_nop:
-		return QString( "%1" ).arg( l );
-	}
+	QStringList stack;
+
+	for ( const Instruction & ins : program ) {
+		switch ( ins.kind ) {
+		case Instruction::iConst:
+			stack.append( QString::number( ins.value ) );
+			continue;
+		case Instruction::iName:
+			stack.append( names.at( int( ins.value ) ) );
+			continue;
+		case Instruction::iOp:
+			break;
+		}
 
-	return QString();
-}
+		if ( ins.op == Expression::e_not ) {
+			if ( !stack.isEmpty() )
+				stack.last() = QString( "!%1" ).arg( stack.last() );
 
-void Expression::NormalizeVariants( QVariant & l, QVariant & r ) const
-{
-	if ( l.isValid() && r.isValid() ) {
-		if ( l.type() != r.type() ) {
-			if ( l.type() == QVariant::String && l.canConvert( r.type() ) )
-				l.convert( r.type() );
-			else if ( r.type() == QVariant::String && r.canConvert( l.type() ) )
-				r.convert( l.type() );
-			else {
-				QVariant::Type t = l.type() > r.type() ? l.type() : r.type();
-
-				if ( r.canConvert( t ) && l.canConvert( t ) ) {
-					l.convert( t );
-					r.convert( t );
-				}
-			}
+			continue;
+		}
+
+		if ( stack.count() < 2 )
+			return QString();
+
+		QString r = stack.takeLast();
+		QString l = stack.takeLast();
+
+		switch ( ins.op ) {
+		case Expression::e_not_eq:
+			stack.append( QString( "(%1 != %2)" ).arg( l, r ) );
+			break;
+		case Expression::e_eq:
+			stack.append( QString( "(%1 == %2)" ).arg( l, r ) );
+			break;
+		case Expression::e_gte:
+			stack.append( QString( "(%1 >= %2)" ).arg( l, r ) );
+			break;
+		case Expression::e_lte:
+			stack.append( QString( "(%1 <= %2)" ).arg( l, r ) );
+			break;
+		case Expression::e_gt:
+			stack.append( QString( "(%1 > %2)" ).arg( l, r ) );
+			break;
+		case Expression::e_lt:
+			stack.append( QString( "(%1 < %2)" ).arg( l, r ) );
+			break;
+		case Expression::e_bit_and:
+			stack.append( QString( "(%1 & %2)" ).arg( l, r ) );
+			break;
+		case Expression::e_bit_or:
+			stack.append( QString( "(%1 | %2)" ).arg( l, r ) );
+			break;
+		case Expression::e_add:
+			stack.append( QString( "(%1 + %2)" ).arg( l, r ) );
+			break;
+		case Expression::e_sub:
+			stack.append( QString( "(%1 - %2)" ).arg( l, r ) );
+			break;
+		case Expression::e_bool_and:
+			stack.append( QString( "(%1 && %2)" ).arg( l, r ) );
+			break;
+		case Expression::e_bool_or:
+			stack.append( QString( "(%1 || %2)" ).arg( l, r ) );
+			break;
+		case Expression::e_not:
+		case Expression::e_nop:
+			stack.append( l );
+			stack.append( r );
+			break;
 		}
 	}
+
+	return stack.isEmpty() ? QString() : stack.first();
 }
@@ -34,113 +34,161 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define NIFEXPR_H
 #pragma once
 
-#include <QRegularExpression>
 #include <QString>
-#include <QVariant>
-
-
+#include <QStringList>
+#include <QVector>
+
+
+//! \file nifexpr.h Expression
+
+//! A condition or array size expression from nif.xml
+/*!
+ * Expressions are compiled once into a small postfix program of unsigned
+ * integer operations. Identifiers are kept in a name table and resolved
+ * through a functor at evaluation time, so no QVariant conversions or
+ * regular expressions are involved when a model is loaded.
+ *
+ * Constructing an expression compiles it. The expressions of nif.xml are
+ * compiled once, with the schema, see NifSchema::expression(); copying one
+ * only copies two implicitly shared containers.
+ */
 class Expression final
 {
+public:
 	enum Operator
 	{
 		e_nop, e_not_eq, e_eq, e_gte, e_lte, e_gt, e_lt, e_bit_and, e_bit_or,
 		e_add, e_sub, e_bool_and, e_bool_or, e_not,
 	};
-	QVariant lhs;
-	QVariant rhs;
-	Operator opcode;
 
-public:
-	explicit Expression()
-	{
-		opcode = Expression::e_nop;
-	}
+	explicit Expression() {}
 
-	Expression( const QString & cond, int startpos, int endpos )
-	{
-		opcode = Expression::e_nop;
-		partition( cond.mid( startpos, endpos - startpos + 1 ) );
-	}
+	Expression( const QString & cond, int startpos, int endpos );
+	Expression( const QString & cond );
 
-	Expression( const QString & cond )
-	{
-		opcode = Expression::e_nop;
-		partition( cond );
-	}
+	//! Whether the expression has no instructions
+	bool isEmpty() const { return program.isEmpty(); }
 
 	QString toString() const;
 
-public:
+	//! Evaluate the expression
+	/*!
+	 * \param resolve Functor returning the value of an identifier,
+	 *        with signature quint32 ( const QString & name )
+	 */
 	template <class F>
-	QVariant evaluateValue( const F & convert ) const
+	quint32 evaluateValue( const F & resolve ) const
 	{
-		QVariant l = convertValue( lhs, convert );
-		QVariant r = convertValue( rhs, convert );
-		NormalizeVariants( l, r );
-
-		switch ( opcode ) {
-		case Expression::e_not:
-			return QVariant::fromValue( !r.toBool() );
-		case Expression::e_not_eq:
-			return QVariant::fromValue( l != r );
-		case Expression::e_eq:
-			return QVariant::fromValue( l == r );
-		case Expression::e_gte:
-			return QVariant::fromValue( l.toUInt() >= r.toUInt() );
-		case Expression::e_lte:
-			return QVariant::fromValue( l.toUInt() <= r.toUInt() );
-		case Expression::e_gt:
-			return QVariant::fromValue( l.toUInt() > r.toUInt() );
-		case Expression::e_lt:
-			return QVariant::fromValue( l.toUInt() < r.toUInt() );
-		case Expression::e_bit_and:
-			return QVariant::fromValue( l.toUInt() & r.toUInt() );
-		case Expression::e_bit_or:
-			return QVariant::fromValue( l.toUInt() | r.toUInt() );
-		case Expression::e_add:
-			return QVariant::fromValue( l.toUInt() + r.toUInt() );
-		case Expression::e_sub:
-			return QVariant::fromValue( l.toUInt() - r.toUInt() );
-		case Expression::e_bool_and:
-			return QVariant::fromValue( l.toBool() && r.toBool() );
-		case Expression::e_bool_or:
-			return QVariant::fromValue( l.toBool() || r.toBool() );
-		case Expression::e_nop:
-			return l;
+		quint32 stack[MaxDepth];
+		int top = 0;
+
+		for ( const Instruction & ins : program ) {
+			switch ( ins.kind ) {
+			case Instruction::iConst:
+				stack[top++] = ins.value;
+				continue;
+			case Instruction::iName:
+				stack[top++] = resolve( names.at( int( ins.value ) ) );
+				continue;
+			case Instruction::iOp:
+				break;
+			}
+
+			if ( ins.op == e_not ) {
+				stack[top - 1] = !stack[top - 1];
+				continue;
+			}
+
+			quint32 r = stack[--top];
+			quint32 & l = stack[top - 1];
+
+			switch ( ins.op ) {
+			case e_not_eq:
+				l = ( l != r );
+				break;
+			case e_eq:
+				l = ( l == r );
+				break;
+			case e_gte:
+				l = ( l >= r );
+				break;
+			case e_lte:
+				l = ( l <= r );
+				break;
+			case e_gt:
+				l = ( l > r );
+				break;
+			case e_lt:
+				l = ( l < r );
+				break;
+			case e_bit_and:
+				l = ( l & r );
+				break;
+			case e_bit_or:
+				l = ( l | r );
+				break;
+			case e_add:
+				l = ( l + r );
+				break;
+			case e_sub:
+				l = ( l - r );
+				break;
+			case e_bool_and:
+				l = ( l && r );
+				break;
+			case e_bool_or:
+				l = ( l || r );
+				break;
+			case e_not:
+			case e_nop:
+				break;
+			}
 		}
 
-		return l;
+		return top > 0 ? stack[0] : 0;
 	}
 
 	template <class F>
-	bool evaluateBool( const F & convert ) const
+	bool evaluateBool( const F & resolve ) const
 	{
-		return evaluateValue( convert ).toBool();
+		return evaluateValue( resolve ) != 0;
 	}
 
 	template <class F>
-	int evaluateUInt( const F & convert ) const
+	int evaluateUInt( const F & resolve ) const
 	{
-		return evaluateValue( convert ).toUInt();
+		return evaluateValue( resolve );
 	}
 
 private:
-	static Operator operatorFromString( const QString & str );
-	void partition( const QString & cond, int offset = 0 );
-	void NormalizeVariants( QVariant & l, QVariant & r ) const;
+	//! Maximum evaluation stack depth of a compiled program
+	enum { MaxDepth = 32 };
 
-	template <class F>
-	QVariant convertValue( const QVariant & v, const F & convert ) const
+	//! A single postfix instruction
+	struct Instruction
 	{
-		if ( v.type() == QVariant::UserType ) {
-			if ( v.canConvert<Expression>() )
-				return v.value<Expression>().evaluateValue( convert );
-		}
+		enum Kind
+		{
+			iConst, //!< Push value
+			iName,  //!< Push the resolved value of names[value]
+			iOp     //!< Apply op to the top of the stack
+		};
+
+		Kind kind;
+		Operator op;
+		quint32 value;
+	};
 
-		return convert( v );
-	}
-};
+	//! The compiled program, in postfix order
+	QVector<Instruction> program;
+	//! Identifiers referenced by iName instructions
+	QStringList names;
 
-Q_DECLARE_METATYPE( Expression )
+	static Operator operatorFromString( const QString & str );
+	void compile( const QString & cond );
+	void partition( const QString & cond, int offset = 0 );
+	void emitOperand( const QString & cond );
+	void emitOperator( Operator op );
+};
 
 #endif
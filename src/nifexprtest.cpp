@@ -0,0 +1,152 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2012, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+
+/*
+ * Checks compiled Expressions against known results and times their evaluation.
+ *
+ * Build with nifexprtest.pro.
+ */
+
+#include "nifexpr.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+
+#include <stdio.h> // printf
+
+
+//! Identifier values used by the tests
+static QHash<QString, quint32> values;
+
+static quint32 resolve( const QString & name )
+{
+	return values.value( name, 0 );
+}
+
+static bool check( const QString & cond, quint32 expected )
+{
+	Expression e( cond );
+	quint32 result = e.evaluateValue( resolve );
+
+	if ( result != expected ) {
+		printf( "FAIL %s is %u, expected %u (compiled as %s)\n",
+			qPrintable( cond ), result, expected, qPrintable( e.toString() ) );
+		return false;
+	}
+
+	return true;
+}
+
+int main( int argc, char * argv[] )
+{
+	QCoreApplication app( argc, argv );
+
+	values["Version"] = 0x14020007;
+	values["User Version"] = 11;
+	values["User Version 2"] = 34;
+	values["Has Normals"] = 1;
+	values["Num Vertices"] = 300;
+	values["Flags"] = 0x1A;
+
+	bool ok = true;
+
+	// constants
+	ok = check( "7", 7 ) && ok;
+	ok = check( "0x10", 16 ) && ok;
+	ok = check( "0x1A", 26 ) && ok;
+	ok = check( "0xff", 255 ) && ok;
+	ok = check( "0XFFFFFFFF", 0xFFFFFFFF ) && ok;
+	ok = check( "20.2.0.7", 0x14020007 ) && ok;
+
+	// identifiers, including unknown ones
+	ok = check( "Num Vertices", 300 ) && ok;
+	ok = check( "Missing", 0 ) && ok;
+
+	// operators
+	ok = check( "Version >= 20.2.0.7", 1 ) && ok;
+	ok = check( "Version > 20.2.0.7", 0 ) && ok;
+	ok = check( "Version <= 10.0.1.0", 0 ) && ok;
+	ok = check( "Version < 20.2.0.8", 1 ) && ok;
+	ok = check( "User Version == 11", 1 ) && ok;
+	ok = check( "User Version != 11", 0 ) && ok;
+	ok = check( "Flags & 0x0A", 0x0A ) && ok;
+	ok = check( "Flags | 0x01", 0x1B ) && ok;
+	ok = check( "Num Vertices + 12", 312 ) && ok;
+	ok = check( "Num Vertices - 100", 200 ) && ok;
+	ok = check( "!Has Normals", 0 ) && ok;
+	ok = check( "!Missing", 1 ) && ok;
+
+	// groups and boolean operators
+	ok = check( "(Version >= 20.2.0.7) && (User Version == 11)", 1 ) && ok;
+	ok = check( "(Version >= 20.2.0.7) && (User Version == 12)", 0 ) && ok;
+	ok = check( "(User Version == 12) || (User Version 2 == 34)", 1 ) && ok;
+	ok = check( "((Flags & 0x10) != 0) && !Missing", 1 ) && ok;
+
+	// syntax errors compile to an empty expression, which evaluates to 0
+	if ( !Expression( "(Version >= 20.2.0.7" ).isEmpty() ) {
+		printf( "FAIL unmatched bracket compiled\n" );
+		ok = false;
+	}
+
+	if ( Expression( "User Version == 11" ).toString() != "(User Version == 11)" ) {
+		printf( "FAIL toString() is %s\n", qPrintable( Expression( "User Version == 11" ).toString() ) );
+		ok = false;
+	}
+
+	// benchmark: a typical vercond, compiled once and evaluated many times
+	const int count = argc > 1 ? QString( argv[1] ).toInt() : 1000000;
+	const QString cond = "(Version >= 20.2.0.7) && ((User Version == 11) || (User Version 2 > 26))";
+
+	QElapsedTimer timer;
+	timer.start();
+
+	for ( int i = 0; i < 1000; i++ )
+		Expression e( cond );
+
+	double compileTime = timer.nsecsElapsed() / 1e3 / 1000;
+	timer.restart();
+
+	Expression e( cond );
+	quint32 sum = 0;
+
+	for ( int i = 0; i < count; i++ )
+		sum += e.evaluateValue( resolve );
+
+	double evalTime = timer.nsecsElapsed() / double( count );
+
+	printf( "compile %.1f us, evaluate %.1f ns (%u of %d true)\n", compileTime, evalTime, sum, count );
+	printf( "%s\n", ok ? "all tests passed" : "some tests failed" );
+
+	return ok ? 0 : 1;
+}
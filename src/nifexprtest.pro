@@ -0,0 +1,13 @@
+TEMPLATE = app
+LANGUAGE = C++
+TARGET   = nifexprtest
+
+QT -= gui
+CONFIG += c++11 release thread warn_on console
+
+DESTDIR = ./
+
+HEADERS += nifexpr.h
+SOURCES += nifexpr.cpp nifexprtest.cpp
+
+# vim: set filetype=config :
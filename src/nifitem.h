@@ -37,10 +37,15 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "nifvalue.h"
 
 #include <QSharedData> // Inherited
+#include <QAtomicInteger>
+#include <QBitArray>
+#include <QHash>
 #include <QPointer>
 #include <QString>
 #include <QVector>
 
+#include <cstring>
+
 
 //! \file nifitem.h NifItem, NifBlock, NifData, NifSharedData
 
@@ -56,19 +61,19 @@ class NifSharedData final : public QSharedData
 
 	//! Constructor.
 	NifSharedData( const QString & n, const QString & t, const QString & tt, const QString & a, const QString & a1, const QString & a2, const QString & c, quint32 v1, quint32 v2, bool abs )
-		: QSharedData(), name( n ), type( t ), temp( tt ), arg( a ), arr1( a1 ), arr2( a2 ), cond( c ), ver1( v1 ), ver2( v2 ), condexpr( c ), arr1expr( a1 ), isAbstract( abs ) {}
+		: QSharedData(), name( n ), type( t ), temp( tt ), arg( a ), arr1( a1 ), arr2( a2 ), cond( c ), ver1( v1 ), ver2( v2 ), condexpr( c ), arr1expr( a1 ), isAbstract( abs ), blockType( -1 ) {}
 
 	//! Constructor.
 	NifSharedData( const QString & n, const QString & t )
-		: QSharedData(), name( n ), type( t ), ver1( 0 ), ver2( 0 ), isAbstract( false ) {}
+		: QSharedData(), name( n ), type( t ), ver1( 0 ), ver2( 0 ), isAbstract( false ), blockType( -1 ) {}
 
 	//! Constructor.
 	NifSharedData( const QString & n, const QString & t, const QString & txt )
-		: QSharedData(), name( n ), type( t ), ver1( 0 ), ver2( 0 ), text( txt ), isAbstract( false ) {}
+		: QSharedData(), name( n ), type( t ), ver1( 0 ), ver2( 0 ), text( txt ), isAbstract( false ), blockType( -1 ) {}
 
 	//! Constructor.
 	NifSharedData()
-		: QSharedData(), ver1( 0 ), ver2( 0 ), isAbstract( false ) {}
+		: QSharedData(), ver1( 0 ), ver2( 0 ), isAbstract( false ), blockType( -1 ) {}
 
 	//! Name.
 	QString name;
@@ -100,6 +105,8 @@ class NifSharedData final : public QSharedData
 	Expression verexpr;
 	//! Abstract flag.
 	bool isAbstract;
+	//! Block type id, see NifBlock::typeId; -1 if this is not a block.
+	int blockType;
 };
 
 //! The data and NifValue stored by a NifItem
@@ -148,6 +155,8 @@ public:
 	inline const Expression & verexpr() const { return d->verexpr; }
 	//! Get the abstract attribute of the data.
 	inline const bool & isAbstract() const { return d->isAbstract; }
+	//! Get the block type id of the data.
+	inline int blockType() const { return d->blockType; }
 
 	//! Sets the name of the data.
 	void setName( const QString & name ) { d->name = name; }
@@ -163,6 +172,12 @@ public:
 		d->arr1 = arr1;
 		d->arr1expr = Expression( arr1 );
 	}
+	//! Sets the first array length of the data, compiled as \a expr.
+	void setArr1( const QString & arr1, const Expression & expr )
+	{
+		d->arr1 = arr1;
+		d->arr1expr = expr;
+	}
 	//! Sets the second array length of the data.
 	void setArr2( const QString & arr2 ) { d->arr2 = arr2; }
 	//! Sets the condition attribute of the data.
@@ -171,6 +186,12 @@ public:
 		d->cond = cond;
 		d->condexpr = Expression( cond );
 	}
+	//! Sets the condition attribute of the data, compiled as \a expr.
+	void setCond( const QString & cond, const Expression & expr )
+	{
+		d->cond = cond;
+		d->condexpr = expr;
+	}
 	//! Sets the earliest version of the data.
 	void setVer1( quint32 ver1 ) { d->ver1 = ver1; }
 	//! Sets the latest version of the data.
@@ -183,8 +204,16 @@ public:
 		d->vercond = cond;
 		d->verexpr = Expression( cond );
 	}
+	//! Sets the version condition attribute of the data, compiled as \a expr.
+	void setVerCond( const QString & cond, const Expression & expr )
+	{
+		d->vercond = cond;
+		d->verexpr = expr;
+	}
 	//! Sets the abstract attribute of the data.
 	void setAbstract( bool & isAbstract ) { d->isAbstract = isAbstract; }
+	//! Sets the block type id of the data.
+	void setBlockType( int blockType ) { d->blockType = blockType; }
 
 protected:
 	//! The internal shared data.
@@ -195,9 +224,47 @@ public:
 	NifValue value;
 };
 
+class NifSchema;
+
+//! An interned field name.
+/*!
+ * Every field name of nif.xml gets a small integer id when the schema is
+ * built, so looking up a field by key with BaseModel::getItem() hashes an
+ * int instead of the name. A key looks its id up in the schema of the
+ * layout it is used with and remembers it, so keys are meant to be created
+ * once and reused, e.g. as function-local statics:
+ *
+ * \code
+ * static const NifFieldKey timeKey( "Time" );
+ * float t = nif->get<float>( frame, timeKey );
+ * \endcode
+ */
+class NifFieldKey final
+{
+public:
+	//! Constructor.
+	explicit NifFieldKey( const QString & name )
+		: n( name ) {}
+
+	//! Return the field name.
+	inline const QString & name() const { return n; }
+	//! Return the id of the name in \a schema, or -1 if no field has the name.
+	int id( const NifSchema & schema ) const;
+
+	//! Return the id of \a name in \a schema, or -1 if no field has the name.
+	static int find( const NifSchema & schema, const QString & name );
+
+private:
+	QString n;
+	//! The serial of the schema the id was looked up in, and the id
+	mutable QAtomicInteger<quint64> cached;
+};
+
 //! A block representing a niobject in XML.
 struct NifBlock
 {
+	NifBlock() : abstract( false ), typeId( -1 ), fieldCount( 0 ), schema( nullptr ) {}
+
 	//! Identifier.
 	QString id;
 	//! Ancestor.
@@ -208,6 +275,16 @@ struct NifBlock
 	bool abstract;
 	//! Data present.
 	QList<NifData> types;
+	//! Position in NifSchema::blockTypes.
+	int typeId;
+	//! Bit n is set if this block is or inherits from the block with typeId n.
+	QBitArray lineage;
+	//! Rows of the fields of an item built from this block, by NifFieldKey id; includes the ancestors' fields.
+	QHash<int, QVector<int>> fieldRows;
+	//! Number of rows of an item built from this block.
+	int fieldCount;
+	//! The schema the block belongs to.
+	const NifSchema * schema;
 };
 
 //! An item which contains NifData
@@ -216,16 +293,17 @@ class NifItem
 public:
 	//! Constructor.
 	NifItem( NifItem * parent )
-		: parentItem( parent ) {}
+		: parentItem( parent ), itemRow( 0 ), itemLayout( nullptr ), packedRows( nullptr ) {}
 
 	//! Constructor.
 	NifItem( const NifData & data, NifItem * parent )
-		: itemData( data ), parentItem( parent ) {}
+		: itemData( data ), parentItem( parent ), itemRow( 0 ), itemLayout( nullptr ), packedRows( nullptr ) {}
 
 	//! Destructor.
 	~NifItem()
 	{
 		qDeleteAll( childItems );
+		delete packedRows;
 	}
 
 	//! Return the parent item.
@@ -238,7 +316,7 @@ public:
 	int row() const
 	{
 		if ( parentItem )
-			return parentItem->childItems.indexOf( const_cast<NifItem *>(this) );
+			return itemRow;
 
 		return 0;
 	}
@@ -249,9 +327,88 @@ public:
 	 */
 	void prepareInsert( int e )
 	{
+		unpack();
 		childItems.reserve( childItems.count() + e );
 	}
 
+	//! Store the rows of an array as values only
+	/*!
+	 * A packed array holds its rows as one contiguous block of plain data,
+	 * laid out as the streams read them, instead of an item per row. The
+	 * items are created only on an explicit unpack(), e.g. when a view fetches
+	 * the rows of the array or a row is edited through the non-const child();
+	 * until then getArray(), setArray() and the streams work on the block directly.
+	 * Only an array without rows can be packed, see NifValue::isPackable().
+	 *
+	 * \param data The data every row is created with
+	 * \param count The number of rows
+	 */
+	void pack( const NifData & data, int count )
+	{
+		Q_ASSERT( childItems.isEmpty() && !packedRows );
+		packedRows = new PackedRows;
+		packedRows->data = data;
+		packedRows->size = NifValue::packedSize( data.value.type() );
+		insertPacked( 0, count );
+	}
+
+	//! Return true if the rows are stored as values only, see pack()
+	inline bool isPacked() const { return packedRows; }
+
+	//! Return the rows of a packed array as one block
+	inline const QByteArray & packedData() const { return packedRows->bytes; }
+
+	//! Return the value of a row of a packed array
+	NifValue packedValue( int row ) const
+	{
+		NifValue value( packedRows->data.value );
+		value.fromPacked( packedRows->bytes.constData() + row * packedRows->size );
+		return value;
+	}
+
+	//! Set the value of a row of a packed array; the value must have the type of the array
+	void setPackedValue( int row, const NifValue & value )
+	{
+		Q_ASSERT( value.type() == packedRows->data.value.type() );
+		value.toPacked( packedRows->bytes.data() + row * packedRows->size );
+	}
+
+	//! Insert rows into a packed array, set to the value the array was packed with
+	void insertPacked( int row, int count )
+	{
+		int size = packedRows->size;
+		QByteArray fill( size, 0 );
+		packedRows->data.value.toPacked( fill.data() );
+		packedRows->bytes.insert( row * size, fill.repeated( count ) );
+	}
+
+	//! Copy rows into a packed array from a block laid out as packedData(), as far as both reach
+	void setPackedData( const QByteArray & bytes )
+	{
+		memcpy( packedRows->bytes.data(), bytes.constData(), qMin( bytes.size(), packedRows->bytes.size() ) );
+	}
+
+	//! Create the items of the rows of a packed array
+	void unpack()
+	{
+		if ( !packedRows )
+			return;
+
+		PackedRows * rows = packedRows;
+		packedRows = nullptr;
+
+		int count = rows->bytes.size() / rows->size;
+		childItems.reserve( count );
+
+		for ( int r = 0; r < count; r++ ) {
+			NifData data( rows->data );
+			data.value.fromPacked( rows->bytes.constData() + r * rows->size );
+			insertChild( data );
+		}
+
+		delete rows;
+	}
+
 	//! Insert child data item
 	/*!
 	 * \param data The data to insert
@@ -260,12 +417,17 @@ public:
 	 */
 	NifItem * insertChild( const NifData & data, int at = -1 )
 	{
+		unpack();
+
 		NifItem * item = new NifItem( data, this );
 
-		if ( at < 0 || at > childItems.count() )
+		if ( at < 0 || at > childItems.count() ) {
+			item->itemRow = childItems.count();
 			childItems.append( item );
-		else
+		} else {
 			childItems.insert( at, item );
+			renumber( at );
+		}
 
 		return item;
 	}
@@ -278,12 +440,17 @@ public:
 	 */
 	int insertChild( NifItem * child, int at = -1 )
 	{
+		unpack();
+
 		child->parentItem = this;
 
-		if ( at < 0 || at > childItems.count() )
+		if ( at < 0 || at > childItems.count() ) {
+			child->itemRow = childItems.count();
 			childItems.append( child );
-		else
+		} else {
 			childItems.insert( at, child );
+			renumber( at );
+		}
 
 		return child->row();
 	}
@@ -299,6 +466,7 @@ public:
 
 		if ( item ) {
 			childItems.remove( row );
+			renumber( row );
 			item->parentItem = 0;
 		}
 
@@ -315,6 +483,7 @@ public:
 
 		if ( item ) {
 			childItems.remove( row );
+			renumber( row );
 			delete item;
 		}
 	}
@@ -326,6 +495,11 @@ public:
 	 */
 	void removeChildren( int row, int count )
 	{
+		if ( packedRows ) {
+			packedRows->bytes.remove( row * packedRows->size, count * packedRows->size );
+			return;
+		}
+
 		for ( int c = row; c < row + count; c++ ) {
 			NifItem * item = childItems.value( c );
 
@@ -334,15 +508,23 @@ public:
 		}
 
 		childItems.remove( row, count );
+		renumber( row );
 	}
 
 	//! Return the child item at the specified row
 	NifItem * child( int row )
 	{
+		unpack();
 		return childItems.value( row );
 	}
 
 	//! Return the child item at the specified row
+	/*!
+	 * Unlike the non-const overload this never unpacks, so it is safe in
+	 * const lookups such as BaseModel::index() and on threads that share the
+	 * model, such as the workers of NifModel::save().
+	 * The rows of a packed array have no items; it returns null for them.
+	 */
 	const NifItem * child( int row ) const
 	{
 		return childItems.value( row );
@@ -351,6 +533,8 @@ public:
 	//! Return the child item with the specified name
 	NifItem * child( const QString & name )
 	{
+		unpack();
+
 		for ( NifItem * child : childItems ) {
 			if ( child->name() == name )
 				return child;
@@ -358,7 +542,7 @@ public:
 		return 0;
 	}
 
-	//! Return the child item with the specified name
+	//! Return the child item with the specified name; never unpacks, see child( int ) const
 	const NifItem * child( const QString & name ) const
 	{
 		for ( const NifItem * child : childItems ) {
@@ -371,7 +555,7 @@ public:
 	//! Return a count of the number of child items
 	int childCount() const
 	{
-		return childItems.count();
+		return packedRows ? packedRows->bytes.size() / packedRows->size : childItems.count();
 	}
 
 	//! Remove all child items
@@ -379,6 +563,8 @@ public:
 	{
 		qDeleteAll( childItems );
 		childItems.clear();
+		delete packedRows;
+		packedRows = nullptr;
 	}
 
 	//! Return the value of the item data (const version)
@@ -417,6 +603,10 @@ public:
 	inline const Expression & verexpr() const {   return itemData.verexpr();  }
 	//! Return the abstract attribute of the data
 	inline const bool & isAbstract() const { return itemData.isAbstract(); }
+	//! Return the block type id of the data
+	inline int blockType() const { return itemData.blockType(); }
+	//! Return the compound or block the children of this item were built from
+	inline const NifBlock * layout() const { return itemLayout; }
 
 	//! Set the name
 	inline void setName( const QString & name ) {   itemData.setName( name );   }
@@ -442,6 +632,10 @@ public:
 	inline void setText( const QString & text )    {   itemData.setText( text );    }
 	//! Set the version condition attribute
 	inline void setVerCond( const QString & cond ) {   itemData.setVerCond( cond ); }
+	//! Set the block type id
+	inline void setBlockType( int type ) {   itemData.setBlockType( type );  }
+	//! Set the compound or block the children of this item were built from
+	inline void setLayout( const NifBlock * block ) {   itemLayout = block; }
 
 	//! Determine if this item is present in the specified version
 	inline bool evalVersion( quint32 v )
@@ -450,9 +644,25 @@ public:
 	}
 
 	//! Get the child items as an array
+	/*!
+	 * The rows of a packed array laid out as T are copied as one block.
+	 */
 	template <typename T> QVector<T> getArray() const
 	{
 		QVector<T> array;
+		if ( packedRows ) {
+			int count = childCount();
+			if ( NifValue::packsAs<T>( packedRows->data.value.type() ) && sizeof( T ) == size_t( packedRows->size ) ) {
+				array.resize( count );
+				memcpy( static_cast<void *>( array.data() ), packedRows->bytes.constData(), packedRows->bytes.size() );
+				return array;
+			}
+			array.reserve( count );
+			for ( int r = 0; r < count; r++ )
+				array.append( packedValue( r ).get<T>() );
+			return array;
+		}
+		array.reserve( childCount() );
 		for ( NifItem * child : childItems ) {
 			array.append( child->itemData.value.get<T>() );
 		}
@@ -460,21 +670,68 @@ public:
 	}
 
 	//! Set the child items from an array
+	/*!
+	 * The rows of a packed array laid out as T are copied as one block; as
+	 * for items, rows past the end of the array are set to T().
+	 */
 	template <typename T> void setArray( const QVector<T> & array )
 	{
 		int x = 0;
+		if ( packedRows ) {
+			int count = childCount();
+			if ( NifValue::packsAs<T>( packedRows->data.value.type() ) && sizeof( T ) == size_t( packedRows->size ) ) {
+				int n = qMin( array.count(), count );
+				memcpy( packedRows->bytes.data(), static_cast<const void *>( array.constData() ), n * sizeof( T ) );
+				for ( int r = n; r < count; r++ ) {
+					T def = T();
+					memcpy( packedRows->bytes.data() + r * sizeof( T ), static_cast<const void *>( &def ), sizeof( T ) );
+				}
+				return;
+			}
+			for ( int r = 0; r < count; r++ ) {
+				NifValue value( packedRows->data.value );
+				value.set<T>( array.value( r ) );
+				setPackedValue( r, value );
+			}
+			return;
+		}
 		for ( NifItem * child : childItems ) {
 			child->itemData.value.set<T>( array.value( x++ ) );
 		}
 	}
 
 private:
+	//! Update the row of the child items from row on, after they moved
+	void renumber( int row )
+	{
+		for ( int r = qMax( row, 0 ); r < childItems.count(); r++ )
+			childItems[r]->itemRow = r;
+	}
+
 	//! The data held by the item
 	NifData itemData;
 	//! The parent of this item
 	NifItem * parentItem;
+	//! The row of this item in its parent
+	int itemRow;
 	//! The child items
 	QVector<NifItem *> childItems;
+	//! The compound or block the child items were built from
+	const NifBlock * itemLayout;
+
+	//! The rows of a packed array
+	struct PackedRows
+	{
+		//! The data the items of the rows are created with
+		NifData data;
+		//! The size in bytes of a row
+		int size;
+		//! The rows, laid out as NifValue::toPacked() writes them
+		QByteArray bytes;
+	};
+
+	//! The rows not yet created as items, if the array is packed
+	PackedRows * packedRows;
 };
 
 #endif
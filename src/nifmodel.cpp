@@ -37,11 +37,16 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "niftypes.h"
 #include "spellbook.h"
 
+#include <QBuffer>
 #include <QByteArray>
 #include <QColor>
 #include <QDebug>
 #include <QFile>
+#include <QRunnable>
+#include <QSemaphore>
 #include <QSettings>
+#include <QThread>
+#include <QThreadPool>
 #include <QTime>
 #include <QtEndian>
 
@@ -144,24 +149,18 @@ public:
 		this->item  = item;
 	}
 
-	QVariant operator()( const QVariant & v ) const
+	quint32 operator()( const QString & name ) const
 	{
-		if ( v.type() == QVariant::String ) {
-			QString left = v.toString();
-			NifItem * i  = const_cast<NifItem *>(item);
-			i = model->getItem( i, left );
-
-			if ( i ) {
-				if ( i->value().isCount() )
-					return QVariant( i->value().toCount() );
-				else if ( i->value().isFileVersion() )
-					return QVariant( i->value().toFileVersion() );
-			}
+		NifItem * i = model->getItem( const_cast<NifItem *>(item), name );
 
-			return QVariant( 0 );
+		if ( i ) {
+			if ( i->value().isCount() )
+				return i->value().toCount();
+			else if ( i->value().isFileVersion() )
+				return i->value().toFileVersion();
 		}
 
-		return v;
+		return 0;
 	}
 };
 
@@ -179,9 +178,7 @@ bool NifModel::evalVersion( NifItem * item, bool chkParents ) const
 	if ( !item->evalVersion( version ) )
 		return false;
 
-	QString vercond = item->vercond();
-
-	if ( vercond.isEmpty() )
+	if ( item->verexpr().isEmpty() )
 		return true;
 
 	NifModelEval functor( this, getHeaderItem() );
@@ -194,6 +191,12 @@ void NifModel::clear()
 	fileinfo = QFileInfo();
 	filename = QString();
 	folder = QString();
+	schema = activeSchema();
+	lazyBlocks.clear();
+	lazyData.clear();
+	lazyFile.reset();
+	lazyHolds = 0;
+	prunedLinks = false;
 	root->killChildren();
 	insertType( root, NifData( "NiHeader", "Header" ) );
 	insertType( root, NifData( "NiFooter", "Footer" ) );
@@ -240,6 +243,7 @@ void NifModel::clear()
 
 	lockUpdates = false;
 	needUpdates = utNone;
+	editHeldUpdates = false;
 	endResetModel();
 }
 
@@ -302,6 +306,11 @@ NifItem * NifModel::getHeaderItem() const
 }
 
 void NifModel::updateHeader()
+{
+	updateHeader( nullptr );
+}
+
+void NifModel::updateHeader( const QVector<QByteArray> * blockData )
 {
 	if ( lockUpdates ) {
 		needUpdates = UpdateType( needUpdates | utHeader );
@@ -346,7 +355,8 @@ void NifModel::updateHeader()
 
 			blocktypeindices.append( blocktypes.indexOf( blockName ) );
 
-			if ( version >= 0x14020000 && idxBlockSize )
+			// serialized blocks were written with their arrays already updated
+			if ( version >= 0x14020000 && idxBlockSize && !blockData )
 				updateArrays( block, false );
 		}
 
@@ -370,8 +380,17 @@ void NifModel::updateHeader()
 
 		// for version 20.2.0.? and above the block size is stored in the header
 		if ( version >= 0x14020000 && idxBlockSize ) {
-			for ( int r = 0; r < idxBlockSize->childCount(); r++ )
-				set<quint32>( idxBlockSize->child( r ), blockSize( getBlockItem( r ) ) );
+			QVector<quint32> sizes( idxBlockSize->childCount() );
+
+			for ( int r = 0; r < sizes.count(); r++ ) {
+				if ( blockData && r < blockData->count() )
+					sizes[r] = blockData->at( r ).size();
+				else
+					sizes[r] = blockSize( getBlockItem( r ) );
+			}
+
+			// the sizes are a packed array; set them as one block
+			setArray<quint32>( createIndex( idxBlockSize->row(), 0, idxBlockSize ), sizes );
 		}
 
 
@@ -419,21 +438,14 @@ NifItem * NifModel::getItem( NifItem * item, const QString & name ) const
 		return getItem( getItem( item, left ), right );
 	}
 
-	for ( int c = 0; c < item->childCount(); c++ ) {
-		NifItem * child = item->child( c );
-
-		if ( child && child->name() == name && evalCondition( child ) )
-			return child;
-	}
-
-	return 0;
+	return getChild( item, name, nullptr );
 }
 
 /*
  *  array functions
  */
 
-static QString parentPrefix( const QString & x )
+QString NifModel::parentPrefix( const QString & x )
 {
 	for ( int c = 0; c < x.length(); c++ ) {
 		if ( !x[c].isNumber() )
@@ -472,7 +484,9 @@ bool NifModel::updateByteArrayItem( NifItem * array, bool fast )
 
 					// Now insert approprate rows and replace data from byte array to preserve some of the data.
 					if ( calcRows > 0 ) {
-						NifData data( array->name(), array->type(), array->temp(), NifValue( NifValue::type( array->type() ) ), parentPrefix( array->arg() ), parentPrefix( array->arr2() ), QString(), QString(), 0, 0 );
+						NifData data( array->name(), array->type(), array->temp(), NifValue( NifValue::type( array->type() ) ), parentPrefix( array->arg() ), QString(), QString(), QString(), 0, 0 );
+						QString arr1 = parentPrefix( array->arr2() );
+						data.setArr1( arr1, schema->expression( arr1 ) );
 
 						if ( !fast )
 							beginInsertRows( createIndex( array->row(), 0, array ), 0, calcRows - 1 );
@@ -574,15 +588,37 @@ bool NifModel::updateArrayItem( NifItem * array, bool fast )
 	int rows = array->childCount();
 
 	if ( d1 > rows ) {
-		NifData data( array->name(), array->type(), array->temp(), NifValue( NifValue::type( array->type() ) ), parentPrefix( array->arg() ), parentPrefix( array->arr2() ), QString(), QString(), 0, 0 );
+		NifData data( array->name(), array->type(), array->temp(), NifValue( NifValue::type( array->type() ) ), parentPrefix( array->arg() ), QString(), QString(), QString(), 0, 0 );
+		QString arr1 = parentPrefix( array->arr2() );
+		data.setArr1( arr1, schema->expression( arr1 ) );
 
 		if ( !fast )
 			beginInsertRows( createIndex( array->row(), 0, array ), rows, d1 - 1 );
 
-		array->prepareInsert( d1 - rows );
+		if ( data.arr1().isEmpty() && !isCompound( data.type() ) && data.type() != "TEMPLATE" && data.temp() != "TEMPLATE" ) {
+			// Every row of a plain value array is the same; skip the compound
+			// and template lookups insertType() would repeat for each of them
+			if ( data.value.type() == NifValue::tString || data.value.type() == NifValue::tFilePath )
+				data.value.changeType( version < 0x14010003 ? NifValue::tSizedString : NifValue::tStringIndex );
+
+			if ( NifValue::isPackable( data.value.type() ) && ( rows == 0 || array->isPacked() ) ) {
+				// vertices, normals, triangles and the like get no item per row until a view fetches them
+				if ( array->isPacked() )
+					array->insertPacked( rows, d1 - rows );
+				else
+					array->pack( data, d1 );
+			} else {
+				array->prepareInsert( d1 - rows );
 
-		for ( int c = rows; c < d1; c++ )
-			insertType( array, data );
+				for ( int c = rows; c < d1; c++ )
+					array->insertChild( data );
+			}
+		} else {
+			array->prepareInsert( d1 - rows );
+
+			for ( int c = rows; c < d1; c++ )
+				insertType( array, data );
+		}
 
 		if ( !fast )
 			endInsertRows();
@@ -605,7 +641,7 @@ bool NifModel::updateArrayItem( NifItem * array, bool fast )
 			parent = parent->parent();
 
 		if ( parent != getFooterItem() ) {
-			updateLinks();
+			updateLinks( getBlockNumber( parent ) );
 			updateFooter();
 			emit linksChanged();
 		}
@@ -619,6 +655,10 @@ bool NifModel::updateArrays( NifItem * parent, bool fast )
 	if ( !parent )
 		return false;
 
+	// the rows of a packed array are plain values
+	if ( parent->isPacked() )
+		return true;
+
 	for ( int row = 0; row < parent->childCount(); row++ ) {
 		NifItem * child = parent->child( row );
 
@@ -645,7 +685,7 @@ bool NifModel::updateArrays( NifItem * parent, bool fast )
 
 QModelIndex NifModel::insertNiBlock( const QString & identifier, int at, bool fast )
 {
-	NifBlock * block = blocks.value( identifier );
+	NifBlock * block = schema->blocks.value( identifier );
 
 	if ( block ) {
 		if ( at < 0 || at > getBlockCount() )
@@ -663,6 +703,8 @@ QModelIndex NifModel::insertNiBlock( const QString & identifier, int at, bool fa
 			beginInsertRows( QModelIndex(), at, at );
 
 		NifItem * branch = insertBranch( root, NifData( identifier, "NiBlock", block->text ), at );
+		branch->setBlockType( block->typeId );
+		branch->setLayout( block );
 
 		if ( !fast )
 			endInsertRows();
@@ -695,6 +737,7 @@ void NifModel::removeNiBlock( int blocknum )
 	if ( blocknum < 0 || blocknum >= getBlockCount() )
 		return;
 
+	lazyBlocks.remove( root->child( blocknum + 1 ) );
 	adjustLinks( root, blocknum, 0 );
 	adjustLinks( root, blocknum, -1 );
 	beginRemoveRows( QModelIndex(), blocknum + 1, blocknum + 1 );
@@ -706,6 +749,74 @@ void NifModel::removeNiBlock( int blocknum )
 	emit linksChanged();
 }
 
+void NifModel::mergeNiBlocks( const QMap<qint32, qint32> & map )
+{
+	int n = getBlockCount();
+
+	if ( map.isEmpty() )
+		return;
+
+	if ( map.firstKey() < 0 || map.lastKey() >= n ) {
+		msg( Message() << tr( "NifModel::mergeNiBlocks() - invalid argument" ) );
+		return;
+	}
+
+	// the number of each block once the merged blocks are gone
+	QVector<qint32> numbers( n );
+
+	for ( qint32 b = 0, removed = 0; b < n; b++ ) {
+		if ( map.contains( b ) ) {
+			numbers[b] = -1;
+			removed++;
+		} else {
+			numbers[b] = b - removed;
+		}
+	}
+
+	// one pass over all links both redirects and renumbers them
+	QMap<qint32, qint32> linkMap;
+
+	for ( qint32 b = 0; b < n; b++ ) {
+		qint32 target = b;
+
+		for ( int hops = 0; map.contains( target ) && hops < n; hops++ )
+			target = map.value( target );
+
+		if ( target < 0 || target >= n || numbers[target] < 0 ) {
+			msg( Message() << tr( "NifModel::mergeNiBlocks() - invalid argument" ) );
+			return;
+		}
+
+		if ( numbers[target] != b )
+			linkMap.insert( b, numbers[target] );
+	}
+
+	mapLinks( root, linkMap );
+
+	// remove runs of consecutive blocks at once, last run first
+	QList<qint32> blocks = map.keys();
+
+	for ( int i = blocks.count() - 1; i >= 0; ) {
+		qint32 last = blocks[i];
+		qint32 first = last;
+
+		while ( --i >= 0 && blocks[i] == first - 1 )
+			first--;
+
+		for ( qint32 b = first; b <= last; b++ )
+			lazyBlocks.remove( root->child( b + 1 ) );
+
+		beginRemoveRows( QModelIndex(), first + 1, last + 1 );
+		root->removeChildren( first + 1, last - first + 1 );
+		endRemoveRows();
+	}
+
+	updateHeader();
+	updateLinks();
+	updateFooter();
+	emit linksChanged();
+}
+
 void NifModel::moveNiBlock( int src, int dst )
 {
 	if ( src < 0 || src >= getBlockCount() )
@@ -745,7 +856,8 @@ void NifModel::moveNiBlock( int src, int dst )
 
 void NifModel::updateStrings( NifModel * src, NifModel * tgt, NifItem * item )
 {
-	if ( NULL == item )
+	// packed arrays hold no strings
+	if ( NULL == item || item->isPacked() )
 		return;
 
 	NifValue::Type vt = item->value().type();
@@ -762,6 +874,8 @@ void NifModel::updateStrings( NifModel * src, NifModel * tgt, NifItem * item )
 
 QMap<qint32, qint32> NifModel::moveAllNiBlocks( NifModel * targetnif, bool update )
 {
+	loadLazyBlocks();
+
 	int bcnt = getBlockCount();
 
 	bool doStringUpdate = (  this->getVersionNumber() >= 0x14010003 || targetnif->getVersionNumber() >= 0x14010003 );
@@ -945,8 +1059,10 @@ QModelIndex NifModel::getBlock( int x, const QString & name ) const
 	x += 1; //the first block is the NiHeader
 	QModelIndex idx = index( x, 0 );
 
-	if ( inherits( idx, name ) )
+	if ( inherits( idx, name ) ) {
+		loadLazyBlock( static_cast<NifItem *>( idx.internalPointer() ) );
 		return idx;
+	}
 
 	return QModelIndex();
 }
@@ -959,6 +1075,13 @@ bool NifModel::isNiBlock( const QModelIndex & index, const QString & name ) cons
 		if ( name.isEmpty() )
 			return true;
 
+		// compare type ids; names the schema does not know are compared as before
+		int id = item->blockType();
+		const NifBlock * type = schema->blocks.value( name );
+
+		if ( id >= 0 && type )
+			return id == type->typeId;
+
 		return item->name() == name;
 	}
 
@@ -970,7 +1093,9 @@ NifItem * NifModel::getBlockItem( int x ) const
 	if ( x < 0 || x >= getBlockCount() )
 		return 0;
 
-	return root->child( x + 1 );
+	NifItem * block = root->child( x + 1 );
+	loadLazyBlock( block );
+	return block;
 }
 
 int NifModel::getBlockCount() const
@@ -986,7 +1111,7 @@ int NifModel::getBlockCount() const
 void NifModel::insertAncestor( NifItem * parent, const QString & identifier, int at )
 {
 	Q_UNUSED( at );
-	NifBlock * ancestor = blocks.value( identifier );
+	NifBlock * ancestor = schema->blocks.value( identifier );
 
 	if ( ancestor ) {
 		if ( !ancestor->ancestor.isEmpty() )
@@ -1007,22 +1132,49 @@ bool NifModel::inherits( const QString & name, const QString & aunty ) const
 	if ( name == aunty )
 		return true;
 
-	NifBlock * type = blocks.value( name );
+	NifBlock * type = schema->blocks.value( name );
 
-	if ( type && ( type->ancestor == aunty || inherits( type->ancestor, aunty ) ) )
+	if ( !type )
+		return false;
+
+	// every block inherits from the empty ancestor
+	if ( aunty.isEmpty() )
 		return true;
 
-	return false;
+	NifBlock * ancestor = schema->blocks.value( aunty );
+
+	return ancestor && type->lineage.testBit( ancestor->typeId );
 }
 
 bool NifModel::inherits( const QModelIndex & idx, const QString & aunty ) const
 {
-	int x = getBlockNumber( idx );
+	if ( !( idx.isValid() && idx.model() == this ) )
+		return false;
+
+	const NifItem * block = static_cast<NifItem *>( idx.internalPointer() );
 
-	if ( x < 0 )
+	while ( block && block->parent() != root )
+		block = block->parent();
+
+	if ( !block )
+		return false;
+
+	// header and footer are no blocks
+	if ( block->row() < 1 || block->row() > getBlockCount() )
 		return false;
 
-	return inherits( itemName( index( x + 1, 0 ) ), aunty );
+	// blocks of a type the schema does not know fall back to their name
+	int id = block->blockType();
+
+	if ( id < 0 || id >= schema->blockTypes.count() )
+		return inherits( block->name(), aunty );
+
+	if ( aunty.isEmpty() )
+		return true;
+
+	NifBlock * ancestor = schema->blocks.value( aunty );
+
+	return ancestor && schema->blockTypes.at( id )->lineage.testBit( ancestor->typeId );
 }
 
 
@@ -1049,10 +1201,11 @@ void NifModel::insertType( NifItem * parent, const NifData & data, int at )
 		return;
 	}
 
-	NifBlock * compound = compounds.value( data.type() );
+	NifBlock * compound = schema->compounds.value( data.type() );
 
 	if ( compound ) {
 		NifItem * branch = insertBranch( parent, data, at );
+		branch->setLayout( compound );
 		branch->prepareInsert( compound->types.count() );
 		for ( const NifData& d : compound->types ) {
 			insertType( branch, d );
@@ -1097,8 +1250,9 @@ void NifModel::insertType( NifItem * parent, const NifData & data, int at )
 
 bool NifModel::setItemValue( NifItem * item, const NifValue & val )
 {
+	itemEditing( item );
 	item->value() = val;
-	emit dataChanged( createIndex( item->row(), ValueCol, item ), createIndex( item->row(), ValueCol, item ) );
+	itemChanged( item );
 
 	if ( itemIsLink( item ) ) {
 		NifItem * parent = item;
@@ -1107,7 +1261,7 @@ bool NifModel::setItemValue( NifItem * item, const NifValue & val )
 			parent = parent->parent();
 
 		if ( parent != getFooterItem() ) {
-			updateLinks();
+			updateLinks( getBlockNumber( parent ) );
 			updateFooter();
 			emit linksChanged();
 		}
@@ -1121,6 +1275,17 @@ bool NifModel::setItemValue( NifItem * item, const NifValue & val )
  */
 
 QVariant NifModel::data( const QModelIndex & idx, int role ) const
+{
+	// Views ask for data while they lay out their rows; parsing a deferred block
+	// here would insert rows behind their backs, so they parse through fetchMore()
+	lazyHolds++;
+	QVariant v = itemData( idx, role );
+	lazyHolds--;
+
+	return v;
+}
+
+QVariant NifModel::itemData( const QModelIndex & idx, int role ) const
 {
 	QModelIndex index = buddy( idx );
 
@@ -1377,12 +1542,12 @@ QVariant NifModel::data( const QModelIndex & idx, int role ) const
 						              .arg( item->name() )
 						              .arg( QString( item->text() ).replace( "<", "&lt;" ).replace( "\n", "<br/>" ) );
 
-						if ( NifBlock * blk = blocks.value( item->name() ) ) {
+						if ( NifBlock * blk = schema->blocks.value( item->name() ) ) {
 							tip += "<p>Ancestors:<ul>";
 
-							while ( blocks.contains( blk->ancestor ) ) {
+							while ( schema->blocks.contains( blk->ancestor ) ) {
 								tip += QString( "<li>%1</li>" ).arg( blk->ancestor );
-								blk  = blocks.value( blk->ancestor );
+								blk  = schema->blocks.value( blk->ancestor );
 							}
 
 							tip += "</ul></p>";
@@ -1503,6 +1668,31 @@ QVariant NifModel::data( const QModelIndex & idx, int role ) const
 	}
 }
 
+bool NifModel::hasChildren( const QModelIndex & parent ) const
+{
+	// a deferred block has no rows until fetchMore() parses it, but it can be expanded
+	if ( canFetchMore( parent ) )
+		return true;
+
+	return BaseModel::hasChildren( parent );
+}
+
+bool NifModel::canFetchMore( const QModelIndex & parent ) const
+{
+	if ( parent.isValid() && parent.model() == this && lazyBlocks.contains( static_cast<NifItem *>( parent.internalPointer() ) ) )
+		return true;
+
+	return BaseModel::canFetchMore( parent );
+}
+
+void NifModel::fetchMore( const QModelIndex & parent )
+{
+	if ( parent.isValid() && parent.model() == this && lazyBlocks.contains( static_cast<NifItem *>( parent.internalPointer() ) ) )
+		loadLazyBlock( static_cast<NifItem *>( parent.internalPointer() ) );
+	else
+		BaseModel::fetchMore( parent );
+}
+
 bool NifModel::setData( const QModelIndex & index, const QVariant & value, int role )
 {
 	NifItem * item = static_cast<NifItem *>( index.internalPointer() );
@@ -1532,8 +1722,15 @@ bool NifModel::setData( const QModelIndex & index, const QVariant & value, int r
 	case NifModel::NameCol:
 		item->setName( value.toString() );
 
-		if ( item->parent() && item->parent() == root )
+		if ( item->parent() && item->parent() == root ) {
+			if ( item->type() == "NiBlock" ) {
+				NifBlock * block = schema->blocks.value( item->name() );
+				item->setBlockType( block ? block->typeId : -1 );
+				item->setLayout( block );
+			}
+
 			updateHeader();
+		}
 
 		break;
 	case NifModel::TypeCol:
@@ -1551,7 +1748,7 @@ bool NifModel::setData( const QModelIndex & index, const QVariant & value, int r
 				item->value().fromVariant( value );
 
 				if ( isLink( index ) && getBlockOrHeader( index ) != getFooter() ) {
-					updateLinks();
+					updateLinks( getBlockNumber( index ) );
 					updateFooter();
 					emit linksChanged();
 				}
@@ -1632,7 +1829,7 @@ bool NifModel::removeRows( int row, int count, const QModelIndex & parent )
 		endRemoveRows();
 
 		if ( link ) {
-			updateLinks();
+			updateLinks( getBlockNumber( item ) );
 			updateFooter();
 			emit linksChanged();
 		}
@@ -1699,6 +1896,7 @@ bool NifModel::load( QIODevice & device )
 	QSettings cfg;
 	bool ignoreSize = false;
 	ignoreSize = cfg.value( "Ignore Block Size", false ).toBool();
+	bool lazy = Options::lazyBlockLoading();
 
 	clear();
 
@@ -1725,13 +1923,33 @@ bool NifModel::load( QIODevice & device )
 	numblocks = get<int>( header, "Num Blocks" );
 	//qDebug( "numblocks %i", numblocks );
 
+	// blocks can only be parsed on demand if their sizes are known and the data outlives the device
+	lazy = lazy && !ignoreSize && version >= 0x14020000 && get<quint8>( header, "Endian Type" ) != 0;
+
+	if ( lazy ) {
+		if ( QFile * file = qobject_cast<QFile *>( &device ) ) {
+			lazyFile.reset( new QFile( file->fileName() ) );
+			qint64 len = 0;
+			uchar * mapped = nullptr;
+
+			if ( lazyFile->open( QIODevice::ReadOnly ) && ( len = lazyFile->size() ) < INT_MAX && ( mapped = lazyFile->map( 0, len ) ) )
+				lazyData = QByteArray::fromRawData( reinterpret_cast<const char *>( mapped ), int( len ) );
+			else
+				lazyFile.reset();
+		} else if ( QBuffer * buffer = qobject_cast<QBuffer *>( &device ) ) {
+			lazyData = buffer->buffer();
+		}
+
+		lazy = !lazyData.isEmpty();
+	}
+
 	emit sigProgress( 0, numblocks );
 	QTime t = QTime::currentTime();
 
 	qint64 curpos = 0;
 	try
 	{
-		curpos = device.pos();
+		curpos = stream.pos();
 
 		if ( version >= 0x0303000d ) {
 			// read in the NiBlocks
@@ -1740,7 +1958,7 @@ bool NifModel::load( QIODevice & device )
 			for ( int c = 0; c < numblocks; c++ ) {
 				emit sigProgress( c + 1, numblocks );
 
-				if ( device.atEnd() )
+				if ( stream.atEnd() )
 					throw tr( "unexpected EOF during load" );
 
 				QString blktyp;
@@ -1758,7 +1976,7 @@ bool NifModel::load( QIODevice & device )
 						//		 (see for instance meshes/architecture/basementsections/ungrdltraphingedoor.nif)
 						if ( (version < 0x0a020000) && ( !blktyp.startsWith( "bhk" ) ) ) {
 							int dummy;
-							device.read( (char *)&dummy, 4 );
+							stream.read( (char *)&dummy, 4 );
 
 							if ( dummy != 0 )
 								msg( Message() << tr( "non-zero block separator (%1) preceeding block %2" ).arg( dummy ).arg( blktyp ) );
@@ -1766,15 +1984,15 @@ bool NifModel::load( QIODevice & device )
 
 						// for version 20.2.0.? and above the block size is stored in the header
 						if ( !ignoreSize && version >= 0x14020000 )
-							size = get<quint32>( index( c, 0, getIndex( createIndex( header->row(), 0, header ), "Block Size" ) ) );
+							size = getValue( getIndex( createIndex( header->row(), 0, header ), "Block Size" ), c ).get<quint32>();
 					} else {
 						int len;
-						device.read( (char *)&len, 4 );
+						stream.read( (char *)&len, 4 );
 
 						if ( len < 2 || len > 80 )
 							throw tr( "next block does not start with a NiString" );
 
-						blktyp = device.read( len );
+						blktyp = stream.read( len );
 					}
 
 					// Hack for NiMesh data streams
@@ -1802,7 +2020,15 @@ bool NifModel::load( QIODevice & device )
 #endif
 					}
 
-					if ( isNiBlock( blktyp ) ) {
+					if ( lazy && size != UINT_MAX && dataStreamUsage < 0 && isNiBlock( blktyp ) ) {
+						// only insert the block itself, its contents are parsed when first accessed
+						NifBlock * block = schema->blocks.value( blktyp );
+						NifItem * branch = insertBranch( root, NifData( blktyp, "NiBlock", block ? block->text : QString() ), c + 1 );
+						branch->setBlockType( block ? block->typeId : -1 );
+						branch->setLayout( block );
+						lazyBlocks.insert( branch, { curpos, size } );
+						stream.seek( curpos + size );
+					} else if ( isNiBlock( blktyp ) ) {
 						//msg( DbgMsg() << "loading block" << c << ":" << blktyp );
 						QModelIndex newBlock = insertNiBlock( blktyp, -1, true );
 
@@ -1831,16 +2057,16 @@ bool NifModel::load( QIODevice & device )
 
 				// Check device position and emit warning if location is not expected
 				if ( size != UINT_MAX ) {
-					qint64 pos = device.pos();
+					qint64 pos = stream.pos();
 
 					if ( (curpos + size) != pos ) {
 						// unable to seek to location... abort
-						if ( device.seek( curpos + size ) )
+						if ( stream.seek( curpos + size ) )
 							msg( Message() << tr( "device position incorrect after block number %1 (%2) at 0x%3 ended at 0x%4 (expected 0x%5)" ).arg( c ).arg( blktyp ).arg( QString::number( curpos, 16 ) ).arg( QString::number( pos, 16 ) ).arg( QString::number( curpos + size, 16 ) ).toLatin1() );
 						else
 							throw tr( "failed to reposition device at block number %1 (%2) previous block was %3" ).arg( c ).arg( blktyp ).arg( root->child( c )->name() );
 
-						curpos = device.pos();
+						curpos = stream.pos();
 					} else {
 						curpos = pos;
 					}
@@ -1860,30 +2086,30 @@ bool NifModel::load( QIODevice & device )
 				for ( qint32 c = 0; true; c++ ) {
 					emit sigProgress( c + 1, 0 );
 
-					if ( device.atEnd() )
+					if ( stream.atEnd() )
 						throw tr( "unexpected EOF during load" );
 
 					int len;
-					device.read( (char *)&len, 4 );
+					stream.read( (char *)&len, 4 );
 
 					if ( len < 0 || len > 80 )
 						throw tr( "next block does not start with a NiString" );
 
-					QString blktyp = device.read( len );
+					QString blktyp = stream.read( len );
 
 					if ( blktyp == "End Of File" ) {
 						break;
 					} else if ( blktyp == "Top Level Object" ) {
-						device.read( (char *)&len, 4 );
+						stream.read( (char *)&len, 4 );
 
 						if ( len < 0 || len > 80 )
 							throw tr( "next block does not start with a NiString" );
 
-						blktyp = device.read( len );
+						blktyp = stream.read( len );
 					}
 
 					qint32 p;
-					device.read( (char *)&p, 4 );
+					stream.read( (char *)&p, 4 );
 					p -= 1;
 
 					if ( p != c )
@@ -1919,20 +2145,127 @@ bool NifModel::load( QIODevice & device )
 		return false;
 	}
 	//msg( Message() << t.msecsTo( QTime::currentTime() ) );
+	// deferred blocks join the link tables as they are parsed, see loadLazyBlock()
 	reset(); // notify model views that a significant change to the data structure has occurded
+
 	return true;
 }
 
+//! Serializes blocks into their own buffers on a pool thread
+class BlockWriteTask final : public QRunnable
+{
+public:
+	BlockWriteTask( const NifModel * nif, QByteArray * data, int count, QAtomicInt * next, QAtomicInt * failed, QSemaphore * done )
+		: nif( nif ), data( data ), count( count ), next( next ), failed( failed ), done( done ) {}
+
+	void run() override final
+	{
+		nif->saveBlocks( data, count, next, failed );
+		done->release();
+	}
+
+private:
+	const NifModel * nif;
+	QByteArray * data;
+	int count;
+	QAtomicInt * next;
+	QAtomicInt * failed;
+	QSemaphore * done;
+};
+
+void NifModel::saveBlocks( QByteArray * data, int count, QAtomicInt * next, QAtomicInt * failed ) const
+{
+	// blocks vary wildly in size, so each thread takes the next unwritten one
+	for ( int b = next->fetchAndAddRelaxed( 1 ); b < count; b = next->fetchAndAddRelaxed( 1 ) ) {
+		if ( failed->load() >= 0 )
+			return;
+
+		QBuffer buffer( &data[b] );
+		buffer.open( QIODevice::WriteOnly );
+		NifOStream stream( this, &buffer );
+
+		if ( !save( root->child( b + 1 ), stream ) )
+			failed->testAndSetRelaxed( -1, b );
+	}
+}
+
 bool NifModel::save( QIODevice & device ) const
 {
-	NifOStream stream( this, &device );
+	NifModel * mdl = const_cast<NifModel *>(this);
+
+	// Every block has to be parsed and have its arrays sized before it is serialized
+	loadLazyBlocks();
+	mdl->updateFooter();
+
+	int numBlocks = getBlockCount();
+	NifItem * idxBlockSize = getItem( getHeaderItem(), "Block Size" );
+
+	if ( version >= 0x14020000 && idxBlockSize && !lockUpdates ) {
+		for ( int b = 0; b < numBlocks; b++ )
+			mdl->updateArrays( getBlockItem( b ), false );
+	}
+
+	// Serialize the blocks in parallel; the header takes the block sizes from the buffers
+	QVector<QByteArray> blockData( numBlocks );
+
+	QVector<quint32> sizes;
+
+	if ( idxBlockSize )
+		sizes = idxBlockSize->getArray<quint32>();
+
+	for ( int b = 0; b < numBlocks && b < sizes.count(); b++ )
+		blockData[b].reserve( sizes.at( b ) );
+
+	{
+		// below this, handing work to other threads costs more than it saves
+		const int minBlocks = 64;
+
+		QThreadPool * pool = QThreadPool::globalInstance();
+		int threads = qMin( qMax( QThread::idealThreadCount(), 1 ), numBlocks / minBlocks );
+
+		QAtomicInt next( 0 );
+		QAtomicInt failed( -1 );
+		QSemaphore done;
+
+		// messages are collected while the workers run and passed on afterwards
+		MsgMode mode = msgMode;
+		mdl->setMessageMode( CollectMessages );
 
-	// Force update header and footer prior to save
-	if ( NifModel * mdl = const_cast<NifModel *>(this) ) {
-		mdl->updateHeader();
-		mdl->updateFooter();
+		for ( int t = 1; t < threads; t++ )
+			pool->start( new BlockWriteTask( this, blockData.data(), numBlocks, &next, &failed, &done ) );
+
+		saveBlocks( blockData.data(), numBlocks, &next, &failed );
+		done.acquire( qMax( threads - 1, 0 ) );
+
+		mdl->setMessageMode( mode );
+
+		if ( mode == EmitMessages ) {
+			for ( const Message & m : getMessages() )
+				msg( m );
+		}
+
+		if ( failed.load() >= 0 ) {
+			int b = failed.load();
+			msg( Message() << tr( "failed to write block %1(%2)" ).arg( itemName( index( b + 1, 0 ) ) ).arg( b ) );
+			return false;
+		}
 	}
 
+	mdl->updateHeader( &blockData );
+
+	// the file is assembled in memory and handed to the device in one write
+	QByteArray file;
+	int fileSize = 0;
+
+	for ( const QByteArray & data : blockData )
+		fileSize += data.size();
+
+	file.reserve( fileSize + 64 * rowCount( QModelIndex() ) );
+
+	QBuffer buffer( &file );
+	buffer.open( QIODevice::WriteOnly );
+	NifOStream stream( this, &buffer );
+
 	emit sigProgress( 0, rowCount( QModelIndex() ) );
 
 	for ( int c = 0; c < rowCount( QModelIndex() ); c++ ) {
@@ -1947,30 +2280,34 @@ bool NifModel::save( QIODevice & device ) const
 			if ( version > 0x0a000000 ) {
 				if ( version < 0x0a020000 ) {
 					int null = 0;
-					device.write( (char *)&null, 4 );
+					buffer.write( (char *)&null, 4 );
 				}
 			} else {
 				if ( version < 0x0303000d ) {
 					if ( rootLinks.contains( c - 1 ) ) {
 						QString string = "Top Level Object";
 						int len = string.length();
-						device.write( (char *)&len, 4 );
-						device.write( string.toLatin1().constData(), len );
+						buffer.write( (char *)&len, 4 );
+						buffer.write( string.toLatin1().constData(), len );
 					}
 				}
 
 				QString string = itemName( index( c, 0 ) );
 				int len = string.length();
-				device.write( (char *)&len, 4 );
-				device.write( string.toLatin1().constData(), len );
+				buffer.write( (char *)&len, 4 );
+				buffer.write( string.toLatin1().constData(), len );
 
 				if ( version < 0x0303000d ) {
-					device.write( (char *)&c, 4 );
+					buffer.write( (char *)&c, 4 );
 				}
 			}
 		}
 
-		if ( !save( root->child( c ), stream ) ) {
+		if ( c > 0 && c <= numBlocks ) {
+			buffer.write( blockData.at( c - 1 ) );
+			// the block is in the file now; do not hold it twice
+			blockData[c - 1] = QByteArray();
+		} else if ( !save( root->child( c ), stream ) ) {
 			msg( Message() << tr( "failed to write block %1(%2)" ).arg( itemName( index( c, 0 ) ) ).arg( c - 1 ) );
 			return false;
 		}
@@ -1979,8 +2316,13 @@ bool NifModel::save( QIODevice & device ) const
 	if ( version < 0x0303000d ) {
 		QString string = "End Of File";
 		int len = string.length();
-		device.write( (char *)&len, 4 );
-		device.write( string.toLatin1().constData(), len );
+		buffer.write( (char *)&len, 4 );
+		buffer.write( string.toLatin1().constData(), len );
+	}
+
+	if ( device.write( file ) != file.size() ) {
+		msg( Message() << tr( "failed to write the file" ) );
+		return false;
 	}
 
 	return true;
@@ -2143,6 +2485,13 @@ int NifModel::blockSize( NifItem * parent, NifSStream & stream ) const
 	if ( !parent )
 		return 0;
 
+	if ( parent->isPacked() ) {
+		for ( int r = 0; r < parent->childCount(); r++ )
+			size += stream.size( parent->packedValue( r ) );
+
+		return size;
+	}
+
 	for ( int row = 0; row < parent->childCount(); row++ ) {
 		NifItem * child = parent->child( row );
 
@@ -2178,6 +2527,19 @@ bool NifModel::load( NifItem * parent, NifIStream & stream, bool fast )
 	if ( !parent )
 		return false;
 
+	if ( parent->isPacked() ) {
+		for ( int r = 0; r < parent->childCount(); r++ ) {
+			NifValue value = parent->packedValue( r );
+
+			if ( !stream.read( value ) )
+				return false;
+
+			parent->setPackedValue( r, value );
+		}
+
+		return true;
+	}
+
 	for ( int row = 0; row < parent->childCount(); row++ ) {
 		NifItem * child = parent->child( row );
 
@@ -2215,11 +2577,92 @@ bool NifModel::load( NifItem * parent, NifIStream & stream, bool fast )
 	return true;
 }
 
+void NifModel::loadLazyBlock( NifItem * branch ) const
+{
+	if ( lazyBlocks.isEmpty() || lazyHolds )
+		return;
+
+	auto it = lazyBlocks.find( branch );
+
+	if ( it == lazyBlocks.end() )
+		return;
+
+	LazyBlock lazy = it.value();
+	lazyBlocks.erase( it );
+
+	NifModel * self = const_cast<NifModel *>( this );
+	NifBlock * block = schema->blocks.value( branch->name() );
+
+	if ( block && block->fieldCount > 0 ) {
+		// the views saw the block without rows; it gets one per field, see NifBlock::fieldCount
+		self->beginInsertRows( createIndex( branch->row(), 0, branch ), 0, block->fieldCount - 1 );
+
+		if ( !block->ancestor.isEmpty() )
+			self->insertAncestor( branch, block->ancestor );
+
+		branch->prepareInsert( block->types.count() );
+
+		for ( const NifData& data : block->types ) {
+			self->insertType( branch, data );
+		}
+
+		QBuffer buffer;
+		buffer.setData( lazyData );
+		buffer.open( QIODevice::ReadOnly );
+		buffer.seek( lazy.offset );
+
+		NifIStream stream( self, &buffer );
+
+		if ( !self->load( branch, stream, true ) )
+			msg( Message() << tr( "failed to load block number %1 (%2)" ).arg( getBlockNumber( branch ) ).arg( branch->name() ) );
+		else if ( stream.pos() != lazy.offset + lazy.size )
+			msg( Message() << tr( "device position incorrect after block number %1 (%2) at 0x%3 ended at 0x%4 (expected 0x%5)" ).arg( getBlockNumber( branch ) ).arg( branch->name() ).arg( QString::number( lazy.offset, 16 ) ).arg( QString::number( stream.pos(), 16 ) ).arg( QString::number( lazy.offset + lazy.size, 16 ) ).toLatin1() );
+
+		self->endInsertRows();
+	}
+
+	// the file is no longer needed once every block has been parsed
+	if ( lazyBlocks.isEmpty() ) {
+		lazyData.clear();
+		lazyFile.reset();
+	}
+
+	// the link tables so far hold the links of the parsed blocks only; add this one's
+	self->updateLinks( getBlockNumber( branch ) );
+
+	if ( !lockUpdates )
+		emit self->linksChanged();
+}
+
+void NifModel::loadLazyBlocks() const
+{
+	if ( lazyBlocks.isEmpty() )
+		return;
+
+	// rebuild the link tables once rather than once per block
+	NifModel * self = const_cast<NifModel *>( this );
+	bool held = self->holdUpdates( true );
+
+	while ( !lazyBlocks.isEmpty() )
+		loadLazyBlock( lazyBlocks.constBegin().key() );
+
+	self->holdUpdates( held );
+}
+
 bool NifModel::save( NifItem * parent, NifOStream & stream ) const
 {
 	if ( !parent )
 		return false;
 
+	if ( parent->isPacked() ) {
+		for ( int r = 0; r < parent->childCount(); r++ ) {
+			if ( !stream.write( parent->packedValue( r ) ) )
+				return false;
+		}
+
+		return true;
+	}
+
 	for ( int row = 0; row < parent->childCount(); row++ ) {
 		NifItem * child = parent->child( row );
 
@@ -2257,6 +2700,14 @@ bool NifModel::fileOffset( NifItem * parent, NifItem * target, NifSStream & stre
 	if ( parent == target )
 		return true;
 
+	// the target cannot be a row of a packed array, those have no items
+	if ( parent->isPacked() ) {
+		for ( int r = 0; r < parent->childCount(); r++ )
+			ofs += stream.size( parent->packedValue( r ) );
+
+		return false;
+	}
+
 	for ( int row = 0; row < parent->childCount(); row++ ) {
 		NifItem * child = parent->child( row );
 
@@ -2294,44 +2745,69 @@ void NifModel::updateLinks( int block )
 		return;
 	}
 
-	if ( block >= 0 ) {
+	int n = getBlockCount();
+
+	// A link left out to break a cycle comes back once another block on the cycle
+	// no longer closes it; that block may be any of them, so then rebuild everything
+	if ( block >= 0 && block < n && !prunedLinks && linkRefs.count() == n ) {
+		// only the links of this block changed; the rest of the tables stay valid
+		for ( const auto c : childLinks.value( block ) ) {
+			if ( c >= 0 && c < n )
+				linkRefs[c]--;
+		}
+
 		childLinks[ block ].clear();
 		parentLinks[ block ].clear();
 		updateLinks( block, getBlockItem( block ) );
+
+		// only the new links can close a cycle, and only through this block
+		QSet<int> unreaching;
+		QList<int> & children = childLinks[ block ];
+
+		for ( int i = 0; i < children.count(); ) {
+			if ( linkReaches( children.at( i ), block, unreaching ) ) {
+				msg( Message() << tr( "infinite recursive link construct detected %1 -> %2" ).arg( block ).arg( children.at( i ) ) );
+				children.removeAt( i );
+				prunedLinks = true;
+			} else {
+				i++;
+			}
+		}
+
+		for ( const auto c : children ) {
+			if ( c >= 0 && c < n )
+				linkRefs[c]++;
+		}
+
+		updateRootLinks();
 	} else {
-		rootLinks.clear();
 		childLinks.clear();
 		parentLinks.clear();
+		prunedLinks = false;
 
-		for ( int c = 0; c < getBlockCount(); c++ )
-			updateLinks( c );
-
-		for ( int c = 0; c < getBlockCount(); c++ ) {
-			QStack<int> stack;
-			checkLinks( c, stack );
-		}
+		// deferred blocks have no rows yet, so they add their links once they are parsed
+		for ( int c = 0; c < n; c++ )
+			updateLinks( c, root->child( c + 1 ) );
 
+		checkLinks();
 
-		int n = getBlockCount();
-		QByteArray hasrefs( n, 0 );
+		linkRefs.fill( 0, n );
 
 		for ( int c = 0; c < n; c++ ) {
 			for ( const auto d : childLinks.value( c ) ) {
 				if ( d >= 0 && d < n )
-					hasrefs[d] = 1;
+					linkRefs[d]++;
 			}
 		}
 
-		for ( int c = 0; c < n; c++ ) {
-			if ( !hasrefs[c] )
-				rootLinks.append( c );
-		}
+		updateRootLinks();
 	}
 }
 
 void NifModel::updateLinks( int block, NifItem * parent )
 {
-	if ( !parent )
+	// packed arrays hold no links
+	if ( !parent || parent->isPacked() )
 		return;
 
 	for ( int r = 0; r < parent->childCount(); r++ ) {
@@ -2358,25 +2834,113 @@ void NifModel::updateLinks( int block, NifItem * parent )
 	}
 }
 
-void NifModel::checkLinks( int block, QStack<int> & parents )
+void NifModel::updateRootLinks()
 {
-	parents.push( block );
-	foreach ( const auto child, childLinks.value( block ) ) {
-		if ( parents.contains( child ) ) {
-			msg( Message() << tr( "infinite recursive link construct detected %1 -> %2" ).arg( block ).arg( child ) );
-			childLinks[block].removeAll( child );
-		} else {
-			checkLinks( child, parents );
+	rootLinks.clear();
+
+	// Links from deferred blocks are not known yet, so any block might still have
+	// a parent; until every block is parsed the roots are the ones in the footer
+	if ( !lazyBlocks.isEmpty() ) {
+		NifItem * footer = getFooterItem();
+		NifItem * links = footer ? getItem( footer, "Roots" ) : nullptr;
+
+		for ( int r = 0; links && r < links->childCount(); r++ ) {
+			int l = links->child( r )->value().toLink();
+
+			if ( l >= 0 && l < linkRefs.count() && !rootLinks.contains( l ) )
+				rootLinks.append( l );
+		}
+
+		if ( !rootLinks.isEmpty() )
+			return;
+	}
+
+	for ( int c = 0; c < linkRefs.count(); c++ ) {
+		if ( !linkRefs.at( c ) )
+			rootLinks.append( c );
+	}
+}
+
+void NifModel::checkLinks()
+{
+	int n = getBlockCount();
+
+	// depth first, each block once: 0 = not visited, 1 = on the current path, 2 = done
+	QByteArray state( n, 0 );
+	QStack<QPair<int, int>> path;
+
+	for ( int c = 0; c < n; c++ ) {
+		if ( state.at( c ) )
+			continue;
+
+		state[c] = 1;
+		path.push( { c, 0 } );
+
+		while ( !path.isEmpty() ) {
+			int block = path.top().first;
+			int next = path.top().second;
+
+			auto it = childLinks.find( block );
+
+			if ( it == childLinks.end() || next >= it.value().count() ) {
+				state[block] = 2;
+				path.pop();
+				continue;
+			}
+
+			int child = it.value().at( next );
+
+			if ( child < 0 || child >= n || state.at( child ) == 2 ) {
+				path.top().second++;
+			} else if ( state.at( child ) == 1 ) {
+				msg( Message() << tr( "infinite recursive link construct detected %1 -> %2" ).arg( block ).arg( child ) );
+				it.value().removeAt( next );
+				prunedLinks = true;
+			} else {
+				path.top().second++;
+				state[child] = 1;
+				path.push( { child, 0 } );
+			}
+		}
+	}
+}
+
+bool NifModel::linkReaches( int from, int block, QSet<int> & unreaching ) const
+{
+	if ( from == block )
+		return true;
+
+	// blocks found not to lead to block stay that way while only its links change
+	QSet<int> visited;
+	QStack<int> stack;
+	stack.push( from );
+	visited.insert( from );
+
+	while ( !stack.isEmpty() ) {
+		for ( const auto child : childLinks.value( stack.pop() ) ) {
+			if ( child == block )
+				return true;
+
+			if ( !unreaching.contains( child ) && !visited.contains( child ) ) {
+				visited.insert( child );
+				stack.push( child );
+			}
 		}
 	}
-	parents.pop();
+
+	unreaching.unite( visited );
+	return false;
 }
 
 void NifModel::adjustLinks( NifItem * parent, int block, int delta )
 {
-	if ( !parent )
+	if ( !parent || parent->isPacked() )
 		return;
 
+	// links in deferred blocks have to be renumbered too
+	if ( parent == root )
+		loadLazyBlocks();
+
 	if ( parent->childCount() > 0 ) {
 		for ( int c = 0; c < parent->childCount(); c++ )
 			adjustLinks( parent->child( c ), block, delta );
@@ -2394,9 +2958,13 @@ void NifModel::adjustLinks( NifItem * parent, int block, int delta )
 
 void NifModel::mapLinks( NifItem * parent, const QMap<qint32, qint32> & map )
 {
-	if ( !parent )
+	if ( !parent || parent->isPacked() )
 		return;
 
+	// links in deferred blocks have to be renumbered too
+	if ( parent == root )
+		loadLazyBlocks();
+
 	if ( parent->childCount() > 0 ) {
 		for ( int c = 0; c < parent->childCount(); c++ )
 			mapLinks( parent->child( c ), map );
@@ -2468,15 +3036,20 @@ bool NifModel::setLink( const QModelIndex & parent, const QString & name, qint32
 
 	NifItem * item = getItem( parentItem, name );
 
-	if ( item && item->value().setLink( l ) ) {
-		emit dataChanged( createIndex( item->row(), ValueCol, item ), createIndex( item->row(), ValueCol, item ) );
+	if ( !item )
+		return false;
+
+	itemEditing( item );
+
+	if ( item->value().setLink( l ) ) {
+		itemChanged( item );
 		NifItem * parent = item;
 
 		while ( parent->parent() && parent->parent() != root )
 			parent = parent->parent();
 
 		if ( parent != getFooterItem() ) {
-			updateLinks();
+			updateLinks( getBlockNumber( parent ) );
 			updateFooter();
 			emit linksChanged();
 		}
@@ -2494,15 +3067,17 @@ bool NifModel::setLink( const QModelIndex & index, qint32 l )
 	if ( !( index.isValid() && item && index.model() == this ) )
 		return false;
 
-	if ( item && item->value().setLink( l ) ) {
-		emit dataChanged( createIndex( item->row(), ValueCol, item ), createIndex( item->row(), ValueCol, item ) );
+	itemEditing( item );
+
+	if ( item->value().setLink( l ) ) {
+		itemChanged( item );
 		NifItem * parent = item;
 
 		while ( parent->parent() && parent->parent() != root )
 			parent = parent->parent();
 
 		if ( parent != getFooterItem() ) {
-			updateLinks();
+			updateLinks( getBlockNumber( parent ) );
 			updateFooter();
 			emit linksChanged();
 		}
@@ -2519,6 +3094,7 @@ bool NifModel::setLinkArray( const QModelIndex & iArray, const QVector<qint32> &
 
 	if ( isArray( iArray ) && item && iArray.model() == this ) {
 		bool ret = true;
+		childrenEditing( item );
 
 		for ( int c = 0; c < item->childCount() && c < links.count(); c++ ) {
 			ret &= item->child( c )->value().setLink( links[c] );
@@ -2528,7 +3104,7 @@ bool NifModel::setLinkArray( const QModelIndex & iArray, const QVector<qint32> &
 		int x = item->childCount() - 1;
 
 		if ( x >= 0 )
-			emit dataChanged( createIndex( 0, ValueCol, item->child( 0 ) ), createIndex( x, ValueCol, item->child( x ) ) );
+			itemsChanged( item->child( 0 ), item->child( x ) );
 
 		NifItem * parent = item;
 
@@ -2536,7 +3112,7 @@ bool NifModel::setLinkArray( const QModelIndex & iArray, const QVector<qint32> &
 			parent = parent->parent();
 
 		if ( parent != getFooterItem() ) {
-			updateLinks();
+			updateLinks( getBlockNumber( parent ) );
 			updateFooter();
 			emit linksChanged();
 		}
@@ -2733,16 +3309,19 @@ void NifModel::convertNiBlock( const QString & identifier, const QModelIndex & i
 	}
 
 	NifItem * branch = static_cast<NifItem *>( index.internalPointer() );
-	NifBlock * srcBlock = blocks.value( btype );
-	NifBlock * dstBlock = blocks.value( identifier );
+	loadLazyBlock( branch );
+	NifBlock * srcBlock = schema->blocks.value( btype );
+	NifBlock * dstBlock = schema->blocks.value( identifier );
 
 	if ( srcBlock && dstBlock && branch ) {
 		branch->setName( identifier );
+		branch->setBlockType( dstBlock->typeId );
+		branch->setLayout( dstBlock );
 
 		if ( inherits( btype, identifier ) ) {
 			// Remove any level between the two types
 			for ( QString ancestor = btype; !ancestor.isNull() && ancestor != identifier; ) {
-				NifBlock * block = blocks.value( ancestor );
+				NifBlock * block = schema->blocks.value( ancestor );
 
 				if ( !block )
 					break;
@@ -2759,7 +3338,7 @@ void NifModel::convertNiBlock( const QString & identifier, const QModelIndex & i
 			QStringList types;
 
 			for ( QString ancestor = identifier; !ancestor.isNull() && ancestor != btype; ) {
-				NifBlock * block = blocks.value( ancestor );
+				NifBlock * block = schema->blocks.value( ancestor );
 
 				if ( !block )
 					break;
@@ -2769,7 +3348,7 @@ void NifModel::convertNiBlock( const QString & identifier, const QModelIndex & i
 			}
 
 			for ( const QString& ancestor : types ) {
-				NifBlock * block = blocks.value( ancestor );
+				NifBlock * block = schema->blocks.value( ancestor );
 
 				if ( !block )
 					break;
@@ -2814,6 +3393,20 @@ bool NifModel::holdUpdates( bool value )
 	return retval;
 }
 
+void NifModel::editsBegun()
+{
+	editHeldUpdates = holdUpdates( true );
+}
+
+void NifModel::editsEnded( bool rolledBack )
+{
+	// restored links and strings were never passed through the incremental updates
+	if ( rolledBack )
+		needUpdates = utAll;
+
+	holdUpdates( editHeldUpdates );
+}
+
 void NifModel::updateModel( UpdateType value )
 {
 	if ( value & utHeader )
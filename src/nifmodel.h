@@ -35,13 +35,60 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "basemodel.h" // Inherited
 
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QFile>
 #include <QHash>
 #include <QReadWriteLock>
+#include <QSet>
+#include <QSharedPointer>
 #include <QStack>
 #include <QStringList>
 
 
-//! \file nifmodel.h NifModel
+//! \file nifmodel.h NifModel, NifSchema
+
+//! The block and compound descriptions parsed from nif.xml.
+/**
+ * A schema is never modified once NifModel::loadXML() has published it, so
+ * any number of threads can read it without locking. Reloading the XML
+ * publishes a new schema; each model holds a reference to the one it was
+ * cleared with, and a schema is deleted once nothing refers to it.
+ */
+class NifSchema final
+{
+public:
+	NifSchema();
+	~NifSchema() { qDeleteAll( compounds ); qDeleteAll( blocks ); }
+
+	//! Distinguishes the schemas published in a process, see NifFieldKey
+	quint32 serial;
+
+	QList<quint32> supportedVersions;
+
+	QHash<QString, NifBlock *> compounds;
+	QHash<QString, NifBlock *> blocks;
+
+	//! Blocks indexed by NifBlock::typeId
+	QVector<NifBlock *> blockTypes;
+
+	//! The compiled conditions and array sizes of the fields, by source
+	QHash<QString, Expression> expressions;
+
+	//! Returns \a source compiled; only compiles it if the schema does not contain it
+	Expression expression( const QString & source ) const;
+	//! Compiles \a source into expressions, unless it is already there; only while the schema is built
+	Expression addExpression( const QString & source );
+
+	//! The field names, by id; see NifFieldKey and NifBlock::fieldRows
+	QHash<QString, int> fieldIds;
+
+	//! Returns the id of a field name, assigning a new one if it was not seen before; only while the schema is built
+	int internField( const QString & name );
+
+private:
+	Q_DISABLE_COPY( NifSchema )
+};
 
 //! Base class for nif models.
 class NifModel final : public BaseModel
@@ -56,7 +103,7 @@ public:
 	//! Find and parse the XML file
 	static bool loadXML();
 
-	// when creating NifModels from outside the main thread protect them with a QReadLocker (see the XML check spell for an example)
+	// serializes loadXML(); models do not need to lock it, see NifSchema
 	static QReadWriteLock XMLlock;
 
 	// clear model data; implements BaseModel
@@ -113,6 +160,8 @@ public:
 	QModelIndex insertNiBlock( const QString & identifier, int row = -1, bool fast = false );
 	//! Remove a block from the list
 	void removeNiBlock( int blocknum );
+	//! Remove the blocks in the keys of \a map, redirecting links to each to the block it maps to
+	void mergeNiBlocks( const QMap<qint32, qint32> & map );
 	//! Move a block in the list
 	void moveNiBlock( int src, int dst );
 	//! Return the block name
@@ -145,9 +194,9 @@ public:
 	 */
 	bool isNiBlock( const QModelIndex & index, const QString & name = QString() ) const;
 	//! Returns a list with all known NiXXX ids (<niobject abstract="0">)
-	static QStringList allNiBlocks();
+	QStringList allNiBlocks() const;
 	//! Determine if a value is a NiBlock identifier (<niobject abstract="0">).
-	static bool isNiBlock( const QString & name );
+	bool isNiBlock( const QString & name ) const;
 	//! Reorders the blocks according to a list of new block numbers
 	void reorderBlocks( const QVector<qint32> & order );
 	//! Moves all niblocks from this nif to another nif, returns a map which maps old block numbers to new block numbers
@@ -185,9 +234,9 @@ public:
 	void mapLinks( const QMap<qint32, qint32> & map );
 
 	//! Is name a compound type?
-	static bool isCompound( const QString & name );
+	bool isCompound( const QString & name ) const;
 	//! Is name an ancestor identifier (<niobject abstract="1">)?
-	static bool isAncestor( const QString & name );
+	bool isAncestor( const QString & name ) const;
 	//! Is name a NiBlock identifier (<niobject abstract="0"> or <niobject abstract="1">)?
 	bool isAncestorOrNiBlock( const QString & name ) const override final;                // virtual so not static
 	//! Returns true if name inherits ancestor.
@@ -196,7 +245,7 @@ public:
 	bool inherits( const QModelIndex & index, const QString & ancestor ) const;
 
 	// is this version supported ?
-	static bool isVersionSupported( quint32 );
+	bool isVersionSupported( quint32 ) const;
 
 	// version conversion
 	static QString version2string( quint32 );
@@ -212,6 +261,11 @@ public:
 	// QAbstractModel interface
 	QVariant data( const QModelIndex & index, int role = Qt::DisplayRole ) const override final;
 	bool setData( const QModelIndex & index, const QVariant & value, int role = Qt::EditRole ) override final;
+	bool hasChildren( const QModelIndex & parent = QModelIndex() ) const override final;
+	//! Whether \a parent is a block whose parsing was deferred by load(), or a packed array
+	bool canFetchMore( const QModelIndex & parent ) const override final;
+	//! Parses the deferred block \a parent, announcing its rows to the views, or unpacks a packed array
+	void fetchMore( const QModelIndex & parent ) override final;
 	//! Resets the model to its original state in any attached views.
 	void reset();
 
@@ -232,6 +286,9 @@ public:
 	template <typename T> T get( const QModelIndex & parent, const QString & name ) const;
 	template <typename T> bool set( const QModelIndex & parent, const QString & name, const T & v );
 
+	template <typename T> T get( const QModelIndex & parent, const NifFieldKey & key ) const;
+	template <typename T> bool set( const QModelIndex & parent, const NifFieldKey & key, const T & v );
+
 
 	static QAbstractItemDelegate * createDelegate( class SpellBook * );
 
@@ -244,17 +301,25 @@ protected:
 	void insertType( NifItem * parent, const NifData & data, int row = -1 );
 	NifItem * insertBranch( NifItem * parent, const NifData & data, int row = -1 );
 
+	//! Prefixes the array size \a x of a row of a multidimensional array with "../", unless it is a number
+	static QString parentPrefix( const QString & x );
+
 	bool updateArrayItem( NifItem * array, bool fast ) override final;
 	bool updateByteArrayItem( NifItem * array, bool fast );
 	bool updateArrays( NifItem * parent, bool fast );
+	//! Update the header, taking the block sizes from blocks already serialized into \a blockData if given
+	void updateHeader( const QVector<QByteArray> * blockData );
 
 	NifItem * getHeaderItem() const;
 	NifItem * getFooterItem() const;
 	NifItem * getBlockItem( int ) const;
 	NifItem * getItem( NifItem * parent, const QString & name ) const override final;
+	using BaseModel::getItem;
 
 	bool load( NifItem * parent, NifIStream & stream, bool fast = true );
 	bool save( NifItem * parent, NifOStream & stream ) const;
+	//! Serialize blocks into data, taking block numbers from next until count; the first failure is stored in failed
+	void saveBlocks( QByteArray * data, int count, QAtomicInt * next, QAtomicInt * failed ) const;
 	bool fileOffset( NifItem * parent, NifItem * target, NifSStream & stream, int & ofs ) const;
 
 	bool setItemValue( NifItem * item, const NifValue & v ) override final;
@@ -264,6 +329,12 @@ protected:
 
 	bool setHeaderString( const QString & ) override final;
 
+	void editsBegun() override final;
+	void editsEnded( bool rolledBack ) override final;
+
+	//! Parses a deferred block before its fields are looked up, e.g. through get() on an index from index()
+	void childrenNeeded( NifItem * parent ) const override final { loadLazyBlock( parent ); }
+
 	QString ver2str( quint32 v ) const override final { return version2string( v ); }
 	quint32 str2ver( QString s ) const override final { return version2number( s ); }
 
@@ -275,8 +346,14 @@ protected:
 	QHash<int, QList<int> > childLinks;
 	QHash<int, QList<int> > parentLinks;
 	QList<int> rootLinks;
+	//! Number of blocks linking to each block as a child
+	QVector<int> linkRefs;
+	//! Whether child links closing a cycle were left out of childLinks; only a full rebuild restores them
+	bool prunedLinks;
 
 	bool lockUpdates;
+	//! The holdUpdates() state before the current batch of edits
+	bool editHeldUpdates;
 
 	enum UpdateType
 	{
@@ -288,22 +365,53 @@ protected:
 	};
 	UpdateType needUpdates;
 
+	//! Rebuild the link tables, or update them after the links of \a block changed
 	void updateLinks( int block = -1 );
 	void updateLinks( int block, NifItem * parent );
-	void checkLinks( int block, QStack<int> & parents );
+	//! Rebuild rootLinks from linkRefs
+	void updateRootLinks();
+	//! Remove the child links closing a cycle
+	void checkLinks();
+	//! Whether \a block can be reached from \a from through child links; \a unreaching caches blocks that cannot
+	bool linkReaches( int from, int block, QSet<int> & unreaching ) const;
 	void adjustLinks( NifItem * parent, int block, int delta );
 	void mapLinks( NifItem * parent, const QMap<qint32, qint32> & map );
 	void updateModel( UpdateType value = utAll );
 
+	//! Location of a block whose parsing was deferred by load()
+	struct LazyBlock
+	{
+		qint64 offset;
+		quint32 size;
+	};
+	//! Blocks that have not been parsed yet, see Options::lazyBlockLoading()
+	mutable QHash<NifItem *, LazyBlock> lazyBlocks;
+	//! The file contents that lazy blocks are parsed from
+	mutable QByteArray lazyData;
+	//! The file mapped into lazyData, if any
+	mutable QSharedPointer<QFile> lazyFile;
+	//! While nonzero deferred blocks are not parsed, so that data() has no side effects
+	mutable int lazyHolds;
+
+	//! Parses \a block if its parsing was deferred by load() and adds its links to the link tables
+	void loadLazyBlock( NifItem * block ) const;
+	//! Parses all blocks whose parsing was deferred by load()
+	void loadLazyBlocks() const;
+	//! Implements data() while lazyHolds is raised
+	QVariant itemData( const QModelIndex & index, int role ) const;
+
 	static void updateStrings( NifModel * src, NifModel * tgt, NifItem * item );
 	bool assignString( NifItem * parent, const QString & string, bool replace = false );
 
 
 	// XML structures
-	static QList<quint32> supportedVersions;
+	//! The schema this model was last cleared with
+	QSharedPointer<const NifSchema> schema;
 
-	static QHash<QString, NifBlock *> compounds;
-	static QHash<QString, NifBlock *> blocks;
+	//! The most recently published schema; guarded by XMLlock
+	static QSharedPointer<const NifSchema> publishedSchema;
+	//! Returns the most recently published schema; never null
+	static QSharedPointer<const NifSchema> activeSchema();
 
 	//! Parse the XML file using a NifXmlHandler
 	static QString parseXmlDescription( const QString & filename );
@@ -317,13 +425,14 @@ protected:
 	friend class NifXmlHandler;
 	friend class NifModelEval;
 	friend class NifOStream;
+	friend class BlockWriteTask;
 }; // class NifModel
 
 
-inline QStringList NifModel::allNiBlocks()
+inline QStringList NifModel::allNiBlocks() const
 {
 	QStringList lst;
-	for ( NifBlock * blk : blocks ) {
+	for ( NifBlock * blk : schema->blocks ) {
 		if ( !blk->abstract )
 			lst.append( blk->id );
 	}
@@ -332,29 +441,29 @@ inline QStringList NifModel::allNiBlocks()
 
 inline bool NifModel::isAncestorOrNiBlock( const QString & name ) const
 {
-	return blocks.contains( name );
+	return schema->blocks.contains( name );
 }
 
-inline bool NifModel::isNiBlock( const QString & name )
+inline bool NifModel::isNiBlock( const QString & name ) const
 {
-	NifBlock * blk = blocks.value( name );
+	NifBlock * blk = schema->blocks.value( name );
 	return blk && !blk->abstract;
 }
 
-inline bool NifModel::isAncestor( const QString & name )
+inline bool NifModel::isAncestor( const QString & name ) const
 {
-	NifBlock * blk = blocks.value( name );
+	NifBlock * blk = schema->blocks.value( name );
 	return blk && blk->abstract;
 }
 
-inline bool NifModel::isCompound( const QString & name )
+inline bool NifModel::isCompound( const QString & name ) const
 {
-	return compounds.contains( name );
+	return schema->compounds.contains( name );
 }
 
-inline bool NifModel::isVersionSupported( quint32 v )
+inline bool NifModel::isVersionSupported( quint32 v ) const
 {
-	return supportedVersions.contains( v );
+	return schema->supportedVersions.contains( v );
 }
 
 inline QList<int> NifModel::getRootLinks() const
@@ -409,6 +518,11 @@ template <typename T> inline T NifModel::get( const QModelIndex & parent, const
 	return BaseModel::get<T>( parent, name );
 }
 
+template <typename T> inline T NifModel::get( const QModelIndex & parent, const NifFieldKey & key ) const
+{
+	return BaseModel::get<T>( parent, key );
+}
+
 template <typename T> inline bool NifModel::set( const QModelIndex & index, const T & d )
 {
 	return BaseModel::set<T>( index, d );
@@ -429,6 +543,11 @@ template <typename T> inline bool NifModel::set( NifItem * parent, const QString
 	return BaseModel::set<T>( parent, name, d );
 }
 
+template <typename T> inline bool NifModel::set( const QModelIndex & parent, const NifFieldKey & key, const T & d )
+{
+	return BaseModel::set<T>( parent, key, d );
+}
+
 
 // QString overloads for the get and set templates
 template <> inline QString NifModel::get( const QModelIndex & index ) const
@@ -449,6 +568,11 @@ template <> inline QString NifModel::get( const QModelIndex & parent, const QStr
 	return this->string( parent, name );
 }
 
+template <> inline QString NifModel::get( const QModelIndex & parent, const NifFieldKey & key ) const
+{
+	return this->string( getIndex( parent, key ) );
+}
+
 template <> inline bool NifModel::set( const QModelIndex & index, const QString & d )
 {
 	return this->assignString( index, d );
@@ -463,6 +587,11 @@ template <> inline bool NifModel::set( const QModelIndex & parent, const QString
 	return this->assignString( parent, name, d );
 }
 
+template <> inline bool NifModel::set( const QModelIndex & parent, const NifFieldKey & key, const QString & d )
+{
+	return this->assignString( getIndex( parent, key ), d );
+}
+
 //template <> inline bool NifModel::set( NifItem * parent, const QString & name, const QString & d ) {
 //	return this->assignString(parent, name, d);
 //}
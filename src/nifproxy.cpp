@@ -360,6 +360,17 @@ int NifProxyModel::rowCount( const QModelIndex & parent ) const
 	return ( parentItem ? parentItem->childCount() : 0 );
 }
 
+bool NifProxyModel::canFetchMore( const QModelIndex & index ) const
+{
+	return nif && index.isValid() && nif->canFetchMore( mapTo( index ) );
+}
+
+void NifProxyModel::fetchMore( const QModelIndex & index )
+{
+	if ( nif && index.isValid() )
+		nif->fetchMore( mapTo( index ) );
+}
+
 QModelIndex NifProxyModel::index( int row, int column, const QModelIndex & parent ) const
 {
 	NifProxyItem * parentItem;
@@ -406,12 +417,11 @@ QModelIndex NifProxyModel::mapTo( const QModelIndex & idx ) const
 	if ( !item )
 		return QModelIndex();
 
-	QModelIndex nifidx = nif->getBlock( item->block() );
-
-	if ( nifidx.isValid() )
-		nifidx = nifidx.sibling( nifidx.row(), ( idx.column() ? NifModel::ValueCol : NifModel::NameCol ) );
+	if ( item->block() < 0 || item->block() >= nif->getBlockCount() )
+		return QModelIndex();
 
-	return nifidx;
+	// not getBlock(), which would parse a deferred block whenever a row of it is painted
+	return nif->index( item->block() + 1, ( idx.column() ? NifModel::ValueCol : NifModel::NameCol ) );
 }
 
 QModelIndex NifProxyModel::mapFrom( const QModelIndex & idx, const QModelIndex & ref ) const
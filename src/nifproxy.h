@@ -62,7 +62,12 @@ public:
 	int rowCount( const QModelIndex & index ) const override final;
 
 	bool hasChildren( const QModelIndex & index ) const override final
-	{ return rowCount( index ) > 0; }
+	{ return rowCount( index ) > 0 || canFetchMore( index ); }
+
+	//! Whether the block of \a index is not parsed yet, so its links are not known
+	bool canFetchMore( const QModelIndex & index ) const override final;
+	//! Parses the block of \a index; its links arrive through xLinksChanged()
+	void fetchMore( const QModelIndex & index ) override final;
 
 	QVariant data( const QModelIndex & index, int role ) const override final;
 	bool setData( const QModelIndex & index, const QVariant & v, int role ) override final;
@@ -34,6 +34,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "version.h"
 #include "options.h"
 
+#include "batch.h"
+
 #include "glview.h"
 #include "kfmmodel.h"
 #include "nifmodel.h"
@@ -1226,6 +1228,14 @@ QString NifSkope::getLoadFileName()
 //! The main program
 int main( int argc, char * argv[] )
 {
+	bool batch = BatchProcessor::isBatch( argc, argv );
+
+#ifdef Q_OS_LINUX
+	// batch mode must not need a display
+	if ( batch && qEnvironmentVariableIsEmpty( "QT_QPA_PLATFORM" ) )
+		qputenv( "QT_QPA_PLATFORM", "offscreen" );
+#endif
+
 	// set up the Qt Application
 	QApplication app( argc, argv );
 	app.setOrganizationName( "NifTools" );
@@ -1237,7 +1247,9 @@ int main( int argc, char * argv[] )
 	// install message handler
 	qRegisterMetaType<Message>( "Message" );
 #ifdef QT_NO_DEBUG
-	qInstallMessageHandler( myMessageOutput );
+	// the handler opens windows, which batch mode must not do from its worker threads
+	if ( !batch )
+		qInstallMessageHandler( myMessageOutput );
 #endif
 
 	// if there is a style sheet present then load it
@@ -1274,6 +1286,9 @@ int main( int argc, char * argv[] )
 	NifModel::loadXML();
 	KfmModel::loadXML();
 
+	if ( batch )
+		return BatchProcessor().exec( app.arguments() );
+
 	QStack<QString> fnames;
 	bool reuseSession = true;
 
@@ -36,9 +36,14 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "nifmodel.h"
 
-#include <QDataStream>
+#include <QBuffer>
+#include <QFileDevice>
 #include <QIODevice>
 #include <QSettings>
+#include <QtEndian>
+
+#include <cstring>
+#include <new>
 
 
 //! \file nifvalue.cpp NifValue, NifIStream, NifOStream, NifSStream
@@ -332,25 +337,12 @@ NifValue::~NifValue()
 void NifValue::clear()
 {
 	switch ( typ ) {
-	case tVector4:
-		delete static_cast<Vector3 *>( val.data );
-		break;
-	case tVector3:
-		delete static_cast<Vector3 *>( val.data );
-		break;
-	case tVector2:
-		delete static_cast<Vector2 *>( val.data );
-		break;
 	case tMatrix:
 		delete static_cast<Matrix *>( val.data );
 		break;
 	case tMatrix4:
 		delete static_cast<Matrix4 *>( val.data );
 		break;
-	case tQuat:
-	case tQuatXYZW:
-		delete static_cast<Quat *>( val.data );
-		break;
 	case tByteMatrix:
 		delete static_cast<ByteMatrix *>( val.data );
 		break;
@@ -358,9 +350,6 @@ void NifValue::clear()
 	case tStringPalette:
 		delete static_cast<QByteArray *>( val.data );
 		break;
-	case tTriangle:
-		delete static_cast<Triangle *>( val.data );
-		break;
 	case tString:
 	case tSizedString:
 	case tText:
@@ -370,16 +359,11 @@ void NifValue::clear()
 	case tChar8String:
 		delete static_cast<QString *>( val.data );
 		break;
-	case tColor3:
-		delete static_cast<Color3 *>( val.data );
-		break;
-	case tColor4:
-		delete static_cast<Color4 *>( val.data );
-		break;
 	case tBlob:
 		delete static_cast<QByteArray *>( val.data );
 		break;
 	default:
+		// inline types are trivially destructible
 		break;
 	}
 
@@ -401,10 +385,10 @@ void NifValue::changeType( Type t )
 		val.i32 = -1;
 		return;
 	case tVector3:
-		val.data = new Vector3();
+		new ( val.pod ) Vector3();
 		break;
 	case tVector4:
-		val.data = new Vector4();
+		new ( val.pod ) Vector4();
 		return;
 	case tMatrix:
 		val.data = new Matrix();
@@ -414,13 +398,13 @@ void NifValue::changeType( Type t )
 		return;
 	case tQuat:
 	case tQuatXYZW:
-		val.data = new Quat();
+		new ( val.pod ) Quat();
 		return;
 	case tVector2:
-		val.data = new Vector2();
+		new ( val.pod ) Vector2();
 		return;
 	case tTriangle:
-		val.data = new Triangle();
+		new ( val.pod ) Triangle();
 		return;
 	case tString:
 	case tSizedString:
@@ -432,10 +416,10 @@ void NifValue::changeType( Type t )
 		val.data = new QString();
 		return;
 	case tColor3:
-		val.data = new Color3();
+		new ( val.pod ) Color3();
 		return;
 	case tColor4:
-		val.data = new Color4();
+		new ( val.pod ) Color4();
 		return;
 	case tByteArray:
 	case tStringPalette:
@@ -464,10 +448,10 @@ void NifValue::operator=( const NifValue & other )
 
 	switch ( typ ) {
 	case tVector3:
-		*static_cast<Vector3 *>( val.data ) = *static_cast<Vector3 *>( other.val.data );
+		*static_cast<Vector3 *>( storage() ) = *static_cast<Vector3 *>( other.storage() );
 		return;
 	case tVector4:
-		*static_cast<Vector4 *>( val.data ) = *static_cast<Vector4 *>( other.val.data );
+		*static_cast<Vector4 *>( storage() ) = *static_cast<Vector4 *>( other.storage() );
 		return;
 	case tMatrix:
 		*static_cast<Matrix *>( val.data ) = *static_cast<Matrix *>( other.val.data );
@@ -477,10 +461,10 @@ void NifValue::operator=( const NifValue & other )
 		return;
 	case tQuat:
 	case tQuatXYZW:
-		*static_cast<Quat *>( val.data ) = *static_cast<Quat *>( other.val.data );
+		*static_cast<Quat *>( storage() ) = *static_cast<Quat *>( other.storage() );
 		return;
 	case tVector2:
-		*static_cast<Vector2 *>( val.data ) = *static_cast<Vector2 *>( other.val.data );
+		*static_cast<Vector2 *>( storage() ) = *static_cast<Vector2 *>( other.storage() );
 		return;
 	case tString:
 	case tSizedString:
@@ -492,10 +476,10 @@ void NifValue::operator=( const NifValue & other )
 		*static_cast<QString *>( val.data ) = *static_cast<QString *>( other.val.data );
 		return;
 	case tColor3:
-		*static_cast<Color3 *>( val.data ) = *static_cast<Color3 *>( other.val.data );
+		*static_cast<Color3 *>( storage() ) = *static_cast<Color3 *>( other.storage() );
 		return;
 	case tColor4:
-		*static_cast<Color4 *>( val.data ) = *static_cast<Color4 *>( other.val.data );
+		*static_cast<Color4 *>( storage() ) = *static_cast<Color4 *>( other.storage() );
 		return;
 	case tByteArray:
 	case tStringPalette:
@@ -505,7 +489,7 @@ void NifValue::operator=( const NifValue & other )
 		*static_cast<ByteMatrix *>( val.data ) = *static_cast<ByteMatrix *>( other.val.data );
 		return;
 	case tTriangle:
-		*static_cast<Triangle *>( val.data ) = *static_cast<Triangle *>( other.val.data );
+		*static_cast<Triangle *>( storage() ) = *static_cast<Triangle *>( other.storage() );
 		return;
 	case tBlob:
 		*static_cast<QByteArray *>( val.data ) = *static_cast<QByteArray *>( other.val.data );
@@ -516,6 +500,85 @@ void NifValue::operator=( const NifValue & other )
 	}
 }
 
+int NifValue::packedSize( Type t )
+{
+	switch ( t ) {
+	case tByte:
+		return 1;
+	case tWord:
+	case tShort:
+		return 2;
+	case tInt:
+	case tUInt:
+	case tFloat:
+		return 4;
+	case tVector2:
+		return sizeof( Vector2 );
+	case tVector3:
+		return sizeof( Vector3 );
+	case tVector4:
+		return sizeof( Vector4 );
+	case tQuat:
+	case tQuatXYZW:
+		return sizeof( Quat );
+	case tColor3:
+		return sizeof( Color3 );
+	case tColor4:
+		return sizeof( Color4 );
+	case tTriangle:
+		return sizeof( Triangle );
+	default:
+		return 0;
+	}
+}
+
+void NifValue::toPacked( char * row ) const
+{
+	// the same fields the streams read and write
+	switch ( typ ) {
+	case tByte:
+		memcpy( row, &val.u08, 1 );
+		return;
+	case tWord:
+	case tShort:
+		memcpy( row, &val.u16, 2 );
+		return;
+	case tInt:
+	case tUInt:
+	case tFloat:
+		memcpy( row, &val.u32, 4 );
+		return;
+	default:
+		if ( isInline( typ ) )
+			memcpy( row, val.pod, packedSize( typ ) );
+		return;
+	}
+}
+
+void NifValue::fromPacked( const char * row )
+{
+	switch ( typ ) {
+	case tByte:
+		val.u32 = 0;
+		memcpy( &val.u08, row, 1 );
+		return;
+	case tWord:
+	case tShort:
+		val.u32 = 0;
+		memcpy( &val.u16, row, 2 );
+		return;
+	case tInt:
+	case tUInt:
+	case tFloat:
+		memcpy( &val.u32, row, 4 );
+		return;
+	default:
+		if ( isInline( typ ) )
+			memcpy( val.pod, row, packedSize( typ ) );
+		return;
+	}
+}
+
 QVariant NifValue::toVariant() const
 {
 	QVariant v;
@@ -588,26 +651,26 @@ bool NifValue::fromString( const QString & s )
 		*static_cast<QString *>( val.data ) = s;
 		return true;
 	case tColor3:
-		static_cast<Color3 *>( val.data )->fromQColor( QColor( s ) );
+		static_cast<Color3 *>( storage() )->fromQColor( QColor( s ) );
 		return true;
 	case tColor4:
-		static_cast<Color4 *>( val.data )->fromQColor( QColor( s ) );
+		static_cast<Color4 *>( storage() )->fromQColor( QColor( s ) );
 		return true;
 	case tFileVersion:
 		val.u32 = NifModel::version2number( s );
 		return val.u32 != 0;
 	case tVector2:
-		static_cast<Vector2 *>( val.data )->fromString( s );
+		static_cast<Vector2 *>( storage() )->fromString( s );
 		return true;
 	case tVector3:
-		static_cast<Vector3 *>( val.data )->fromString( s );
+		static_cast<Vector3 *>( storage() )->fromString( s );
 		return true;
 	case tVector4:
-		static_cast<Vector4 *>( val.data )->fromString( s );
+		static_cast<Vector4 *>( storage() )->fromString( s );
 		return true;
 	case tQuat:
 	case tQuatXYZW:
-		static_cast<Quat *>( val.data )->fromString( s );
+		static_cast<Quat *>( storage() )->fromString( s );
 		return true;
 	case tByteArray:
 	case tByteMatrix:
@@ -658,7 +721,7 @@ QString NifValue::toString() const
 		return *static_cast<QString *>( val.data );
 	case tColor3:
 		{
-			Color3 * col = static_cast<Color3 *>( val.data );
+			Color3 * col = static_cast<Color3 *>( storage() );
 			return QString( "#%1%2%3" )
 			       .arg( (int)( col->red() * 0xff ),   2, 16, QChar( '0' ) )
 			       .arg( (int)( col->green() * 0xff ), 2, 16, QChar( '0' ) )
@@ -666,7 +729,7 @@ QString NifValue::toString() const
 		}
 	case tColor4:
 		{
-			Color4 * col = static_cast<Color4 *>( val.data );
+			Color4 * col = static_cast<Color4 *>( storage() );
 			return QString( "#%1%2%3%4" )
 			       .arg( (int)( col->red() * 0xff ),   2, 16, QChar( '0' ) )
 			       .arg( (int)( col->green() * 0xff ), 2, 16, QChar( '0' ) )
@@ -675,7 +738,7 @@ QString NifValue::toString() const
 		}
 	case tVector2:
 		{
-			Vector2 * v = static_cast<Vector2 *>( val.data );
+			Vector2 * v = static_cast<Vector2 *>( storage() );
 
 			return QString( "X %1 Y %2" )
 			       .arg( NumOrMinMax( (*v)[0], 'f', VECTOR_DECIMALS ) )
@@ -683,7 +746,7 @@ QString NifValue::toString() const
 		}
 	case tVector3:
 		{
-			Vector3 * v = static_cast<Vector3 *>( val.data );
+			Vector3 * v = static_cast<Vector3 *>( storage() );
 
 			return QString( "X %1 Y %2 Z %3" )
 			       .arg( NumOrMinMax( (*v)[0], 'f', VECTOR_DECIMALS ) )
@@ -692,7 +755,7 @@ QString NifValue::toString() const
 		}
 	case tVector4:
 		{
-			Vector4 * v = static_cast<Vector4 *>( val.data );
+			Vector4 * v = static_cast<Vector4 *>( storage() );
 
 			return QString( "X %1 Y %2 Z %3 W %4" )
 			       .arg( NumOrMinMax( (*v)[0], 'f', VECTOR_DECIMALS ) )
@@ -709,7 +772,7 @@ QString NifValue::toString() const
 			if ( typ == tMatrix )
 				m = *( static_cast<Matrix *>( val.data ) );
 			else
-				m.fromQuat( *( static_cast<Quat *>( val.data ) ) );
+				m.fromQuat( *( static_cast<Quat *>( storage() ) ) );
 
 			float x, y, z;
 			QString pre, suf;
@@ -772,7 +835,7 @@ QString NifValue::toString() const
 		return NifModel::version2string( val.u32 );
 	case tTriangle:
 		{
-			Triangle * tri = static_cast<Triangle *>( val.data );
+			Triangle * tri = static_cast<Triangle *>( storage() );
 			return QString( "%1 %2 %3" )
 			       .arg( tri->v1() )
 			       .arg( tri->v2() )
@@ -796,9 +859,9 @@ QString NifValue::toString() const
 QColor NifValue::toColor() const
 {
 	if ( type() == tColor3 )
-		return static_cast<Color3 *>( val.data )->toQColor();
+		return static_cast<Color3 *>( storage() )->toQColor();
 	else if ( type() == tColor4 )
-		return static_cast<Color4 *>( val.data )->toQColor();
+		return static_cast<Color4 *>( storage() )->toQColor();
 
 	return QColor();
 }
@@ -810,6 +873,133 @@ void NifOStream::init()
 	stringAdjust = ( model->inherits( "NifModel" ) && model->getVersionNumber() >= 0x14010003 );
 }
 
+NifIStream::NifIStream( BaseModel * m, QIODevice * d )
+	: model( m ), device( d ), data( nullptr ), size( 0 ), offset( 0 ), base( 0 ), mapped( nullptr )
+{
+	init();
+	attach();
+
+	QSettings cfg;
+	maxLength = cfg.value( "maximum string length", 0x8000 ).toInt();
+	//maxLength = Options::maxStringLength();
+}
+
+NifIStream::~NifIStream()
+{
+	if ( !device->isSequential() )
+		device->seek( pos() );
+
+	if ( mapped ) {
+		if ( QFileDevice * file = qobject_cast<QFileDevice *>( device ) )
+			file->unmap( mapped );
+	}
+}
+
+void NifIStream::attach()
+{
+	if ( device->isSequential() ) {
+		buffer = device->readAll();
+		data = buffer.constData();
+		size = buffer.size();
+		return;
+	}
+
+	base = device->pos();
+
+	if ( QFileDevice * file = qobject_cast<QFileDevice *>( device ) ) {
+		qint64 len = file->size() - base;
+
+		if ( len > 0 && ( mapped = file->map( base, len ) ) ) {
+			data = reinterpret_cast<const char *>( mapped );
+			size = len;
+			return;
+		}
+	} else if ( QBuffer * buf = qobject_cast<QBuffer *>( device ) ) {
+		// shares the buffer's data, no copy is made
+		buffer = buf->buffer();
+
+		if ( base <= buffer.size() ) {
+			data = buffer.constData() + base;
+			size = buffer.size() - base;
+			return;
+		}
+	}
+
+	buffer = device->readAll();
+	data = buffer.constData();
+	size = buffer.size();
+}
+
+bool NifIStream::seek( qint64 p )
+{
+	if ( p < base || p - base > size )
+		return false;
+
+	offset = p - base;
+	return true;
+}
+
+qint64 NifIStream::read( char * dst, qint64 len )
+{
+	len = qBound( qint64( 0 ), len, size - offset );
+	memcpy( dst, data + offset, len );
+	offset += len;
+	return len;
+}
+
+QByteArray NifIStream::read( qint64 len )
+{
+	len = qBound( qint64( 0 ), len, size - offset );
+	QByteArray bytes( data + offset, int( len ) );
+	offset += len;
+	return bytes;
+}
+
+template <typename T> inline bool NifIStream::get( T & v )
+{
+	if ( size - offset < qint64( sizeof( T ) ) ) {
+		offset = size;
+		return false;
+	}
+
+	const uchar * src = reinterpret_cast<const uchar *>( data + offset );
+	v = bigEndian ? qFromBigEndian<T>( src ) : qFromLittleEndian<T>( src );
+	offset += sizeof( T );
+	return true;
+}
+
+bool NifIStream::get( float * f, int count )
+{
+	if ( size - offset < qint64( count ) * 4 ) {
+		offset = size;
+		return false;
+	}
+
+	const uchar * src = reinterpret_cast<const uchar *>( data + offset );
+
+	for ( int i = 0; i < count; i++, src += 4 ) {
+		quint32 u = bigEndian ? qFromBigEndian<quint32>( src ) : qFromLittleEndian<quint32>( src );
+		memcpy( f + i, &u, 4 );
+	}
+
+	offset += qint64( count ) * 4;
+	return true;
+}
+
+bool NifIStream::getString( QString & s, qint64 len )
+{
+	if ( len < 0 || size - offset < len ) {
+		offset = size;
+		return false;
+	}
+
+	// same as QString( QByteArray ), which stops at the first null
+	const char * str = data + offset;
+	s = QString::fromUtf8( str, int( qstrnlen( str, uint( len ) ) ) );
+	offset += len;
+	return true;
+}
+
 bool NifIStream::read( NifValue & val )
 {
 	switch ( val.type() ) {
@@ -818,17 +1008,14 @@ bool NifIStream::read( NifValue & val )
 			val.val.u32 = 0;
 
 			if ( bool32bit )
-				*dataStream >> val.val.u32;
+				return get( val.val.u32 );
 			else
-				*dataStream >> val.val.u08;
-
-			return ( dataStream->status() == QDataStream::Ok );
+				return get( val.val.u08 );
 		}
 	case NifValue::tByte:
 		{
 			val.val.u32 = 0;
-			*dataStream >> val.val.u08;
-			return ( dataStream->status() == QDataStream::Ok );
+			return get( val.val.u08 );
 		}
 	case NifValue::tWord:
 	case NifValue::tShort:
@@ -836,169 +1023,122 @@ bool NifIStream::read( NifValue & val )
 	case NifValue::tBlockTypeIndex:
 		{
 			val.val.u32 = 0;
-			*dataStream >> val.val.u16;
-			return ( dataStream->status() == QDataStream::Ok );
+			return get( val.val.u16 );
 		}
 	case NifValue::tStringOffset:
 	case NifValue::tInt:
 	case NifValue::tUInt:
-		{
-			*dataStream >> val.val.u32;
-			return ( dataStream->status() == QDataStream::Ok );
-		}
 	case NifValue::tStringIndex:
-		{
-			*dataStream >> val.val.u32;
-			return ( dataStream->status() == QDataStream::Ok );
-		}
+		return get( val.val.u32 );
 	case NifValue::tLink:
 	case NifValue::tUpLink:
 		{
-			*dataStream >> val.val.i32;
+			if ( !get( val.val.i32 ) )
+				return false;
 
 			if ( linkAdjust )
 				val.val.i32--;
 
-			return ( dataStream->status() == QDataStream::Ok );
+			return true;
 		}
 	case NifValue::tFloat:
-		{
-			*dataStream >> val.val.f32;
-			return ( dataStream->status() == QDataStream::Ok );
-		}
+		return get( &val.val.f32, 1 );
 	case NifValue::tVector3:
-		{
-			Vector3 * v = static_cast<Vector3 *>( val.val.data );
-			*dataStream >> *v;
-			return ( dataStream->status() == QDataStream::Ok );
-		}
+		return get( static_cast<Vector3 *>( val.storage() )->xyz, 3 );
 	case NifValue::tVector4:
-		{
-			Vector4 * v = static_cast<Vector4 *>( val.val.data );
-			*dataStream >> *v;
-			return ( dataStream->status() == QDataStream::Ok );
-		}
+		return get( static_cast<Vector4 *>( val.storage() )->xyzw, 4 );
 	case NifValue::tTriangle:
 		{
-			Triangle * t = static_cast<Triangle *>( val.val.data );
-			*dataStream >> *t;
-			return ( dataStream->status() == QDataStream::Ok );
+			Triangle * t = static_cast<Triangle *>( val.storage() );
+			return get( t->v[0] ) && get( t->v[1] ) && get( t->v[2] );
 		}
 	case NifValue::tQuat:
-		{
-			Quat * q = static_cast<Quat *>( val.val.data );
-			*dataStream >> *q;
-			return ( dataStream->status() == QDataStream::Ok );
-		}
+		return get( static_cast<Quat *>( val.storage() )->wxyz, 4 );
 	case NifValue::tQuatXYZW:
 		{
-			Quat * q = static_cast<Quat *>( val.val.data );
-			return device->read( (char *)&q->wxyz[1], 12 ) == 12 && device->read( (char *)q->wxyz, 4 ) == 4;
+			Quat * q = static_cast<Quat *>( val.storage() );
+			return read( (char *)&q->wxyz[1], 12 ) == 12 && read( (char *)q->wxyz, 4 ) == 4;
 		}
 	case NifValue::tMatrix:
-		return device->read( (char *)static_cast<Matrix *>( val.val.data )->m, 36 ) == 36;
+		return read( (char *)static_cast<Matrix *>( val.val.data )->m, 36 ) == 36;
 	case NifValue::tMatrix4:
-		return device->read( (char *)static_cast<Matrix4 *>( val.val.data )->m, 64 ) == 64;
+		return read( (char *)static_cast<Matrix4 *>( val.val.data )->m, 64 ) == 64;
 	case NifValue::tVector2:
-		{
-			Vector2 * v = static_cast<Vector2 *>( val.val.data );
-			*dataStream >> *v;
-			return ( dataStream->status() == QDataStream::Ok );
-		}
+		return get( static_cast<Vector2 *>( val.storage() )->xy, 2 );
 	case NifValue::tColor3:
-		return device->read( (char *)static_cast<Color3 *>( val.val.data )->rgb, 12 ) == 12;
+		return read( (char *)static_cast<Color3 *>( val.storage() )->rgb, 12 ) == 12;
 	case NifValue::tColor4:
-		{
-			Color4 * c = static_cast<Color4 *>( val.val.data );
-			*dataStream >> *c;
-			return ( dataStream->status() == QDataStream::Ok );
-		}
+		return get( static_cast<Color4 *>( val.storage() )->rgba, 4 );
 	case NifValue::tSizedString:
 		{
-			int len;
-			//device->read( (char *) &len, 4 );
-			*dataStream >> len;
+			qint32 len = 0;
+
+			if ( !get( len ) )
+				return false;
 
 			if ( len > maxLength || len < 0 ) {
 				*static_cast<QString *>( val.val.data ) = tr( "<string too long (0x%1)>" ).arg( len, 0, 16 ); return false;
 			}
 
-			QByteArray string = device->read( len );
-
-			if ( string.size() != len )
-				return false;
-
 			//string.replace( "\r", "\\r" );
 			//string.replace( "\n", "\\n" );
-			*static_cast<QString *>( val.val.data ) = QString( string );
+			return getString( *static_cast<QString *>( val.val.data ), len );
 		}
-		return true;
 	case NifValue::tShortString:
 		{
-			unsigned char len;
-			device->read( (char *)&len, 1 );
-			QByteArray string = device->read( len );
-
-			if ( string.size() != len )
-				return false;
+			unsigned char len = 0;
+			read( (char *)&len, 1 );
 
 			//string.replace( "\r", "\\r" );
 			//string.replace( "\n", "\\n" );
-			*static_cast<QString *>( val.val.data ) = QString( string );
+			return getString( *static_cast<QString *>( val.val.data ), len );
 		}
-		return true;
 	case NifValue::tText:
 		{
-			int len;
-			device->read( (char *)&len, 4 );
+			int len = 0;
+			read( (char *)&len, 4 );
 
 			if ( len > maxLength || len < 0 ) {
 				*static_cast<QString *>( val.val.data ) = tr( "<string too long>" ); return false;
 			}
 
-			QByteArray string = device->read( len );
-
-			if ( string.size() != len )
-				return false;
-
-			*static_cast<QString *>( val.val.data ) = QString( string );
+			return getString( *static_cast<QString *>( val.val.data ), len );
 		}
-		return true;
 	case NifValue::tByteArray:
 		{
-			int len;
-			device->read( (char *)&len, 4 );
+			int len = 0;
+			read( (char *)&len, 4 );
 
 			if ( len < 0 )
 				return false;
 
-			*static_cast<QByteArray *>( val.val.data ) = device->read( len );
+			*static_cast<QByteArray *>( val.val.data ) = read( len );
 			return static_cast<QByteArray *>( val.val.data )->count() == len;
 		}
 	case NifValue::tStringPalette:
 		{
-			int len;
-			device->read( (char *)&len, 4 );
+			int len = 0;
+			read( (char *)&len, 4 );
 
 			if ( len > 0xffff || len < 0 )
 				return false;
 
-			*static_cast<QByteArray *>( val.val.data ) = device->read( len );
-			device->read( (char *)&len, 4 );
+			*static_cast<QByteArray *>( val.val.data ) = read( len );
+			read( (char *)&len, 4 );
 			return true;
 		}
 	case NifValue::tByteMatrix:
 		{
-			int len1, len2;
-			device->read( (char *)&len1, 4 );
-			device->read( (char *)&len2, 4 );
+			int len1 = 0, len2 = 0;
+			read( (char *)&len1, 4 );
+			read( (char *)&len2, 4 );
 
 			if ( len1 < 0 || len2 < 0 )
 				return false;
 
 			int len = len1 * len2;
 			ByteMatrix tmp( len1, len2 );
-			qint64 rlen = device->read( tmp.data(), len );
+			qint64 rlen = read( tmp.data(), len );
 			tmp.swap( *static_cast<ByteMatrix *>( val.val.data ) );
 			return (rlen == len);
 		}
@@ -1008,7 +1148,7 @@ bool NifIStream::read( NifValue & val )
 			int c = 0;
 			char chr = 0;
 
-			while ( c++ < 80 && device->getChar( &chr ) && chr != '\n' )
+			while ( c++ < 80 && offset < size && ( chr = data[offset++] ) != '\n' )
 				string.append( chr );
 
 			if ( c >= 80 )
@@ -1025,7 +1165,7 @@ bool NifIStream::read( NifValue & val )
 			int c = 0;
 			char chr = 0;
 
-			while ( c++ < 255 && device->getChar( &chr ) && chr != '\n' )
+			while ( c++ < 255 && offset < size && ( chr = data[offset++] ) != '\n' )
 				string.append( chr );
 
 			if ( c >= 255 )
@@ -1038,10 +1178,9 @@ bool NifIStream::read( NifValue & val )
 		{
 			QByteArray string;
 			int c = 0;
-			char chr = 0;
 
-			while ( c++ < 8 && device->getChar( &chr ) )
-				string.append( chr );
+			while ( c++ < 8 && offset < size )
+				string.append( data[offset++] );
 
 			if ( c > 9 )
 				return false;
@@ -1051,19 +1190,15 @@ bool NifIStream::read( NifValue & val )
 		}
 	case NifValue::tFileVersion:
 		{
-			if ( device->read( (char *)&val.val.u32, 4 ) != 4 )
+			if ( read( (char *)&val.val.u32, 4 ) != 4 )
 				return false;
 
 			//bool x = model->setVersion( val.val.u32 );
 			//init();
 			if ( model->inherits( "NifModel" ) && model->getVersionNumber() >= 0x14000004 ) {
-				bool littleEndian;
-				device->peek( (char *)&littleEndian, 1 );
-				bigEndian = !littleEndian;
-
-				if ( bigEndian ) {
-					dataStream->setByteOrder( QDataStream::BigEndian );
-				}
+				// peek at the endian type which follows the version
+				if ( offset < size )
+					bigEndian = ( data[offset] == 0 );
 			}
 
 			// hack for neosteam
@@ -1074,53 +1209,22 @@ bool NifIStream::read( NifValue & val )
 			return true;
 		}
 	case NifValue::tString:
-		{
-			if ( stringAdjust ) {
-				val.changeType( NifValue::tStringIndex );
-				return device->read( (char *)&val.val.i32, 4 ) == 4;
-			} else {
-				val.changeType( NifValue::tSizedString );
-
-				int len;
-				device->read( (char *)&len, 4 );
-
-				if ( len > maxLength || len < 0 ) {
-					*static_cast<QString *>( val.val.data ) = tr( "<string too long>" ); return false;
-				}
-
-				QByteArray string = device->read( len );
-
-				if ( string.size() != len )
-					return false;
-
-				//string.replace( "\r", "\\r" );
-				//string.replace( "\n", "\\n" );
-				*static_cast<QString *>( val.val.data ) = QString( string );
-				return true;
-			}
-		}
 	case NifValue::tFilePath:
 		{
 			if ( stringAdjust ) {
 				val.changeType( NifValue::tStringIndex );
-				return device->read( (char *)&val.val.i32, 4 ) == 4;
+				return read( (char *)&val.val.i32, 4 ) == 4;
 			} else {
 				val.changeType( NifValue::tSizedString );
 
-				int len;
-				device->read( (char *)&len, 4 );
+				int len = 0;
+				read( (char *)&len, 4 );
 
 				if ( len > maxLength || len < 0 ) {
 					*static_cast<QString *>( val.val.data ) = tr( "<string too long>" ); return false;
 				}
 
-				QByteArray string = device->read( len );
-
-				if ( string.size() != len )
-					return false;
-
-				*static_cast<QString *>( val.val.data ) = QString( string );
-				return true;
+				return getString( *static_cast<QString *>( val.val.data ), len );
 			}
 		}
 
@@ -1128,7 +1232,7 @@ bool NifIStream::read( NifValue & val )
 		{
 			if ( val.val.data ) {
 				QByteArray * array = static_cast<QByteArray *>( val.val.data );
-				return device->read( array->data(), array->size() ) == array->size();
+				return read( array->data(), array->size() ) == array->size();
 			}
 
 			return false;
@@ -1146,14 +1250,6 @@ void NifIStream::init()
 	linkAdjust   = ( model->inherits( "NifModel" ) && model->getVersionNumber() <  0x0303000D );
 	stringAdjust = ( model->inherits( "NifModel" ) && model->getVersionNumber() >= 0x14010003 );
 	bigEndian    = false; // set when tFileVersion is read
-
-	dataStream = new QDataStream( device );
-	dataStream->setByteOrder( QDataStream::LittleEndian );
-	dataStream->setFloatingPointPrecision( QDataStream::SinglePrecision );
-
-	QSettings cfg;
-	maxLength = cfg.value( "maximum string length", 0x8000 ).toInt();
-	//maxLength = Options::maxStringLength();
 }
 
 bool NifOStream::write( const NifValue & val )
@@ -1209,16 +1305,16 @@ bool NifOStream::write( const NifValue & val )
 	case NifValue::tFloat:
 		return device->write( (char *)&val.val.f32, 4 ) == 4;
 	case NifValue::tVector3:
-		return device->write( (char *)static_cast<Vector3 *>( val.val.data )->xyz, 12 ) == 12;
+		return device->write( (char *)static_cast<Vector3 *>( val.storage() )->xyz, 12 ) == 12;
 	case NifValue::tVector4:
-		return device->write( (char *)static_cast<Vector4 *>( val.val.data )->xyzw, 16 ) == 16;
+		return device->write( (char *)static_cast<Vector4 *>( val.storage() )->xyzw, 16 ) == 16;
 	case NifValue::tTriangle:
-		return device->write( (char *)static_cast<Triangle *>( val.val.data )->v, 6 ) == 6;
+		return device->write( (char *)static_cast<Triangle *>( val.storage() )->v, 6 ) == 6;
 	case NifValue::tQuat:
-		return device->write( (char *)static_cast<Quat *>( val.val.data )->wxyz, 16 ) == 16;
+		return device->write( (char *)static_cast<Quat *>( val.storage() )->wxyz, 16 ) == 16;
 	case NifValue::tQuatXYZW:
 		{
-			Quat * q = static_cast<Quat *>( val.val.data );
+			Quat * q = static_cast<Quat *>( val.storage() );
 			return device->write( (char *)&q->wxyz[1], 12 ) == 12 && device->write( (char *)q->wxyz, 4 ) == 4;
 		}
 	case NifValue::tMatrix:
@@ -1226,11 +1322,11 @@ bool NifOStream::write( const NifValue & val )
 	case NifValue::tMatrix4:
 		return device->write( (char *)static_cast<Matrix4 *>( val.val.data )->m, 64 ) == 64;
 	case NifValue::tVector2:
-		return device->write( (char *)static_cast<Vector2 *>( val.val.data )->xy, 8 ) == 8;
+		return device->write( (char *)static_cast<Vector2 *>( val.storage() )->xy, 8 ) == 8;
 	case NifValue::tColor3:
-		return device->write( (char *)static_cast<Color3 *>( val.val.data )->rgb, 12 ) == 12;
+		return device->write( (char *)static_cast<Color3 *>( val.storage() )->rgb, 12 ) == 12;
 	case NifValue::tColor4:
-		return device->write( (char *)static_cast<Color4 *>( val.val.data )->rgba, 16 ) == 16;
+		return device->write( (char *)static_cast<Color4 *>( val.storage() )->rgba, 16 ) == 16;
 	case NifValue::tSizedString:
 		{
 			QByteArray string = static_cast<QString *>( val.val.data )->toLatin1();
@@ -224,6 +224,42 @@ public:
 	static bool isValid( Type t ) { return t != tNone; }
 	//! Check if a type is of a link type (Ref or Ptr in xml).
 	static bool isLink( Type t ) { return t == tLink || t == tUpLink; }
+	//! Check if arrays of a type may be stored packed, see NifItem::pack().
+	/*!
+	 * These are the plain numbers and vectors that large arrays (vertices,
+	 * normals, UVs, colors, triangles, indices) are made of. Links and
+	 * strings are excluded; the model tracks them through their items.
+	 */
+	static bool isPackable( Type t )
+	{
+		switch ( t ) {
+		case tByte:
+		case tWord:
+		case tShort:
+		case tInt:
+		case tUInt:
+		case tFloat:
+		case tVector2:
+		case tVector3:
+		case tVector4:
+		case tQuat:
+		case tQuatXYZW:
+		case tColor3:
+		case tColor4:
+		case tTriangle:
+			return true;
+		default:
+			return false;
+		}
+	}
+	//! Size of a row of a packed array of type t, see NifItem::pack(); 0 if t is not packable.
+	static int packedSize( Type t );
+	//! Check if the rows of a packed array of type t are laid out as T, so that an array of T is a copy of them.
+	template <typename T> static bool packsAs( Type t );
+	//! Copy the data into a row of a packed array, which holds packedSize( type() ) bytes.
+	void toPacked( char * row ) const;
+	//! Set the data from a row of a packed array of the same type.
+	void fromPacked( const char * row );
 
 	//! Check if the type of the data is not tNone.
 	bool isValid() const { return typ != tNone; }
@@ -323,6 +359,9 @@ protected:
 	//! The type of this data.
 	Type typ;
 
+	//! If the value represents an abstract field. Does not seem to be reliably initialised yet.
+	bool abstract;
+
 	//! The structure containing the data.
 	union Value
 	{
@@ -332,13 +371,40 @@ protected:
 		qint32 i32;
 		float f32;
 		void * data;
+		//! Storage for the small fixed size types, see isInline()
+		float pod[4];
 	};
 
 	//! The data value.
 	Value val;
 
-	//! If the value represents an abstract field. Does not seem to be reliably initialised yet.
-	bool abstract;
+	//! Check if a type is stored in Value::pod instead of on the heap.
+	/*!
+	 * Vertex, normal, color, UV and triangle arrays make up the bulk of most
+	 * files; keeping these inline saves one allocation per array element.
+	 */
+	static bool isInline( Type t )
+	{
+		switch ( t ) {
+		case tVector2:
+		case tVector3:
+		case tVector4:
+		case tQuat:
+		case tQuatXYZW:
+		case tColor3:
+		case tColor4:
+		case tTriangle:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	//! Get a pointer to the data of a non-count type.
+	void * storage() const
+	{
+		return isInline( typ ) ? const_cast<float *>( val.pod ) : val.data;
+	}
 
 	//! Get the data as an object of type T.
 	/*!
@@ -453,7 +519,7 @@ inline bool NifValue::setFileVersion( quint32 v )
 template <typename T> inline T NifValue::getType( Type t ) const
 {
 	if ( typ == t )
-		return *static_cast<T *>( val.data ); // WARNING: this throws an exception if the type of v is not the original type by which val.data was initialized; the programmer must make sure that T matches t.
+		return *static_cast<T *>( storage() ); // WARNING: this throws an exception if the type of v is not the original type by which val.data was initialized; the programmer must make sure that T matches t.
 
 	return T();
 }
@@ -461,7 +527,7 @@ template <typename T> inline T NifValue::getType( Type t ) const
 template <typename T> inline bool NifValue::setType( Type t, T v )
 {
 	if ( typ == t ) {
-		*static_cast<T *>( val.data ) = v; // WARNING: this throws an exception if the type of v is not the original type by which val.data was initialized; the programmer must make sure that T matches t.
+		*static_cast<T *>( storage() ) = v; // WARNING: this throws an exception if the type of v is not the original type by which val.data was initialized; the programmer must make sure that T matches t.
 		return true;
 	}
 
@@ -561,7 +627,7 @@ template <> inline QByteArray * NifValue::get() const
 template <> inline Quat NifValue::get() const
 {
 	if ( isQuat() )
-		return *static_cast<Quat *>( val.data );
+		return *static_cast<Quat *>( storage() );
 
 	return Quat();
 }
@@ -682,7 +748,7 @@ template <> inline bool NifValue::set( const QByteArray & x )
 template <> inline bool NifValue::set( const Quat & x )
 {
 	if ( isQuat() ) {
-		*static_cast<Quat *>( val.data ) = x;
+		*static_cast<Quat *>( storage() ) = x;
 		return true;
 	}
 
@@ -765,31 +831,113 @@ template <> inline bool NifValue::ask( QByteArray * ) const
 	return isByteArray();
 }
 
+template <typename T> inline bool NifValue::packsAs( Type )
+{
+	return false;
+}
+template <> inline bool NifValue::packsAs<quint8>( Type t )
+{
+	return t == tByte;
+}
+template <> inline bool NifValue::packsAs<quint16>( Type t )
+{
+	return t == tWord || t == tShort;
+}
+template <> inline bool NifValue::packsAs<qint16>( Type t )
+{
+	return t == tWord || t == tShort;
+}
+template <> inline bool NifValue::packsAs<quint32>( Type t )
+{
+	return t == tInt || t == tUInt;
+}
+template <> inline bool NifValue::packsAs<qint32>( Type t )
+{
+	return t == tInt || t == tUInt;
+}
+template <> inline bool NifValue::packsAs<float>( Type t )
+{
+	return t == tFloat;
+}
+template <> inline bool NifValue::packsAs<Vector2>( Type t )
+{
+	return t == tVector2;
+}
+template <> inline bool NifValue::packsAs<Vector3>( Type t )
+{
+	return t == tVector3;
+}
+template <> inline bool NifValue::packsAs<Vector4>( Type t )
+{
+	return t == tVector4;
+}
+template <> inline bool NifValue::packsAs<Quat>( Type t )
+{
+	return t == tQuat || t == tQuatXYZW;
+}
+template <> inline bool NifValue::packsAs<Color3>( Type t )
+{
+	return t == tColor3;
+}
+template <> inline bool NifValue::packsAs<Color4>( Type t )
+{
+	return t == tColor4;
+}
+template <> inline bool NifValue::packsAs<Triangle>( Type t )
+{
+	return t == tTriangle;
+}
+
 class BaseModel;
 class NifItem;
 
 //! An input stream that reads a file into a model.
+/**
+ * The remainder of the device is mapped (for files) or read into memory
+ * when the stream is constructed, and values are decoded directly from that
+ * buffer. The device is repositioned to match the stream when the stream is
+ * destroyed.
+ */
 class NifIStream final
 {
 	Q_DECLARE_TR_FUNCTIONS( NifIStream )
 
 public:
 	//! Constructor.
-	NifIStream( BaseModel * m, QIODevice * d ) : model( m ), device( d )
-	{
-		init();
-	}
+	NifIStream( BaseModel * m, QIODevice * d );
+	//! Destructor.
+	~NifIStream();
 
 	//! Reads a NifValue from the underlying device. Returns true if successful.
 	bool read( NifValue & );
 
+	//! Reads up to \a len raw bytes into \a data; returns the number of bytes read.
+	qint64 read( char * data, qint64 len );
+	//! Reads up to \a len raw bytes.
+	QByteArray read( qint64 len );
+
+	//! The current position, relative to the start of the device.
+	qint64 pos() const { return base + offset; }
+	//! Sets the current position, relative to the start of the device.
+	bool seek( qint64 p );
+	//! Whether there is no more data to be read.
+	bool atEnd() const { return offset >= size; }
+
 private:
 	//! The model that data is being read into.
 	BaseModel * model;
 	//! The underlying device that data is being read from.
 	QIODevice * device;
-	//! The data stream that is wrapped around the device (simplifies endian conversion)
-	QDataStream * dataStream;
+
+	//! Maps or reads the remainder of the device into memory.
+	void attach();
+
+	//! Reads a value of type T, honouring the byte order of the model.
+	template <typename T> bool get( T & );
+	//! Reads \a count floats, honouring the byte order of the model.
+	bool get( float * f, int count );
+	//! Reads a string of \a len bytes.
+	bool getString( QString & s, qint64 len );
 
 	//! Initialises the stream.
 	void init();
@@ -805,6 +953,19 @@ private:
 
 	//! The maximum length of a string that can be read.
 	int maxLength;
+
+	//! The data being read, starting at the device position the stream was created at.
+	const char * data;
+	//! The number of bytes available in data.
+	qint64 size;
+	//! The read position in data.
+	qint64 offset;
+	//! The device position corresponding to the start of data.
+	qint64 base;
+	//! The file mapping backing data, if any.
+	uchar * mapped;
+	//! The buffer backing data, if the device could not be mapped.
+	QByteArray buffer;
 };
 
 //! An output stream that writes a model to a file.
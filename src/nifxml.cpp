@@ -43,10 +43,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //! Set NifXmlHandler::errorStr and return
 #define err( X ) { errorStr = X; return false; }
 
-QReadWriteLock             NifModel::XMLlock;
-QList<quint32>             NifModel::supportedVersions;
-QHash<QString, NifBlock *> NifModel::compounds;
-QHash<QString, NifBlock *> NifModel::blocks;
+QReadWriteLock                  NifModel::XMLlock;
+QSharedPointer<const NifSchema> NifModel::publishedSchema( new NifSchema );
 
 //! Parses nif.xml
 class NifXmlHandler final : public QXmlDefaultHandler
@@ -78,7 +76,7 @@ public:
 	static inline QString tr( const char * key, const char * comment = 0 ) { return QCoreApplication::translate( "NifXmlHandler", key, comment ); }
 
 	//! Constructor
-	NifXmlHandler()
+	NifXmlHandler( NifSchema * s ) : schema( s )
 	{
 		depth = 0;
 		tags.insert( "niftoolsxml", tagFile );
@@ -93,6 +91,8 @@ public:
 		blk = 0;
 	}
 
+	//! The schema being filled
+	NifSchema * schema;
 	//! Current position on stack
 	int depth;
 	//! Tag stack
@@ -188,7 +188,7 @@ public:
 						if ( id.isEmpty() )
 							err( tr( "compound and niblocks must have a name" ) );
 
-						if ( NifModel::compounds.contains( id ) || NifModel::blocks.contains( id ) )
+						if ( schema->compounds.contains( id ) || schema->blocks.contains( id ) )
 							err( tr( "multiple declarations of %1" ).arg( id ) );
 
 						if ( !blk )
@@ -201,7 +201,7 @@ public:
 							blk->ancestor = list.value( "inherit" );
 
 							if ( !blk->ancestor.isEmpty() ) {
-								if ( !NifModel::blocks.contains( blk->ancestor ) )
+								if ( !schema->blocks.contains( blk->ancestor ) )
 									err( tr( "forward declaration of block id %1" ).arg( blk->ancestor ) );
 							}
 						}
@@ -247,7 +247,7 @@ public:
 					int v = NifModel::version2number( list.value( "num" ).trimmed() );
 
 					if ( v != 0 && !list.value( "num" ).isEmpty() )
-						NifModel::supportedVersions.append( v );
+						schema->supportedVersions.append( v );
 					else
 						err( tr( "invalid version tag" ) );
 				}
@@ -293,21 +293,30 @@ public:
 					else if ( type == "RotationKeyArray" )
 						type = "ns keyrotarray";
 
-					// now allocate
+					// now allocate; the expressions are compiled once per schema
 					data = NifData(
 						list.value( "name" ),
 						type,
 						list.value( "template" ),
 						NifValue( NifValue::type( type ) ),
 						list.value( "arg" ),
-						list.value( "arr1" ),
+						QString(),
 						list.value( "arr2" ),
-						list.value( "cond" ),
+						QString(),
 						NifModel::version2number( list.value( "ver1" ) ),
 						NifModel::version2number( list.value( "ver2" ) ),
 						( list.value( "abstract" ) == "1" )
 					);
 
+					QString arr1 = list.value( "arr1" );
+					QString cond = list.value( "cond" );
+					data.setArr1( arr1, schema->addExpression( arr1 ) );
+					data.setCond( cond, schema->addExpression( cond ) );
+
+					// the rows of a multidimensional array take their size from arr2
+					if ( !data.arr2().isEmpty() )
+						schema->addExpression( NifModel::parentPrefix( data.arr2() ) );
+
 					if ( data.isAbstract() ) {
 						data.value.setAbstract( true );
 					}
@@ -345,7 +354,7 @@ public:
 					}
 
 					if ( !vercond.isEmpty() ) {
-						data.setVerCond( vercond );
+						data.setVerCond( vercond, schema->addExpression( vercond ) );
 					}
 
 					if ( data.name().isEmpty() || data.type().isEmpty() )
@@ -423,10 +432,10 @@ public:
 
 				switch ( x ) {
 				case tagCompound:
-					NifModel::compounds.insert( blk->id, blk );
+					schema->compounds.insert( blk->id, blk );
 					break;
 				case tagBlock:
-					NifModel::blocks.insert( blk->id, blk );
+					schema->blocks.insert( blk->id, blk );
 					break;
 				default:
 					break;
@@ -499,7 +508,7 @@ public:
 	//! Checks that the type of the data is valid
 	bool checkType( const NifData & data )
 	{
-		return ( NifModel::compounds.contains( data.type() )
+		return ( schema->compounds.contains( data.type() )
 		        || NifValue::type( data.type() ) != NifValue::tNone
 		        || data.type() == "TEMPLATE"
 		);
@@ -511,8 +520,8 @@ public:
 		return ( data.temp().isEmpty()
 		        || NifValue::type( data.temp() ) != NifValue::tNone
 		        || data.temp() == "TEMPLATE"
-		        || NifModel::blocks.contains( data.temp() )
-		        || NifModel::compounds.contains( data.temp() )
+		        || schema->blocks.contains( data.temp() )
+		        || schema->compounds.contains( data.temp() )
 		);
 	}
 
@@ -520,8 +529,8 @@ public:
 	bool endDocument() override final
 	{
 		// make a rough check of the maps
-		for ( const QString& key : NifModel::compounds.keys() ) {
-			NifBlock * c = NifModel::compounds.value( key );
+		for ( const QString& key : schema->compounds.keys() ) {
+			NifBlock * c = schema->compounds.value( key );
 			for ( NifData data :c->types ) {
 				if ( !checkType( data ) )
 					err( tr( "compound type %1 refers to unknown type %2" ).arg( key, data.type() ) );
@@ -534,10 +543,10 @@ public:
 			}
 		}
 
-		for ( const QString& key : NifModel::blocks.keys() ) {
-			NifBlock * blk = NifModel::blocks.value( key );
+		for ( const QString& key : schema->blocks.keys() ) {
+			NifBlock * blk = schema->blocks.value( key );
 
-			if ( !blk->ancestor.isEmpty() && !NifModel::blocks.contains( blk->ancestor ) )
+			if ( !blk->ancestor.isEmpty() && !schema->blocks.contains( blk->ancestor ) )
 				err( tr( "niobject %1 inherits unknown ancestor %2" ).arg( key, blk->ancestor ) );
 
 			if ( blk->ancestor == key )
@@ -552,6 +561,45 @@ public:
 			}
 		}
 
+		// number the block types and record each one's ancestry as a bitset
+		QStringList ids = schema->blocks.keys();
+		ids.sort();
+
+		for ( const QString& key : ids ) {
+			NifBlock * b = schema->blocks.value( key );
+			b->typeId = schema->blockTypes.count();
+			schema->blockTypes.append( b );
+		}
+
+		for ( NifBlock * b : schema->blockTypes ) {
+			b->lineage.resize( schema->blockTypes.count() );
+
+			for ( NifBlock * a = b; a && !b->lineage.testBit( a->typeId ); a = schema->blocks.value( a->ancestor ) )
+				b->lineage.setBit( a->typeId );
+		}
+
+		// index the rows of the fields, as laid out by NifModel::insertType() and insertAncestor()
+		for ( NifBlock * c : schema->compounds ) {
+			c->schema = schema;
+
+			for ( const NifData& data : c->types )
+				c->fieldRows[schema->internField( data.name() )].append( c->fieldCount++ );
+		}
+
+		for ( NifBlock * b : schema->blockTypes ) {
+			b->schema = schema;
+
+			QList<NifBlock *> chain;
+
+			for ( NifBlock * a = b; a && !chain.contains( a ); a = schema->blocks.value( a->ancestor ) )
+				chain.prepend( a );
+
+			for ( NifBlock * a : chain ) {
+				for ( const NifData& data : a->types )
+					b->fieldRows[schema->internField( data.name() )].append( b->fieldCount++ );
+			}
+		}
+
 		return true;
 	}
 
@@ -603,19 +651,20 @@ QString NifModel::parseXmlDescription( const QString & filename )
 {
 	QWriteLocker lck( &XMLlock );
 
-	qDeleteAll( compounds );    compounds.clear();
-	qDeleteAll( blocks );       blocks.clear();
-
-	supportedVersions.clear();
+	// Models keep the previous schema until they are cleared; it is
+	// deleted along with the last model referring to it.
+	NifSchema * xml = new NifSchema;
 
 	NifValue::initialize();
 
 	QFile f( filename );
 
-	if ( !f.open( QIODevice::ReadOnly | QIODevice::Text ) )
+	if ( !f.open( QIODevice::ReadOnly | QIODevice::Text ) ) {
+		publishedSchema = QSharedPointer<const NifSchema>( xml );
 		return tr( "error: couldn't open xml description file: " ) + filename;
+	}
 
-	NifXmlHandler handler;
+	NifXmlHandler handler( xml );
 	QXmlSimpleReader reader;
 	reader.setContentHandler( &handler );
 	reader.setErrorHandler( &handler );
@@ -623,15 +672,81 @@ QString NifModel::parseXmlDescription( const QString & filename )
 	reader.parse( source );
 
 	if ( !handler.errorString().isEmpty() ) {
-		qDeleteAll( compounds );
-		compounds.clear();
-
-		qDeleteAll( blocks );
-		blocks.clear();
-
-		supportedVersions.clear();
+		delete xml;
+		xml = new NifSchema;
 	}
 
+	publishedSchema = QSharedPointer<const NifSchema>( xml );
+
 	return handler.errorString();
 }
 
+NifSchema::NifSchema()
+{
+	static QAtomicInt serials;
+	serial = quint32( serials.fetchAndAddRelaxed( 1 ) + 1 );
+}
+
+int NifSchema::internField( const QString & name )
+{
+	auto it = fieldIds.constFind( name );
+
+	if ( it != fieldIds.constEnd() )
+		return it.value();
+
+	int id = fieldIds.count();
+	fieldIds.insert( name, id );
+	return id;
+}
+
+int NifFieldKey::find( const NifSchema & schema, const QString & name )
+{
+	return schema.fieldIds.value( name, -1 );
+}
+
+int NifFieldKey::id( const NifSchema & schema ) const
+{
+	// serial and id are stored together, so a key shared by threads using
+	// different schemas never pairs one schema with the id of another
+	quint64 c = cached.loadAcquire();
+
+	if ( quint32( c >> 32 ) == schema.serial )
+		return int( quint32( c ) );
+
+	int i = find( schema, n );
+	cached.storeRelease( ( quint64( schema.serial ) << 32 ) | quint32( i ) );
+	return i;
+}
+
+Expression NifSchema::expression( const QString & source ) const
+{
+	auto it = expressions.constFind( source );
+
+	if ( it != expressions.constEnd() )
+		return it.value();
+
+	return Expression( source );
+}
+
+Expression NifSchema::addExpression( const QString & source )
+{
+	if ( source.isEmpty() )
+		return Expression();
+
+	auto it = expressions.constFind( source );
+
+	if ( it != expressions.constEnd() )
+		return it.value();
+
+	Expression expr( source );
+	expressions.insert( source, expr );
+	return expr;
+}
+
+QSharedPointer<const NifSchema> NifModel::activeSchema()
+{
+	// taken when a model is cleared, never while reading a schema
+	QReadLocker lck( &XMLlock );
+	return publishedSchema;
+}
+
@@ -63,6 +63,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QTabWidget>
 #include <QComboBox>
 #include <QApplication>
+#include <QThread>
 
 
 //! \file options.cpp SmallListView and Options implementation
@@ -74,6 +75,12 @@ public:
 	QSize sizeHint() const override final { return minimumSizeHint(); }
 };
 
+//! Whether the widgets may be read; other threads, such as the workers of batch mode, read the saved settings
+static bool onGuiThread()
+{
+	return QThread::currentThread() == QCoreApplication::instance()->thread();
+}
+
 Options::Options()
 {
 	version = new NifSkopeVersion( NIFSKOPE_VERSION );
@@ -228,6 +235,12 @@ Options::Options()
 
 		genPage->popLayout();
 
+		genPage->addWidget( LazyBlocks = new QCheckBox( tr( "Lazy Block Loading" ) ) );
+		LazyBlocks->setToolTip( tr( "Parse the blocks of a NIF file when they are first shown or rendered instead of when the file is opened."
+		                            " Only NIF files of version 20.2 and up, which record their block sizes, can be loaded this way." ) );
+		LazyBlocks->setChecked( cfg.value( "Lazy Block Loading", false ).toBool() );
+		connect( LazyBlocks, &QCheckBox::toggled, this, &Options::sigChanged );
+
 		/* if we want to make max string length more accessible
 		genPage->pushLayout( Qt::Horizontal );
 		genPage->addWidget( new QLabel( tr("Maximum String Length") ) );
@@ -324,6 +337,33 @@ Options::Options()
 		connect( TexAlternatives, &QCheckBox::toggled, this, &Options::sigChanged );
 		connect( TexAlternatives, &QCheckBox::toggled, this, &Options::sigFlush3D );
 
+		texPage->pushLayout( Qt::Horizontal );
+		texPage->addWidget( TexDiskCache = new QCheckBox( tr( "Cache &decoded textures (MB)" ) ) );
+		TexDiskCache->setToolTip( tr( "Keep decoded textures on disk, so that textures<br>which were loaded before need not be decoded again." ) );
+		TexDiskCache->setChecked( cfg.value( "Texture Disk Cache", false ).toBool() );
+		connect( TexDiskCache, &QCheckBox::toggled, this, &Options::sigChanged );
+		texPage->addWidget( TexDiskCacheSize = new QSpinBox, 1 );
+		TexDiskCacheSize->setToolTip( tr( "The least recently used decoded textures are deleted<br>once the cache takes up more than this on disk." ) );
+		TexDiskCacheSize->setMinimum( 64 );
+		TexDiskCacheSize->setMaximum( 65536 );
+		TexDiskCacheSize->setSingleStep( 256 );
+		TexDiskCacheSize->setValue( cfg.value( "Texture Disk Cache Size", 2048 ).toInt() );
+		TexDiskCacheSize->setEnabled( TexDiskCache->isChecked() );
+		connect( TexDiskCache, &QCheckBox::toggled, TexDiskCacheSize, &QSpinBox::setEnabled );
+		connect( TexDiskCacheSize, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &Options::sigChanged );
+		texPage->popLayout();
+
+		texPage->pushLayout( Qt::Horizontal );
+		texPage->addWidget( new QLabel( tr( "Texture memory (MB)" ) ) );
+		texPage->addWidget( TexBudget = new QSpinBox, 1 );
+		TexBudget->setToolTip( tr( "Textures which are no longer drawn are released<br>once loaded textures take up more than this." ) );
+		TexBudget->setMinimum( 64 );
+		TexBudget->setMaximum( 16384 );
+		TexBudget->setSingleStep( 64 );
+		TexBudget->setValue( cfg.value( "Texture Memory", 1024 ).toInt() );
+		connect( TexBudget, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &Options::sigChanged );
+		texPage->popLayout();
+
 		texPage->popLayout();
 		texPage->popLayout();
 		texPage->popLayout();
@@ -639,6 +679,9 @@ void Options::save()
 
 		cfg.setValue( "Texture Folders", textureFolders() );
 		cfg.setValue( "Texture Alternatives", textureAlternatives() );
+		cfg.setValue( "Texture Disk Cache", textureDiskCache() );
+		cfg.setValue( "Texture Disk Cache Size", TexDiskCacheSize->value() );
+		cfg.setValue( "Texture Memory", TexBudget->value() );
 
 		cfg.setValue( "Draw Axes", drawAxes() );
 		cfg.setValue( "Draw Nodes", drawNodes() );
@@ -681,6 +724,7 @@ void Options::save()
 	// Settings group
 	cfg.setValue( "Settings/Language", translationLocale() );
 	cfg.setValue( "Settings/Startup Version", startupVersion() );
+	cfg.setValue( "Settings/Lazy Block Loading", lazyBlockLoading() );
 	// If we want to make this more accessible
 	//cfg.setValue( "Settings/Maximum String Length", maxStringLength() );
 
@@ -934,14 +978,35 @@ void Options::activateLightPreset( int id )
 
 QStringList Options::textureFolders()
 {
+	if ( !onGuiThread() )
+		return QSettings().value( "Render Settings/Texture Folders" ).toStringList();
+
 	return get()->TexFolderModel->stringList();
 }
 
 bool Options::textureAlternatives()
 {
+	if ( !onGuiThread() )
+		return QSettings().value( "Render Settings/Texture Alternatives", true ).toBool();
+
 	return get()->TexAlternatives->isChecked();
 }
 
+bool Options::textureDiskCache()
+{
+	return get()->TexDiskCache->isChecked();
+}
+
+qint64 Options::textureDiskCacheSize()
+{
+	return qint64( get()->TexDiskCacheSize->value() ) * 1024 * 1024;
+}
+
+qint64 Options::textureBudget()
+{
+	return qint64( get()->TexBudget->value() ) * 1024 * 1024;
+}
+
 Options::Axis Options::upAxis()
 {
 	return get()->AxisX->isChecked() ? XAxis : get()->AxisY->isChecked() ? YAxis : ZAxis;
@@ -1067,9 +1132,20 @@ int Options::lightPlanarAngle()
 
 QString Options::startupVersion()
 {
+	if ( !onGuiThread() )
+		return QSettings().value( "Settings/Startup Version", "20.0.0.5" ).toString();
+
 	return get()->StartVer->text();
 };
 
+bool Options::lazyBlockLoading()
+{
+	if ( !onGuiThread() )
+		return QSettings().value( "Settings/Lazy Block Loading", false ).toBool();
+
+	return get()->LazyBlocks->isChecked();
+}
+
 bool Options::overrideMaterials()
 {
 	return get()->overrideMatCheck->isChecked();
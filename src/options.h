@@ -82,10 +82,16 @@ public:
 
 	static QString getDisplayVersion();
 
-	//! Texture folders
+	//! Texture folders; like textureAlternatives() and startupVersion(), safe to call from any thread
 	static QStringList textureFolders();
 	//! Whether to use alternative textures
 	static bool textureAlternatives();
+	//! Whether to keep decoded textures on disk
+	static bool textureDiskCache();
+	//! Disk space the decoded textures may take up before the least recently used are deleted, in bytes
+	static qint64 textureDiskCacheSize();
+	//! Memory loaded textures may take up before unused ones are released, in bytes
+	static qint64 textureBudget();
 
 	//! Whether to enable antialiasing
 	static bool antialias();
@@ -165,6 +171,8 @@ public:
 
 	//! The NIF version to use at start
 	static QString startupVersion();
+	//! Whether blocks are parsed when first accessed instead of on load; safe to call from any thread
+	static bool lazyBlockLoading();
 	//! The current translation locale
 	static QLocale translationLocale();
 	// Maximum string length (see NifIStream::init for the current usage)
@@ -228,6 +236,7 @@ protected:
 
 	QComboBox * RegionOpt;
 	QLineEdit * StartVer;
+	QCheckBox * LazyBlocks;
 	//QSpinBox * StringLength;
 
 	//////////////////////////////////////////////////////////////////////////
@@ -237,6 +246,9 @@ protected:
 	QListView * TexFolderView;
 	FileSelector * TexFolderSelect;
 	QCheckBox * TexAlternatives;
+	QCheckBox * TexDiskCache;
+	QSpinBox * TexDiskCacheSize;
+	QSpinBox * TexBudget;
 	QAbstractButton * TexFolderButtons[4];
 
 	QCheckBox * AntiAlias;
@@ -34,10 +34,24 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <QCache>
 #include <QDir>
+#include <QMessageBox>
 
 
 //! \file spellbook.cpp SpellBook implementation
 
+void Spell::inform( const NifModel * nif, const QString & text, bool warning )
+{
+	if ( nif->isHeadless() ) {
+		nif->msg( Message() << text );
+		return;
+	}
+
+	if ( warning )
+		QMessageBox::warning( 0, "NifSkope", text );
+	else
+		QMessageBox::information( 0, "NifSkope", text );
+}
+
 QList<Spell *> & SpellBook::spells()
 {
 	// construct-on-first-use wrapper
@@ -88,6 +88,9 @@ public:
 			cast( nif, index );
 	}
 
+	//! Show the outcome of a spell in a message box, or report it through the model if it is headless
+	static void inform( const NifModel * nif, const QString & text, bool warning = false );
+
 	//! i18n wrapper for various strings
 	/*!
 	 * Note that we don't use QObject::tr() because that doesn't provide
@@ -9,7 +9,6 @@
 #include <QLabel>
 #include <QLayout>
 #include <QMap>
-#include <QMessageBox>
 #include <QPushButton>
 
 #include <algorithm> // std::sort
@@ -153,8 +152,11 @@ public:
 		nif->set<float>( iCVS, "Radius", 0.1f );
 
 		// for arrow detection: [0, 0, -0, 0, 0, -0]
-		nif->set<float>( nif->getIndex( iCVS, "Unknown 6 Floats" ).child( 2, 0 ), -0.0 );
-		nif->set<float>( nif->getIndex( iCVS, "Unknown 6 Floats" ).child( 5, 0 ), -0.0 );
+		QVector<float> unknown6 = nif->getArray<float>( iCVS, "Unknown 6 Floats" );
+		if ( unknown6.count() == 6 ) {
+			unknown6[2] = unknown6[5] = -0.0f;
+			nif->setArray<float>( iCVS, "Unknown 6 Floats", unknown6 );
+		}
 
 		QModelIndex iParent = nif->getBlock( nif->getParent( nif->getBlockNumber( index ) ) );
 		QModelIndex collisionLink = nif->getIndex( iParent, "Collision Object" );
@@ -189,7 +191,7 @@ public:
 			nif->removeNiBlock( nif->getBlockNumber( shape ) );
 		}
 
-		QMessageBox::information( 0, "NifSkope", Spell::tr( "Created hull with %1 vertices, %2 normals" ).arg( convex_verts.count() ).arg( convex_norms.count() ) );
+		inform( nif, Spell::tr( "Created hull with %1 vertices, %2 normals" ).arg( convex_verts.count() ).arg( convex_norms.count() ) );
 
 		// returning iCVS here can crash NifSkope if a child array is selected
 		return index;
@@ -1,4 +1,5 @@
 #include "mesh.h"
+#include "spatialhash.h"
 
 #include <QDialog>
 #include <QGridLayout>
@@ -278,10 +279,11 @@ public:
 	void flip( NifModel * nif, const QModelIndex & index, int f )
 	{
 		if ( nif->isArray( index ) ) {
+			// a set of UVs is a packed array, whose rows have no index
 			QModelIndex idx = index.child( 0, 0 );
 
-			if ( idx.isValid() ) {
-				if ( nif->isArray( idx ) )
+			if ( nif->rowCount( index ) > 0 ) {
+				if ( idx.isValid() && nif->isArray( idx ) )
 					flip( nif, idx, f );
 				else {
 					QVector<Vector2> tc = nif->getArray<Vector2>( index );
@@ -331,7 +333,7 @@ public:
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return ( nif->getValue( index ).type() == NifValue::tTriangle )
-		       || ( nif->isArray( index ) && nif->getValue( index.child( 0, 0 ) ).type() == NifValue::tTriangle );
+		       || ( nif->isArray( index ) && nif->getValue( index, 0 ).type() == NifValue::tTriangle );
 	}
 
 	QModelIndex cast( NifModel * nif, const QModelIndex & index ) override final
@@ -501,40 +503,73 @@ public:
 				throw QString( Spell::tr( "vertex array size differs" ) );
 			}
 
-			// detect the dublicates
+			// detect the duplicates; only vertices with the same hash can be equal
 
-			QMap<quint16, quint16> map;
+			auto same = [&]( int a, int b ) {
+				if ( !( verts[a] == verts[b] ) )
+					return false;
+
+				if ( norms.count() && !( norms[a] == norms[b] ) )
+					return false;
+
+				if ( colors.count() && !( colors[a] == colors[b] ) )
+					return false;
+
+				for ( int t = 0; t < texco.count(); t++ ) {
+					if ( !( texco[t][a] == texco[t][b] ) )
+						return false;
+				}
+
+				return true;
+			};
+
+			QVector<QPair<uint, int> > hashes( numVerts );
 
 			for ( int a = 0; a < numVerts; a++ ) {
-				Vector3 v = verts[a];
+				uint h = hashFloats( verts[a].data(), 3 );
 
-				for ( int b = 0; b < a; b++ ) {
-					if ( !( v == verts[b] ) )
-						continue;
+				if ( norms.count() )
+					h = hashFloats( norms[a].data(), 3, h );
 
-					if ( norms.count() && !( norms[a] == norms[b] ) )
-						continue;
+				if ( colors.count() )
+					h = hashFloats( colors[a].data(), 4, h );
 
-					if ( colors.count() && !( colors[a] == colors[b] ) )
-						continue;
+				for ( int t = 0; t < texco.count(); t++ )
+					h = hashFloats( texco[t][a].data(), 2, h );
 
-					int t = 0;
+				hashes[a] = qMakePair( h, a );
+			}
 
-					for ( t = 0; t < texco.count(); t++ ) {
-						if ( !( texco[t][a] == texco[t][b] ) )
-							break;
-					}
+			std::sort( hashes.begin(), hashes.end() );
 
-					if ( t < texco.count() )
-						continue;
+			QMap<quint16, quint16> map;
+
+			for ( int i = 0; i < numVerts; ) {
+				int j = i + 1;
+
+				while ( j < numVerts && hashes[j].first == hashes[i].first )
+					j++;
+
+				// each vertex is replaced by the last vertex equal to it
+				for ( int x = i; x < j; x++ ) {
+					int b = hashes[x].second;
 
-					map.insert( b, a );
+					for ( int y = j - 1; y > x; y-- ) {
+						if ( same( hashes[y].second, b ) ) {
+							map.insert( b, hashes[y].second );
+							break;
+						}
+					}
 				}
+
+				i = j;
 			}
 
 			//qWarning() << QString( Spell::tr("detected % duplicates") ).arg( map.count() );
 
-			// adjust the faces
+			// adjust the faces; the views only hear of the data block once all edits are done
+
+			nif->beginEdits();
 
 			QVector<Triangle> tris = nif->getArray<Triangle>( iData, "Triangles" );
 			QMutableVectorIterator<Triangle> itri( tris );
@@ -570,9 +605,13 @@ public:
 			// finally, remove the now unused vertices
 
 			removeWasteVertices( nif, iData, iShape );
+
+			nif->commitEdits();
 		}
 		catch ( QString e )
 		{
+			// undo the face adjustments if removing the vertices failed
+			nif->rollbackEdits();
 			qWarning() << e.toLatin1().data();
 		}
 
@@ -1,5 +1,7 @@
 #include "spellbook.h"
 
+#include <algorithm> // std::copy
+
 
 // Brief description is deliberately not autolinked to class Spell
 /*! \file moppcode.cpp
@@ -226,10 +228,11 @@ public:
 				nif->set<int>( iCodeSize, moppcode.size() );
 				nif->updateArray( iCode );
 
+				QVector<quint8> code( moppcode.size() );
+
 				//nif->set<QByteArray>( iCode, moppcode );
-				for ( int i = 0; i < moppcode.size(); ++i ) {
-					nif->set<quint8>( iCode.child( i, 0 ), moppcode[i] );
-				}
+				std::copy( moppcode.cbegin(), moppcode.cend(), code.begin() );
+				nif->setArray<quint8>( iCode, code );
 			}
 		}
 
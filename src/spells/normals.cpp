@@ -1,4 +1,5 @@
 #include "spellbook.h"
+#include "spatialhash.h"
 
 #include "nvtristripwrapper.h"
 
@@ -8,6 +9,8 @@
 #include <QLayout>
 #include <QPushButton>
 
+#include <cmath>
+
 
 // Brief description is deliberately not autolinked to class Spell
 /*! \file normals.cpp
@@ -182,11 +185,17 @@ public:
 
 		QVector<Vector3> snorms( norms );
 
+		// maxd bounds the squared distance, so only vertices within sqrt( maxd ) are candidates
+		SpatialHash grid( verts, std::sqrt( maxd ) );
+
 		for ( int i = 0; i < verts.count(); i++ ) {
 			const Vector3 & a = verts[i];
 			Vector3 an = norms[i];
 
-			for ( int j = i + 1; j < verts.count(); j++ ) {
+			grid.forNeighbours( a, [&]( int j ) {
+				if ( j <= i )
+					return;
+
 				const Vector3 & b = verts[j];
 
 				if ( ( a - b ).squaredLength() < maxd ) {
@@ -197,7 +206,7 @@ public:
 						snorms[j] += an;
 					}
 				}
-			}
+			} );
 		}
 
 		for ( int i = 0; i < verts.count(); i++ )
@@ -223,7 +232,7 @@ public:
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
 		return ( nif->getValue( index ).type() == NifValue::tVector3 )
-		       || ( nif->isArray( index ) && nif->getValue( index.child( 0, 0 ) ).type() == NifValue::tVector3 );
+		       || ( nif->isArray( index ) && nif->getValue( index, 0 ).type() == NifValue::tVector3 );
 	}
 
 	QModelIndex cast( NifModel * nif, const QModelIndex & index ) override final
@@ -1,4 +1,4 @@
-#include "spellbook.h"
+#include "optimize.h"
 
 #include "blocks.h"
 #include "mesh.h"
@@ -6,10 +6,8 @@
 #include "transform.h"
 
 #include <QBuffer>
-#include <QMessageBox>
 
 #include <algorithm> // std::sort
-#include <functional> //std::greater
 
 
 // Brief description is deliberately not autolinked to class Spell
@@ -19,6 +17,121 @@
  * All classes here inherit from the Spell class.
  */
 
+void BlockDeduplicator::addCanonicalizer( const QString & blockType, const QString & field, const Canonicalizer & canonicalize )
+{
+	canonicalizers[blockType].append( { field, canonicalize } );
+}
+
+//! Appends \a block to \a order after the candidates it links to
+static void orderCandidates( const NifModel * nif, qint32 block, const QVector<bool> & candidates, QVector<char> & state, QVector<qint32> & order )
+{
+	// 1: being visited, 2: ordered; a link back to a block being visited is a cycle and is ignored
+	state[block] = 1;
+
+	for ( const auto l : nif->getChildLinks( block ) ) {
+		if ( l >= 0 && l < candidates.count() && candidates[l] && !state[l] )
+			orderCandidates( nif, l, candidates, state, order );
+	}
+
+	state[block] = 2;
+	order.append( block );
+}
+
+//! Points every link below \a parent that is a key of \a map at the block it maps to
+static void redirectLinks( NifModel * nif, const QModelIndex & parent, const QMap<qint32, qint32> & map )
+{
+	for ( int r = 0; r < nif->rowCount( parent ); r++ ) {
+		QModelIndex iChild = parent.child( r, 0 );
+
+		// the rows of a packed array have no index; they hold no links
+		if ( !iChild.isValid() )
+			break;
+
+		if ( nif->rowCount( iChild ) > 0 ) {
+			redirectLinks( nif, iChild, map );
+		} else if ( nif->isLink( iChild ) ) {
+			qint32 l = nif->getLink( iChild );
+
+			if ( map.contains( l ) )
+				nif->setLink( iChild, map.value( l ) );
+		}
+	}
+}
+
+int BlockDeduplicator::merge( NifModel * nif ) const
+{
+	int numBlocks = nif->getBlockCount();
+	QVector<bool> candidates( numBlocks, false );
+
+	for ( qint32 b = 0; b < numBlocks; b++ )
+		candidates[b] = filter( nif, nif->getBlock( b ) );
+
+	QVector<char> state( numBlocks, 0 );
+	QVector<qint32> order;
+
+	for ( qint32 b = 0; b < numBlocks; b++ ) {
+		if ( candidates[b] && !state[b] )
+			orderCandidates( nif, b, candidates, state, order );
+	}
+
+	// the header and link tables are rebuilt once, after the merge
+	bool held = nif->holdUpdates( true );
+
+	QHash<QByteArray, qint32> survivors;
+	QMap<qint32, qint32> map;
+
+	for ( const auto b : order ) {
+		QModelIndex iBlock = nif->getBlock( b );
+
+		for ( const auto l : nif->getChildLinks( b ) ) {
+			if ( map.contains( l ) ) {
+				redirectLinks( nif, iBlock, map );
+				break;
+			}
+		}
+
+		QString type = nif->itemName( iBlock );
+
+		// the original values of the fields that were canonicalized
+		QList<QPair<QModelIndex, QString>> originals;
+
+		for ( const auto & c : canonicalizers.value( type ) ) {
+			QModelIndex iField = nif->getIndex( iBlock, c.first );
+
+			if ( !iField.isValid() )
+				continue;
+
+			QString value = nif->get<QString>( iField );
+			QString canonical = c.second( value );
+
+			if ( canonical != value ) {
+				originals.append( { iField, value } );
+				nif->set<QString>( iField, canonical );
+			}
+		}
+
+		QBuffer data;
+		data.open( QBuffer::WriteOnly );
+		data.write( type.toLatin1() );
+		nif->save( data, iBlock );
+
+		for ( const auto & o : originals )
+			nif->set<QString>( o.first, o.second );
+
+		auto survivor = survivors.constFind( data.buffer() );
+
+		if ( survivor != survivors.constEnd() )
+			map.insert( b, survivor.value() );
+		else
+			survivors.insert( data.buffer(), b );
+	}
+
+	nif->mergeNiBlocks( map );
+	nif->holdUpdates( held );
+
+	return map.count();
+}
+
 //! Combines properties
 /*!
  * This has a tendency to fail due to supposedly boolean values in many NIFs
@@ -40,75 +153,26 @@ public:
 
 	QModelIndex cast( NifModel * nif, const QModelIndex & ) override final
 	{
-		int numRemoved = 0;
-		QMap<qint32, QByteArray> props;
-		QMap<qint32, qint32> map;
-
-		do {
-			props.clear();
-			map.clear();
-
-			for ( qint32 b = 0; b < nif->getBlockCount(); b++ ) {
-				QModelIndex iBlock = nif->getBlock( b );
-				QString original_material_name;
-
-				if ( nif->isNiBlock( iBlock, "NiMaterialProperty" ) ) {
-					original_material_name = nif->get<QString>( iBlock, "Name" );
-
-					if ( nif->get<QString>( iBlock, "Name" ).contains( "Material" ) )
-						nif->set<QString>( iBlock, "Name", "Material" );
-					else if ( nif->get<QString>( iBlock, "Name" ).contains( "Default" ) )
-						nif->set<QString>( iBlock, "Name", "Default" );
-				}
-
-				if ( nif->inherits( iBlock, "BSShaderProperty" ) || nif->isNiBlock( iBlock, "BSShaderTextureSet" ) ) {
-					// these need to be unique
-					continue;
-				}
-
-				if ( nif->inherits( iBlock, "NiProperty" ) || nif->inherits( iBlock, "NiSourceTexture" ) ) {
-					QBuffer data;
-					data.open( QBuffer::WriteOnly );
-					data.write( nif->itemName( iBlock ).toLatin1() );
-					nif->save( data, iBlock );
-					props.insert( b, data.buffer() );
-				}
-
-				// restore name
-				if ( nif->isNiBlock( iBlock, "NiMaterialProperty" ) ) {
-					nif->set<QString>( iBlock, "Name", original_material_name );
-				}
-			}
+		BlockDeduplicator dedup( []( const NifModel * nif, const QModelIndex & iBlock ) {
+			// these need to be unique
+			if ( nif->inherits( iBlock, "BSShaderProperty" ) || nif->isNiBlock( iBlock, "BSShaderTextureSet" ) )
+				return false;
 
-			for ( const auto x : props.keys() ) {
-				for ( const auto y : props.keys() ) {
-					if ( x < y && ( !map.contains( y ) ) && props[x].size() == props[y].size() ) {
-						int c = 0;
+			return nif->inherits( iBlock, "NiProperty" ) || nif->inherits( iBlock, "NiSourceTexture" );
+		} );
 
-						while ( c < props[x].size() ) {
-							if ( props[x][c] != props[y][c] )
-								break;
-							c++;
-						}
+		dedup.addCanonicalizer( "NiMaterialProperty", "Name", []( const QString & name ) {
+			if ( name.contains( "Material" ) )
+				return QString( "Material" );
+			else if ( name.contains( "Default" ) )
+				return QString( "Default" );
 
-						if ( c == props[x].size() )
-							map.insert( y, x );
-					}
-				}
-			}
+			return name;
+		} );
 
-			if ( !map.isEmpty() ) {
-				numRemoved += map.count();
-				nif->mapLinks( map );
-				QList<qint32> l = map.keys();
-				std::sort( l.begin(), l.end(), std::greater<qint32>() );
-				for ( const auto b : l ) {
-					nif->removeNiBlock( b );
-				}
-			}
-		} while ( !map.isEmpty() );
+		int numRemoved = dedup.merge( nif );
 
-		QMessageBox::information( 0, "NifSkope", QString( "removed %1 properties" ).arg( numRemoved ) );
+		inform( nif, Spell::tr( "removed %1 properties" ).arg( numRemoved ) );
 		return QModelIndex();
 	}
 };
@@ -244,7 +308,7 @@ public:
 		} while ( removed );
 
 		if ( cnt > 0 )
-			QMessageBox::information( 0, "NifSkope", QString( Spell::tr( "removed %1 nodes" ) ).arg( cnt ) );
+			inform( nif, Spell::tr( "removed %1 nodes" ).arg( cnt ) );
 
 		return QModelIndex();
 	}
@@ -466,7 +530,8 @@ public:
 		nif->set<int>( iDataA, "Num Strips", stripCntA + stripCntB );
 
 		nif->updateArray( iDataA, "Strip Lengths" );
-		nif->updateArray( iDataA, "Points" );
+
+		QList<QVector<quint16>> strips;
 
 		for ( int r = 0; r < stripCntB; r++ ) {
 			QVector<quint16> strip = nif->getArray<quint16>( nif->getIndex( iDataB, "Points" ).child( r, 0 ) );
@@ -475,7 +540,21 @@ public:
 			while ( it.hasNext() )
 				it.next() += numA;
 
-			nif->set<int>( nif->getIndex( iDataA, "Strip Lengths" ).child( r + stripCntA, 0 ), strip.size() );
+			strips.append( strip );
+		}
+
+		// the strip lengths size the strips, so they are set first
+		QVector<int> lengths = nif->getArray<int>( iDataA, "Strip Lengths" );
+
+		for ( int r = 0; r < stripCntB && r + stripCntA < lengths.count(); r++ )
+			lengths[r + stripCntA] = strips.at( r ).size();
+
+		nif->setArray<int>( iDataA, "Strip Lengths", lengths );
+		nif->updateArray( iDataA, "Points" );
+
+		for ( int r = 0; r < stripCntB; r++ ) {
+			const QVector<quint16> & strip = strips.at( r );
+
 			nif->updateArray( nif->getIndex( iDataA, "Points" ).child( r + stripCntA, 0 ) );
 			nif->setArray<quint16>( nif->getIndex( iDataA, "Points" ).child( r + stripCntA, 0 ), strip );
 		}
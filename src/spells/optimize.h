@@ -0,0 +1,85 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2012, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+#ifndef SP_OPTIMIZE_H
+#define SP_OPTIMIZE_H
+
+#include "spellbook.h"
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+#include <functional>
+
+
+//! \file optimize.h Block deduplication for the optimization spells
+
+//! Merges blocks with identical contents
+/*!
+ * Candidate blocks are serialized and looked up by their payload, so equal
+ * blocks are found in a single pass. Candidates are visited after the
+ * candidates they link to, with those links already pointing at the
+ * surviving copies, so properties that only differed in which copy of a
+ * texture they used merge as well. All merges are applied at once with
+ * NifModel::mergeNiBlocks().
+ */
+class BlockDeduplicator final
+{
+public:
+	//! Decides whether a block may be merged
+	typedef std::function<bool ( const NifModel *, const QModelIndex & )> Filter;
+	//! Maps the value of a string field to the value it is compared as
+	typedef std::function<QString ( const QString & )> Canonicalizer;
+
+	//! Constructor
+	BlockDeduplicator( const Filter & filter ) : filter( filter ) {}
+
+	//! Compares the string \a field of blocks of the given type as mapped by \a canonicalize
+	/*!
+	 * The canonical value is set while the block is serialized, and the
+	 * original value is restored right after.
+	 */
+	void addCanonicalizer( const QString & blockType, const QString & field, const Canonicalizer & canonicalize );
+
+	//! Merges the equal blocks of \a nif; returns the number of blocks removed
+	int merge( NifModel * nif ) const;
+
+private:
+	//! The blocks that may be merged
+	Filter filter;
+	//! Canonicalized fields and their canonicalizers, by block type
+	QHash<QString, QList<QPair<QString, Canonicalizer>>> canonicalizers;
+};
+
+#endif // SP_OPTIMIZE_H
@@ -301,6 +301,10 @@ public:
 			QModelIndex idx = iParent.child( r, 0 );
 			bool child;
 
+			// the rows of a packed array have no index; they hold no links
+			if ( !idx.isValid() )
+				break;
+
 			if ( nif->isLink( idx, &child ) ) {
 				qint32 l = nif->getLink( idx );
 
@@ -438,14 +438,7 @@ public:
 				QModelIndex iPoints = nif->getIndex( iData, "Points" );
 
 				for ( int s = 0; s < nif->rowCount( iPoints ); s++ ) {
-					QVector<quint16> strip;
-					QModelIndex iStrip = iPoints.child( s, 0 );
-
-					for ( int p = 0; p < nif->rowCount( iStrip ); p++ ) {
-						strip.append( nif->get<int>( iStrip.child( p, 0 ) ) );
-					}
-
-					strips.append( strip );
+					strips.append( nif->getArray<quint16>( iPoints.child( s, 0 ) ) );
 				}
 
 				triangles = triangulate( strips ).toList();
@@ -499,14 +492,7 @@ public:
 						QModelIndex iPoints = nif->getIndex( iPart, "Strips" );
 
 						for ( int s = 0; s < nif->rowCount( iPoints ); s++ ) {
-							QVector<quint16> strip;
-							QModelIndex iStrip = iPoints.child( s, 0 );
-
-							for ( int p = 0; p < nif->rowCount( iStrip ); p++ ) {
-								strip.append( nif->get<int>( iStrip.child( p, 0 ) ) );
-							}
-
-							strips.append( strip );
+							strips.append( nif->getArray<quint16>( iPoints.child( s, 0 ) ) );
 						}
 
 						partTriangles = triangulate( strips );
@@ -908,9 +894,12 @@ public:
 					QModelIndex iVertex = iVWeights.child( v, 0 );
 					nif->updateArray( iVertex );
 					QList<boneweight> list = weights.value( vertices[v] );
+					QVector<float> vertexWeights( maxBones );
 
 					for ( int b = 0; b < maxBones; b++ )
-						nif->set<float>( iVertex.child( b, 0 ), list.count() > b ? list[ b ].second : 0.0 );
+						vertexWeights[b] = list.count() > b ? list[ b ].second : 0.0;
+
+					nif->setArray<float>( iVertex, vertexWeights );
 				}
 
 				nif->set<int>( iPart, "Has Faces", 1 );
@@ -924,8 +913,12 @@ public:
 					QModelIndex iStripLengths = nif->getIndex( iPart, "Strip Lengths" );
 					nif->updateArray( iStripLengths );
 
-					for ( int s = 0; s < nif->rowCount( iStripLengths ); s++ )
-						nif->set<int>( iStripLengths.child( s, 0 ), strips.value( s ).count() );
+					QVector<int> stripLengths( nif->rowCount( iStripLengths ) );
+
+					for ( int s = 0; s < stripLengths.count(); s++ )
+						stripLengths[s] = strips.value( s ).count();
+
+					nif->setArray<int>( iStripLengths, stripLengths );
 
 					QModelIndex iStrips = nif->getIndex( iPart, "Strips" );
 					nif->updateArray( iStrips );
@@ -956,9 +949,12 @@ public:
 					QModelIndex iVertex = iVBones.child( v, 0 );
 					nif->updateArray( iVertex );
 					QList<boneweight> list = weights.value( vertices[v] );
+					QVector<int> vertexBones( maxBones );
 
 					for ( int b = 0; b < maxBones; b++ )
-						nif->set<int>( iVertex.child( b, 0 ), list.count() > b ? bones.indexOf( list[ b ].first ) : 0 );
+						vertexBones[b] = list.count() > b ? bones.indexOf( list[ b ].first ) : 0;
+
+					nif->setArray<int>( iVertex, vertexBones );
 				}
 			}
 
@@ -969,7 +965,7 @@ public:
 		catch ( QString err )
 		{
 			if ( !err.isEmpty() )
-				QMessageBox::warning( 0, "NifSkope", err );
+				inform( nif, err, true );
 
 			return iShape;
 		}
@@ -1236,6 +1232,12 @@ public:
 	QModelIndex cast( NifModel * nif, const QModelIndex & index ) override final
 	{
 		if ( nif->getLink( index, "Controller" ) != -1 ) {
+			// nobody can be asked; leave the block alone
+			if ( nif->isHeadless() ) {
+				inform( nif, Spell::tr( "Mirror Armature skipped animated block %1" ).arg( nif->getBlockNumber( index ) ), true );
+				return index;
+			}
+
 			int keyframeResponse = QMessageBox::question( 0, Spell::tr( "Mirror Armature" ), Spell::tr( "Do you wish to flip or delete animation?" ), Spell::tr( "Flip" ), Spell::tr( "Delete" ), Spell::tr( "Cancel" ) );
 
 			if ( keyframeResponse == 2 )
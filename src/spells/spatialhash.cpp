@@ -0,0 +1,103 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2012, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+#include "spatialhash.h"
+
+#include <cmath>
+#include <cstring>
+
+
+SpatialHash::SpatialHash( const QVector<Vector3> & points, float cellSize )
+{
+	// a vanishing cell size would put every point in a cell of its own
+	scale = ( cellSize > 1e-6f ) ? 1.0f / cellSize : 1e6f;
+
+	int numPoints = points.count();
+	QVector<QPair<quint64, int> > keys( numPoints );
+
+	for ( int i = 0; i < numPoints; i++ ) {
+		const Vector3 & p = points[i];
+		keys[i] = qMakePair( cellKey( cell( p[0] ), cell( p[1] ), cell( p[2] ) ), i );
+	}
+
+	std::sort( keys.begin(), keys.end() );
+
+	order.resize( numPoints );
+	cells.reserve( numPoints );
+
+	for ( int i = 0; i < numPoints; ) {
+		int j = i;
+
+		while ( j < numPoints && keys[j].first == keys[i].first ) {
+			order[j] = keys[j].second;
+			j++;
+		}
+
+		cells.insert( keys[i].first, qMakePair( i, j ) );
+		i = j;
+	}
+}
+
+qint64 SpatialHash::cell( float x ) const
+{
+	double c = std::floor( double( x ) * scale );
+
+	// NaN and far away points all share the outermost cells
+	if ( !( c > -1e15 ) )
+		return qint64( -1e15 );
+
+	if ( c > 1e15 )
+		return qint64( 1e15 );
+
+	return qint64( c );
+}
+
+quint64 SpatialHash::cellKey( qint64 x, qint64 y, qint64 z )
+{
+	// large primes spread neighbouring cells across the table
+	return ( quint64( x ) * Q_UINT64_C( 73856093 ) ) ^ ( quint64( y ) * Q_UINT64_C( 19349663 ) ) ^ ( quint64( z ) * Q_UINT64_C( 83492791 ) );
+}
+
+uint hashFloats( const float * values, int count, uint seed )
+{
+	uint h = seed;
+
+	for ( int i = 0; i < count; i++ ) {
+		// 0.0 and -0.0 compare equal, so they have to hash alike
+		float v = values[i] + 0.0f;
+		quint32 bits;
+		memcpy( &bits, &v, sizeof( bits ) );
+		h ^= bits + 0x9e3779b9 + ( h << 6 ) + ( h >> 2 );
+	}
+
+	return h;
+}
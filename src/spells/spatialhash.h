@@ -0,0 +1,114 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2012, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+#ifndef SPATIALHASH_H
+#define SPATIALHASH_H
+
+#include "niftypes.h"
+
+#include <QHash>
+#include <QPair>
+#include <QVector>
+
+#include <algorithm> // std::find
+
+
+//! \file spatialhash.h Neighbour queries and exact hashing for mesh vertices
+
+//! Buckets points into the cells of a uniform grid
+/*!
+ * Points closer than the cell size to each other always lie in the same or
+ * in adjacent cells, so a query only has to look at the 27 cells around a
+ * point instead of at every point.
+ */
+class SpatialHash final
+{
+public:
+	//! Buckets \a points into cubic cells of the given size
+	SpatialHash( const QVector<Vector3> & points, float cellSize );
+
+	//! Calls f( index ) for every point in the cells around \a p
+	/*!
+	 * This covers every point within the cell size of \a p, and possibly some
+	 * further away; the caller checks the actual distance.
+	 */
+	template <typename F> void forNeighbours( const Vector3 & p, F f ) const;
+
+private:
+	//! The cell coordinate of x
+	qint64 cell( float x ) const;
+	//! The key of the cell at the given coordinates; distinct cells may share a key
+	static quint64 cellKey( qint64 x, qint64 y, qint64 z );
+
+	//! The inverse of the cell size
+	float scale;
+	//! Point indices, sorted by cell key
+	QVector<int> order;
+	//! The range of order holding each cell key
+	QHash<quint64, QPair<int, int> > cells;
+};
+
+//! Hashes the exact values of \a count floats, consistently with operator==
+uint hashFloats( const float * values, int count, uint seed = 0 );
+
+
+template <typename F> inline void SpatialHash::forNeighbours( const Vector3 & p, F f ) const
+{
+	qint64 x = cell( p[0] ), y = cell( p[1] ), z = cell( p[2] );
+
+	// a key is visited once even if several of the 27 cells share it
+	quint64 seen[27];
+	int numSeen = 0;
+
+	for ( qint64 dx = -1; dx <= 1; dx++ ) {
+		for ( qint64 dy = -1; dy <= 1; dy++ ) {
+			for ( qint64 dz = -1; dz <= 1; dz++ ) {
+				quint64 key = cellKey( x + dx, y + dy, z + dz );
+
+				if ( std::find( seen, seen + numSeen, key ) != seen + numSeen )
+					continue;
+
+				seen[numSeen++] = key;
+
+				auto it = cells.constFind( key );
+
+				if ( it == cells.constEnd() )
+					continue;
+
+				for ( int i = it.value().first; i < it.value().second; i++ )
+					f( order[i] );
+			}
+		}
+	}
+}
+
+#endif
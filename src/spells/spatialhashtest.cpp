@@ -0,0 +1,198 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2012, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+
+/*
+ * Checks SpatialHash against a brute force search and times both.
+ *
+ * Build with spatialhashtest.pro; pass a point count to change the benchmark size.
+ */
+
+#include "spatialhash.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSet>
+
+#include <stdio.h> // printf
+
+
+static quint32 seed = 0x1234567;
+
+//! A pseudo random number in [0, 1)
+static float randomFloat()
+{
+	// Numerical Recipes LCG; the upper bits are the useful ones
+	seed = seed * 1664525 + 1013904223;
+	return ( seed >> 8 ) / float( 1 << 24 );
+}
+
+static QVector<Vector3> randomPoints( int count, float size )
+{
+	QVector<Vector3> points( count );
+
+	for ( Vector3 & p : points )
+		p = Vector3( ( randomFloat() - 0.5f ) * size, ( randomFloat() - 0.5f ) * size, ( randomFloat() - 0.5f ) * size );
+
+	return points;
+}
+
+//! Checks that every pair of points closer than radius is visited
+static bool testNeighbours( const QVector<Vector3> & points, float radius )
+{
+	SpatialHash grid( points, radius );
+	float maxd = radius * radius;
+	int missed = 0, pairs = 0, repeated = 0;
+
+	for ( int i = 0; i < points.count(); i++ ) {
+		QSet<int> found;
+		grid.forNeighbours( points[i], [&]( int j ) {
+			if ( found.contains( j ) )
+				repeated++;
+
+			found.insert( j );
+		} );
+
+		for ( int j = 0; j < points.count(); j++ ) {
+			if ( ( points[i] - points[j] ).squaredLength() < maxd ) {
+				pairs++;
+
+				if ( !found.contains( j ) )
+					missed++;
+			}
+		}
+	}
+
+	if ( missed )
+		printf( "FAIL %d of %d pairs within %g missed\n", missed, pairs, radius );
+
+	if ( repeated )
+		printf( "FAIL %d points visited more than once\n", repeated );
+
+	return missed == 0 && repeated == 0;
+}
+
+static bool testHashFloats()
+{
+	float a[3] = { 0.0f, 1.0f, -2.5f };
+	float b[3] = { -0.0f, 1.0f, -2.5f };
+	float c[3] = { 0.0f, 1.0f, 2.5f };
+
+	bool ok = true;
+
+	if ( hashFloats( a, 3 ) != hashFloats( b, 3 ) ) {
+		printf( "FAIL 0.0 and -0.0 hash differently\n" );
+		ok = false;
+	}
+
+	if ( hashFloats( a, 3 ) == hashFloats( c, 3 ) ) {
+		printf( "FAIL -2.5 and 2.5 hash alike\n" );
+		ok = false;
+	}
+
+	return ok;
+}
+
+static void benchmark( int count )
+{
+	QVector<Vector3> points = randomPoints( count, 100.0f );
+	float radius = 100.0f / std::cbrt( float( count ) );
+	float maxd = radius * radius;
+
+	QElapsedTimer timer;
+	timer.start();
+
+	SpatialHash grid( points, radius );
+	qint64 hashPairs = 0;
+
+	for ( int i = 0; i < count; i++ ) {
+		grid.forNeighbours( points[i], [&]( int j ) {
+			if ( j > i && ( points[i] - points[j] ).squaredLength() < maxd )
+				hashPairs++;
+		} );
+	}
+
+	double hashTime = timer.nsecsElapsed() / 1e6;
+	timer.restart();
+
+	qint64 brutePairs = 0;
+
+	for ( int i = 0; i < count; i++ ) {
+		for ( int j = i + 1; j < count; j++ ) {
+			if ( ( points[i] - points[j] ).squaredLength() < maxd )
+				brutePairs++;
+		}
+	}
+
+	double bruteTime = timer.nsecsElapsed() / 1e6;
+
+	printf( "%d points: %lld pairs in %.1f ms hashed, %lld pairs in %.1f ms brute force\n",
+		count, hashPairs, hashTime, brutePairs, bruteTime );
+}
+
+int main( int argc, char * argv[] )
+{
+	QCoreApplication app( argc, argv );
+
+	bool ok = testHashFloats();
+
+	// dense and sparse clouds around the origin, so that negative cells are covered
+	ok = testNeighbours( randomPoints( 2000, 10.0f ), 0.5f ) && ok;
+	ok = testNeighbours( randomPoints( 2000, 1000.0f ), 1.0f ) && ok;
+
+	// points on the cell boundaries
+	QVector<Vector3> lattice;
+	for ( int x = -4; x <= 4; x++ )
+		for ( int y = -4; y <= 4; y++ )
+			for ( int z = -4; z <= 4; z++ )
+				lattice.append( Vector3( x * 0.25f, y * 0.25f, z * 0.25f ) );
+
+	ok = testNeighbours( lattice, 0.25f ) && ok;
+	ok = testNeighbours( lattice, 0.3f ) && ok;
+
+	// a vanishing cell size must still find coincident points
+	QVector<Vector3> same( 10, Vector3( 1.0f, 2.0f, 3.0f ) );
+	SpatialHash sameGrid( same, 0.0f );
+	int sameFound = 0;
+	sameGrid.forNeighbours( same[0], [&]( int ) { sameFound++; } );
+
+	if ( sameFound != same.count() ) {
+		printf( "FAIL %d of %d coincident points found\n", sameFound, same.count() );
+		ok = false;
+	}
+
+	benchmark( argc > 1 ? QString( argv[1] ).toInt() : 20000 );
+
+	printf( "%s\n", ok ? "all tests passed" : "some tests failed" );
+
+	return ok ? 0 : 1;
+}
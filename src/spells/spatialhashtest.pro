@@ -0,0 +1,15 @@
+TEMPLATE = app
+LANGUAGE = C++
+TARGET   = spatialhashtest
+
+QT += widgets
+CONFIG += c++11 release thread warn_on console
+
+INCLUDEPATH += ..
+
+DESTDIR = ./
+
+HEADERS += spatialhash.h ../niftypes.h
+SOURCES += spatialhash.cpp spatialhashtest.cpp
+
+# vim: set filetype=config :
@@ -7,7 +7,6 @@
 #include <QLineEdit>
 #include <QListView>
 #include <QListWidget>
-#include <QMessageBox>
 #include <QPushButton>
 #include <QRegularExpression>
 #include <QStringListModel>
@@ -439,8 +438,7 @@ public:
 		// update the palette itself
 		nif->set<QByteArray>( iPalette, "Palette", bytes );
 
-		QMessageBox::information( 0, "NifSkope",
-			Spell::tr( "Updated %1 offsets in %2 sequences" ).arg( numRefsUpdated ).arg( sequenceUpdateList.size() ) );
+		inform( nif, Spell::tr( "Updated %1 offsets in %2 sequences" ).arg( numRefsUpdated ).arg( sequenceUpdateList.size() ) );
 
 		return index;
 	}
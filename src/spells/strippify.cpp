@@ -49,9 +49,7 @@ class spStrippify final : public Spell
 
 		int skip = 0;
 
-		for ( int t = 0; t < nif->rowCount( iTriangles ); t++ ) {
-			Triangle tri = nif->get<Triangle>( iTriangles.child( t, 0 ) );
-
+		for ( const Triangle & tri : nif->getArray<Triangle>( iTriangles ) ) {
 			if ( tri[0] != tri[1] && tri[1] != tri[2] && tri[2] != tri[0] )
 				triangles.append( tri );
 			else
@@ -122,11 +120,17 @@ class spStrippify final : public Spell
 
 			if ( iLengths.isValid() && iPoints.isValid() ) {
 				nif->updateArray( iLengths );
+
+				// the strip lengths size the strips, so they are set first
+				QVector<int> lengths;
+				for ( const QVector<quint16>& strip : strips )
+					lengths.append( strip.count() );
+
+				nif->setArray<int>( iLengths, lengths );
 				nif->updateArray( iPoints );
 				int x = 0;
 				int z = 0;
 				for ( const QVector<quint16>& strip : strips ) {
-					nif->set<int>( iLengths.child( x, 0 ), strip.count() );
 					QModelIndex iStrip = iPoints.child( x, 0 );
 					nif->updateArray( iStrip );
 					nif->setArray<quint16>( iStrip, strip );
@@ -209,15 +213,8 @@ class spTriangulate final : public Spell
 		if ( !iPoints.isValid() )
 			return idx;
 
-		for ( int s = 0; s < nif->rowCount( iPoints ); s++ ) {
-			QVector<quint16> strip;
-			QModelIndex iStrip = iPoints.child( s, 0 );
-
-			for ( int p = 0; p < nif->rowCount( iStrip ); p++ )
-				strip.append( nif->get<int>( iStrip.child( p, 0 ) ) );
-
-			strips.append( strip );
-		}
+		for ( int s = 0; s < nif->rowCount( iPoints ); s++ )
+			strips.append( nif->getArray<quint16>( iPoints.child( s, 0 ) ) );
 
 		QVector<Triangle> triangles = triangulate( strips );
 
@@ -343,7 +340,7 @@ public:
 
 		nif->set<int>( iData, "Num Strips", 1 );
 		nif->updateArray( iLength );
-		nif->set<int>( iLength.child( 0, 0 ), strip.size() );
+		nif->setArray<int>( iLength, { strip.size() } );
 		nif->updateArray( iPoints );
 		nif->updateArray( iPoints.child( 0, 0 ) );
 		nif->setArray<quint16>( iPoints.child( 0, 0 ), strip );
@@ -415,10 +412,16 @@ public:
 
 		nif->set<int>( iData, "Num Strips", strips.size() );
 		nif->updateArray( iLength );
+
+		// the strip lengths size the strips, so they are set first
+		QVector<int> lengths;
+		for ( const QVector<quint16> & strip : strips )
+			lengths.append( strip.size() );
+
+		nif->setArray<int>( iLength, lengths );
 		nif->updateArray( iPoints );
 
 		for ( int r = 0; r < strips.count(); r++ ) {
-			nif->set<int>( iLength.child( r, 0 ), strips[r].size() );
 			nif->updateArray( iPoints.child( r, 0 ) );
 			nif->setArray<quint16>( iPoints.child( r, 0 ), strips[r] );
 		}
@@ -827,9 +827,9 @@ public:
 
 		if ( isExternal ) {
 			QString filename = nif->get<QString>( index, "File Name" );
-			tex->bind( filename );
+			tex->load( filename );
 		} else {
-			tex->bind( index );
+			tex->load( index );
 		}
 
 		qWarning() << tex->info( index );
@@ -937,7 +937,7 @@ public:
 		TexCache * tex = new TexCache();
 		tex->setNifFolder( nif->getFolder() );
 
-		if ( tex->bind( nif->get<QString>( iBlock, "File Name" ) ) ) {
+		if ( tex->load( nif->get<QString>( iBlock, "File Name" ) ) ) {
 			return true;
 		}
 
@@ -949,7 +949,7 @@ public:
 		TexCache * tex = new TexCache();
 		tex->setNifFolder( nif->getFolder() );
 
-		if ( tex->bind( index ) ) {
+		if ( tex->load( index ) ) {
 			//qWarning() << "spEmbedTexture: Embedding texture " << index;
 
 			int blockNum = nif->getBlockNumber( index );
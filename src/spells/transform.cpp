@@ -102,7 +102,13 @@ bool spApplyTransformation::isApplicable( const NifModel * nif, const QModelInde
 
 QModelIndex spApplyTransformation::cast( NifModel * nif, const QModelIndex & index )
 {
-	if ( ( nif->getLink( index, "Controller" ) != -1 || nif->getLink( index, "Skin Instance" ) != -1 ) )
+	if ( ( nif->getLink( index, "Controller" ) != -1 || nif->getLink( index, "Skin Instance" ) != -1 ) ) {
+		// nobody can be asked; leave the block alone
+		if ( nif->isHeadless() ) {
+			inform( nif, Spell::tr( "Apply Transformation skipped animated or skinned block %1" ).arg( nif->getBlockNumber( index ) ), true );
+			return index;
+		}
+
 		if ( QMessageBox::question( 0, Spell::tr( "Apply Transformation" ),
 			Spell::tr( "On animated and or skinned nodes Apply Transformation most likely won't work the way you expected it." ),
 			Spell::tr( "Try anyway" ),
@@ -110,6 +116,7 @@ QModelIndex spApplyTransformation::cast( NifModel * nif, const QModelIndex & ind
 		{
 			return index;
 		}
+	}
 
 
 
@@ -76,6 +76,10 @@ void NifTreeView::setRootIndex( const QModelIndex & index )
 	if ( root.isValid() && root.column() != 0 )
 		root = root.sibling( root.row(), 0 );
 
+	// a block whose parsing was deferred gets its rows before it is shown
+	if ( root.isValid() && model()->canFetchMore( root ) )
+		model()->fetchMore( root );
+
 	QTreeView::setRootIndex( root );
 }
 
@@ -129,10 +133,14 @@ void NifTreeView::setAllExpanded( const QModelIndex & index, bool e )
 	if ( !model() )
 		return;
 
+	// the rows of a packed array get their indexes once it is unpacked
+	if ( e && model()->canFetchMore( index ) )
+		model()->fetchMore( index );
+
 	for ( int r = 0; r < model()->rowCount( index ); r++ ) {
 		QModelIndex child = model()->index( r, 0, index );
 
-		if ( model()->hasChildren( child ) ) {
+		if ( child.isValid() && model()->hasChildren( child ) ) {
 			setExpanded( child, e );
 			setAllExpanded( child, e );
 		}
@@ -169,9 +177,12 @@ void NifTreeView::updateConditionRecurse( const QModelIndex & index )
 	*/
 	//else
 	//{
+	// the rows of a packed array have no index until it is unpacked; they share its conditions
 	for ( int r = 0; r < model()->rowCount( index ); r++ ) {
 		QModelIndex child = model()->index( r, 0, index );
-		updateConditionRecurse( child );
+
+		if ( child.isValid() )
+			updateConditionRecurse( child );
 	}
 
 	setRowHidden( index.row(), index.parent(), ( EvalConditions && !nif->evalVersion( index, false ) ) );
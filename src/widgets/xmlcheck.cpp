@@ -250,7 +250,7 @@ void TestShredder::threadFinished()
 
 void TestShredder::chooseBlock()
 {
-	QStringList ids = NifModel::allNiBlocks();
+	QStringList ids = NifModel().allNiBlocks();
 	ids.sort();
 
 	QMap<QString, QMenu *> map;
@@ -382,7 +382,8 @@ void TestThread::run()
 		emit sigStart( filepath );
 
 		BaseModel * model = &nif;
-		QReadWriteLock * lock = &nif.XMLlock;
+		// NifModel reads an immutable schema and needs no lock, see NifSchema
+		QReadWriteLock * lock = nullptr;
 
 		if ( filepath.endsWith( ".KFM", Qt::CaseInsensitive ) ) {
 			model = &kfm;
@@ -392,7 +393,7 @@ void TestThread::run()
 		bool kf = ( filepath.endsWith( ".KF", Qt::CaseInsensitive ) || filepath.endsWith( ".KFA", Qt::CaseInsensitive ) );
 
 		{
-			// lock the XML lock
+			// lock the KFM XML lock
 			QReadLocker lck( lock );
 
 			if ( model == &nif && nif.earlyRejection( filepath, blockMatch, verMatch ) ) {
@@ -460,6 +461,10 @@ QList<Message> TestThread::checkLinks( const NifModel * nif, const QModelIndex &
 		QModelIndex idx = iParent.child( r, 0 );
 		bool child;
 
+		// the rows of a packed array have no index; they hold no links
+		if ( !idx.isValid() )
+			break;
+
 		if ( nif->isLink( idx, &child ) ) {
 			qint32 l = nif->getLink( idx );
 